@@ -19,18 +19,30 @@
 
 #include "DetectorConstruction.hh"
 #include "ParallelWorldConstruction.hh"
+#include "ImportanceWorldConstruction.hh"
 #include "PrimaryGeneratorAction.hh"
 #include "RunAction.hh"
 #include "EventAction.hh"
+#include "SteppingAction.hh"
+#include "StackingAction.hh"
+#include "TrackingAction.hh"
+#include "RegionDefinition.hh"
+#include "RegionPhysics.hh"
+#include "CrossSectionBiasing.hh"
+#include "TargetFastSimModel.hh"
 
 #include "G4PhysListFactory.hh"
 #include "G4ParallelWorldPhysics.hh"
+#include "G4StepLimiterPhysics.hh"
+#include "G4RegionStore.hh"
 
 #include "RootFileWriter.hh"
 
 #include "G4SystemOfUnits.hh"
 #include "G4String.hh"
 #include <string> //C++11 std::stoi
+#include <map>
+#include <set>
 
 #include "TROOT.h"
 
@@ -59,6 +71,7 @@ void printHelp(G4double target_thick,
                G4double beam_offset,
                G4double beam_zpos,
                G4double beam_rCut,
+               G4String covarMatrixString,
                G4bool   doBacktrack,
                G4int    rngSeed,
                G4String filename_out,
@@ -69,7 +82,31 @@ void printHelp(G4double target_thick,
                G4double cutoff_radius,
                G4double edep_dens_dz,
                G4int    engNbins,
-               std::vector<G4String> &magnetDefinitions);
+               std::vector<G4double> &scoringPlanes,
+               std::vector<G4double> &targetPlanes,
+               std::vector<G4double> &driftProjections,
+               std::vector<G4String> &magnetDefinitions,
+               G4bool   killAfterTracker,
+               G4bool   killBackward,
+               std::map<G4int,G4double> &killEnergy,
+               std::set<G4int> &noStack,
+               G4double looperWarnE,
+               G4double looperImportantE,
+               G4int    looperTrials,
+               G4int    eventStepBudget,
+               G4double eventTimeBudget,
+               G4int    primariesPerEvent,
+               std::vector<G4String> &regionDefinitions,
+               G4String importanceDefinition,
+               G4String xsBiasDefinition,
+               G4String phaseSpaceOut,
+               G4String phaseSpaceIn,
+               G4String beamFileIn,
+               std::vector<G4String> &beamHistDefinitions,
+               G4String fastTarget,
+               G4int fieldBenchmark,
+               G4int navigationBenchmark,
+               G4bool massWorldScoring);
 
 //....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
 
@@ -105,6 +142,7 @@ int main(int argc,char** argv) {
     G4bool   doBacktrack = false;             // Backtrack to the z-position?
     G4String covarianceString = "";           // Beam covariance matrix parameters
     G4double beam_rCut = 0.0;                 // Beam distribution radial cutoff
+    G4String covarMatrixString = "";          // Full 4D/6D beam covariance matrix (upper triangle)
 
     G4String physListName = "QGSP_FTFP_BERT"; // Name of physics list to use
 
@@ -125,8 +163,42 @@ int main(int argc,char** argv) {
     G4double edep_dens_dz          = 0.0;     // Z bin width for energy deposit histograms [mm]
     G4int    engNbins              = 0;       // Number of bins for the 1D energy histograms
 
+    std::vector<G4double> scoringPlanes;      // Extra tracker-like scoring planes at these z positions [mm]
+    std::vector<G4double> targetPlanes;       // Scoring planes inside the target at these depths [mm]
+    std::vector<G4double> driftProjections;   // Project the exit phase space to these z positions [mm]
+
     std::vector<G4String> magnetDefinitions;
 
+    G4bool   killAfterTracker      = false;   // Kill tracks downstream of the last scoring plane
+    G4bool   killBackward          = false;   // Kill backwards-going tracks upstream of the target
+    std::map<G4int,G4double> killEnergy;      // Kill tracks of PDG below kinetic energy [MeV]
+    std::set<G4int> noStack;                  // Never track secondaries of PDG
+
+    G4double looperWarnE      = -1.0;         // Looper thresholds of the transportation [MeV],
+    G4double looperImportantE = -1.0;         //  <0 => Geant4 default
+    G4int    looperTrials     = -1;
+    G4int    eventStepBudget  = 0;            // Kill the rest of the event after this many steps, 0 => off
+    G4double eventTimeBudget  = 0.0;          // Kill the rest of the event after this wall-clock time [s], 0 => off
+    G4int    primariesPerEvent = 1;           // Number of primaries in each event
+
+    std::vector<G4String> regionDefinitions;  // Per-region cuts and physics settings
+
+    G4String importanceDefinition = "";       // Importance biasing cells, "" => no biasing
+
+    G4String xsBiasDefinition = "";           // Target cross section biasing, "" => no biasing
+
+    G4String phaseSpaceOut = "";              // Write the particles exiting the target to this file
+    G4String phaseSpaceIn  = "";              // Read the primaries from this file instead of generating a beam
+    G4String beamFileIn    = "";              // Read the beam particles from this file instead of generating them
+    std::vector<G4String> beamHistDefinitions; // Sample beam coordinates from these 2D histograms
+
+    G4String fastTarget = "";                 // Parameterised target transport, "on" or "validate"
+
+    G4int fieldBenchmark = 0;                 // Number of field evaluations to time per magnet, 0 => off
+    G4int navigationBenchmark = 0;            // Number of navigation steps to time per magnet, 0 => off
+
+    G4bool massWorldScoring = false;          // Score the magnets in the mass world instead of a parallel world
+
     static struct option long_options[] = {
                                            {"thick",                 required_argument, NULL, 't' },
                                            {"mat",                   required_argument, NULL, 'm' },
@@ -145,6 +217,7 @@ int main(int argc,char** argv) {
                                            {"zoffset",               required_argument, NULL, 'z' },
                                            {"covar",                 required_argument, NULL, 'c' },
                                            {"beamRcut",              required_argument, NULL, 1200},
+                                           {"covarMatrix",           required_argument, NULL, 1201},
                                            {"outname",               required_argument, NULL, 'f' },
                                            {"outfolder",             required_argument, NULL, 'o' },
                                            {"seed",                  required_argument, NULL, 's' },
@@ -156,8 +229,29 @@ int main(int argc,char** argv) {
                                            {"cutoffRadius",          required_argument, NULL, 1001 },
                                            {"edepDZ",                required_argument, NULL, 1002 },
                                            {"engNbins",              required_argument, NULL, 1003 },
+                                           {"plane",                 required_argument, NULL, 1004 },
+                                           {"targetPlane",           required_argument, NULL, 1005 },
+                                           {"project",               required_argument, NULL, 1006 },
                                            {"magnet",                required_argument, NULL, 1100 },
                                            {"object",                required_argument, NULL, 1100 }, //synonum with --magnet
+                                           {"killAfterTracker",      no_argument,       NULL, 1400 },
+                                           {"killBackward",          no_argument,       NULL, 1401 },
+                                           {"killEnergy",            required_argument, NULL, 1402 },
+                                           {"noStack",               required_argument, NULL, 1403 },
+                                           {"looperThresholds",      required_argument, NULL, 1404 },
+                                           {"eventBudget",           required_argument, NULL, 1405 },
+                                           {"primariesPerEvent",     required_argument, NULL, 1406 },
+                                           {"region",                required_argument, NULL, 1500 },
+                                           {"importance",            required_argument, NULL, 1600 },
+                                           {"xsBias",                required_argument, NULL, 1700 },
+                                           {"phaseSpaceOut",         required_argument, NULL, 1800 },
+                                           {"phaseSpaceIn",          required_argument, NULL, 1801 },
+                                           {"beamFile",              required_argument, NULL, 1802 },
+                                           {"beamHist",              required_argument, NULL, 1803 },
+                                           {"fastTarget",            required_argument, NULL, 1900 },
+                                           {"fieldBenchmark",        required_argument, NULL, 2000 },
+                                           {"navigationBenchmark",   required_argument, NULL, 2001 },
+                                           {"massWorldScoring",      no_argument,       NULL, 2100 },
                                            {0,0,0,0}
     };
 
@@ -178,6 +272,7 @@ int main(int argc,char** argv) {
                       beam_offset,
                       beam_zpos,
                       beam_rCut,
+                      covarMatrixString,
                       doBacktrack,
                       rngSeed,
                       filename_out,
@@ -188,7 +283,31 @@ int main(int argc,char** argv) {
                       cutoff_radius,
                       edep_dens_dz,
                       engNbins,
-                      magnetDefinitions);
+                      scoringPlanes,
+                      targetPlanes,
+                      driftProjections,
+                      magnetDefinitions,
+                      killAfterTracker,
+                      killBackward,
+                      killEnergy,
+                      noStack,
+                      looperWarnE,
+                      looperImportantE,
+                      looperTrials,
+                      eventStepBudget,
+                      eventTimeBudget,
+                      primariesPerEvent,
+                      regionDefinitions,
+                      importanceDefinition,
+                      xsBiasDefinition,
+                      phaseSpaceOut,
+                      phaseSpaceIn,
+                      beamFileIn,
+                      beamHistDefinitions,
+                      fastTarget,
+                      fieldBenchmark,
+                      navigationBenchmark,
+                      massWorldScoring);
             exit(1);
             break;
 
@@ -392,6 +511,11 @@ int main(int argc,char** argv) {
             }
             break;
 
+        case 1201: //Full beam covariance matrix
+            //--covarMatrix s11,s12,...,s1n,s22,...,snn (upper triangle, n=4 or 6)
+            covarMatrixString = G4String(optarg);
+            break;
+
         case 'f': //Output filename
             filename_out = G4String(optarg);
             break;
@@ -476,10 +600,292 @@ int main(int argc,char** argv) {
             }
             break;
 
+        case 1004: { // Extra scoring planes, z(,z,...) [mm]
+            G4String planes_str = G4String(optarg);
+
+            str_size startPos = 0;
+            while (startPos < planes_str.length()) {
+                str_size endPos = planes_str.index(",",startPos);
+                if (endPos == std::string::npos) {
+                    endPos = planes_str.length();
+                }
+                try {
+                    scoringPlanes.push_back(std::stod(string(planes_str(startPos,endPos-startPos))));
+                }
+                catch (const std::invalid_argument& ia) {
+                    G4cout << "Invalid argument when reading plane entry '"
+                           << planes_str(startPos,endPos-startPos) << "'" << G4endl
+                           << "Got: '" << optarg << "'" << G4endl
+                           << "Expected a comma-separated list of floating point numbers!" << G4endl;
+                    exit(1);
+                }
+
+                startPos = endPos+1;
+            }
+            }
+            break;
+
+        case 1005: { // Scoring planes inside the target, depth(,depth,...) [mm]
+            G4String planes_str = G4String(optarg);
+
+            str_size startPos = 0;
+            while (startPos < planes_str.length()) {
+                str_size endPos = planes_str.index(",",startPos);
+                if (endPos == std::string::npos) {
+                    endPos = planes_str.length();
+                }
+                try {
+                    targetPlanes.push_back(std::stod(string(planes_str(startPos,endPos-startPos))));
+                }
+                catch (const std::invalid_argument& ia) {
+                    G4cout << "Invalid argument when reading targetPlane entry '"
+                           << planes_str(startPos,endPos-startPos) << "'" << G4endl
+                           << "Got: '" << optarg << "'" << G4endl
+                           << "Expected a comma-separated list of floating point numbers!" << G4endl;
+                    exit(1);
+                }
+
+                startPos = endPos+1;
+            }
+            }
+            break;
+
+        case 1006: { // Drift projections, z(,z,...) [mm]
+            G4String project_str = G4String(optarg);
+
+            str_size startPos = 0;
+            while (startPos < project_str.length()) {
+                str_size endPos = project_str.index(",",startPos);
+                if (endPos == std::string::npos) {
+                    endPos = project_str.length();
+                }
+                try {
+                    driftProjections.push_back(std::stod(string(project_str(startPos,endPos-startPos))));
+                }
+                catch (const std::invalid_argument& ia) {
+                    G4cout << "Invalid argument when reading project entry '"
+                           << project_str(startPos,endPos-startPos) << "'" << G4endl
+                           << "Got: '" << optarg << "'" << G4endl
+                           << "Expected a comma-separated list of floating point numbers!" << G4endl;
+                    exit(1);
+                }
+
+                startPos = endPos+1;
+            }
+            }
+            break;
+
         case 1100: //Object/Magnet definition
             magnetDefinitions.push_back(string(optarg));
             break;
 
+        case 1400: // Kill tracks after the last scoring plane
+            killAfterTracker = true;
+            break;
+
+        case 1401: // Kill backwards-going tracks before the first scoring plane
+            killBackward = true;
+            break;
+
+        case 1402: { // Kill tracks below a given kinetic energy, PDG:E[MeV](,PDG:E[MeV],...)
+            G4String killEnergy_str = G4String(optarg);
+
+            str_size startPos = 0;
+            while (startPos < killEnergy_str.length()) {
+                str_size endPos = killEnergy_str.index(",",startPos);
+                if (endPos == std::string::npos) {
+                    endPos = killEnergy_str.length();
+                }
+                G4String pair_str = killEnergy_str(startPos,endPos-startPos);
+
+                str_size colonPos = pair_str.index(":");
+                if (colonPos == std::string::npos) {
+                    G4cout << "Error while searching for ':' in killEnergy entry '"
+                           << pair_str << "', did not find?" << G4endl;
+                    exit(1);
+                }
+
+                G4int    killPDG;
+                G4double killE;
+                try {
+                    killPDG = std::stoi(string(pair_str(0,colonPos)));
+                    killE   = std::stod(string(pair_str(colonPos+1,pair_str.length()-colonPos-1)));
+                }
+                catch (const std::invalid_argument& ia) {
+                    G4cout << "Invalid argument when reading killEnergy entry '" << pair_str << "'" << G4endl
+                           << "Got: '" << optarg << "'" << G4endl
+                           << "Expected PDG:E, with PDG an integer and E a floating point number "
+                           << "(exponential notation is accepted)!" << G4endl;
+                    exit(1);
+                }
+                if (killE < 0.0) {
+                    G4cout << "killEnergy must be >= 0" << G4endl;
+                    exit(1);
+                }
+                killEnergy[killPDG] = killE*MeV;
+
+                startPos = endPos+1;
+            }
+            }
+            break;
+
+        case 1403: { // Don't track secondaries of the given species, PDG(,PDG,...)
+            G4String noStack_str = G4String(optarg);
+
+            str_size startPos = 0;
+            while (startPos < noStack_str.length()) {
+                str_size endPos = noStack_str.index(",",startPos);
+                if (endPos == std::string::npos) {
+                    endPos = noStack_str.length();
+                }
+                try {
+                    noStack.insert(std::stoi(string(noStack_str(startPos,endPos-startPos))));
+                }
+                catch (const std::invalid_argument& ia) {
+                    G4cout << "Invalid argument when reading noStack entry '"
+                           << noStack_str(startPos,endPos-startPos) << "'" << G4endl
+                           << "Got: '" << optarg << "'" << G4endl
+                           << "Expected a comma-separated list of integers!" << G4endl;
+                    exit(1);
+                }
+
+                startPos = endPos+1;
+            }
+            }
+            break;
+
+        case 1404: { // Looper thresholds, warnE[MeV]:importantE[MeV]:trials
+            G4String looper_str = G4String(optarg);
+            str_size colon1 = looper_str.index(":");
+            str_size colon2 = (colon1 == std::string::npos) ? std::string::npos : looper_str.index(":",colon1+1);
+            if (colon2 == std::string::npos) {
+                G4cerr << "Error: --looperThresholds expects warnE:importantE:trials, got '"
+                       << looper_str << "'" << G4endl;
+                exit(1);
+            }
+            try {
+                looperWarnE      = std::stod(string(looper_str(0,colon1)));
+                looperImportantE = std::stod(string(looper_str(colon1+1,colon2-colon1-1)));
+                looperTrials     = std::stoi(string(looper_str(colon2+1,looper_str.length()-colon2-1)));
+            }
+            catch (const std::invalid_argument& ia) {
+                G4cerr << "Invalid argument when reading looperThresholds" << G4endl
+                       << "Got: '" << optarg << "'" << G4endl
+                       << "Expected warnE:importantE:trials, with the energies as floating point numbers "
+                       << "and trials an integer!" << G4endl;
+                exit(1);
+            }
+            if (looperWarnE >= 0.0)      looperWarnE      *= MeV;
+            if (looperImportantE >= 0.0) looperImportantE *= MeV;
+            }
+            break;
+
+        case 1405: { // Per-event budget, maxSteps(:maxTime[s])
+            G4String budget_str = G4String(optarg);
+            str_size colonPos = budget_str.index(":");
+            try {
+                if (colonPos == std::string::npos) {
+                    eventStepBudget = std::stoi(string(budget_str));
+                }
+                else {
+                    eventStepBudget = std::stoi(string(budget_str(0,colonPos)));
+                    eventTimeBudget = std::stod(string(budget_str(colonPos+1,budget_str.length()-colonPos-1)));
+                }
+            }
+            catch (const std::invalid_argument& ia) {
+                G4cerr << "Invalid argument when reading eventBudget" << G4endl
+                       << "Got: '" << optarg << "'" << G4endl
+                       << "Expected maxSteps or maxSteps:maxTime, "
+                       << "with maxSteps an integer and maxTime a floating point number!" << G4endl;
+                exit(1);
+            }
+            if (eventStepBudget < 0 or eventTimeBudget < 0.0) {
+                G4cerr << "Error: --eventBudget values must be >= 0" << G4endl;
+                exit(1);
+            }
+            }
+            break;
+
+        case 1406: //Number of primaries per event
+            try {
+                primariesPerEvent = std::stoi(string(optarg));
+            }
+            catch (const std::invalid_argument& ia) {
+                G4cerr << "Invalid argument when reading primariesPerEvent" << G4endl
+                       << "Got: '" << optarg << "'" << G4endl
+                       << "Expected an integer!" << G4endl;
+                exit(1);
+            }
+            if (primariesPerEvent < 1) {
+                G4cerr << "Error: --primariesPerEvent must be >= 1" << G4endl;
+                exit(1);
+            }
+            break;
+
+        case 1500: //Region definition
+            regionDefinitions.push_back(string(optarg));
+            break;
+
+        case 1600: //Importance biasing definition
+            importanceDefinition = G4String(optarg);
+            break;
+
+        case 1700: //Cross section biasing definition
+            xsBiasDefinition = G4String(optarg);
+            break;
+
+        case 1800: //Phase space file output
+            phaseSpaceOut = G4String(optarg);
+            break;
+
+        case 1801: //Phase space file input
+            phaseSpaceIn = G4String(optarg);
+            break;
+
+        case 1802: //Beam file input
+            beamFileIn = G4String(optarg);
+            break;
+
+        case 1803: //Beam histogram input
+            beamHistDefinitions.push_back(G4String(optarg));
+            break;
+
+        case 1900: //Fast simulation of the target
+            fastTarget = G4String(optarg);
+            if (not (fastTarget == "on" or fastTarget == "validate")) {
+                G4cerr << "Error: --fastTarget expects 'on' or 'validate', got '" << fastTarget << "'" << G4endl;
+                exit(1);
+            }
+            break;
+
+        case 2000: //Field evaluation benchmark
+            try {
+                fieldBenchmark = std::stoi(string(optarg));
+            }
+            catch (const std::invalid_argument& ia) {
+                G4cerr << "Invalid argument when reading fieldBenchmark" << G4endl
+                       << "Got: '" << optarg << "'" << G4endl
+                       << "Expected an integer!" << G4endl;
+                exit(1);
+            }
+            break;
+
+        case 2001: //Navigation benchmark
+            try {
+                navigationBenchmark = std::stoi(string(optarg));
+            }
+            catch (const std::invalid_argument& ia) {
+                G4cerr << "Invalid argument when reading navigationBenchmark" << G4endl
+                       << "Got: '" << optarg << "'" << G4endl
+                       << "Expected an integer!" << G4endl;
+                exit(1);
+            }
+            break;
+
+        case 2100: //Magnet scoring in the mass world
+            massWorldScoring = true;
+            break;
+
         default: // WTF?
             G4cout << "Got an unknown getopt_char '" << char(getopt_char) << "' ("<< getopt_char<<")"
                    << " when parsing command line arguments." << G4endl;
@@ -510,6 +916,7 @@ int main(int argc,char** argv) {
               beam_offset,
               beam_zpos,
               beam_rCut,
+              covarMatrixString,
               doBacktrack,
               rngSeed,
               filename_out,
@@ -520,7 +927,31 @@ int main(int argc,char** argv) {
               cutoff_radius,
               edep_dens_dz,
               engNbins,
-              magnetDefinitions);
+              scoringPlanes,
+              targetPlanes,
+              driftProjections,
+              magnetDefinitions,
+              killAfterTracker,
+              killBackward,
+              killEnergy,
+              noStack,
+              looperWarnE,
+              looperImportantE,
+              looperTrials,
+              eventStepBudget,
+              eventTimeBudget,
+              primariesPerEvent,
+              regionDefinitions,
+              importanceDefinition,
+              xsBiasDefinition,
+              phaseSpaceOut,
+              phaseSpaceIn,
+              beamFileIn,
+              beamHistDefinitions,
+              fastTarget,
+              fieldBenchmark,
+              navigationBenchmark,
+              massWorldScoring);
 
     G4cout << "Status of other arguments:" << G4endl
            << "numEvents         =  " << numEvents << G4endl
@@ -528,6 +959,9 @@ int main(int argc,char** argv) {
     if (covarianceString != "") {
         G4cout << "Covariance string = '" << covarianceString << "'" << G4endl;
     }
+    if (covarMatrixString != "") {
+        G4cout << "Covariance matrix = '" << covarMatrixString << "'" << G4endl;
+    }
     G4cout << "Arguments which are passed on to Geant4:" << G4endl;
     for (int i = 0; i < argc_effective; i++) {
         G4cout << i << " '" << argv_effective[i] << "'" << G4endl;
@@ -571,6 +1005,17 @@ int main(int argc,char** argv) {
     //physlist->SetDefaultCutValue( 0.00001*mm);
     physlist->SetDefaultCutValue( 0.1*mm);
 
+    if (fastTarget != "") {
+        // The fast simulation model needs a region for the target
+        G4bool hasTargetRegion = false;
+        for (auto reg : regionDefinitions) {
+            if (reg == "target" or reg.index("target:") == 0) hasTargetRegion = true;
+        }
+        if (not hasTargetRegion) {
+            regionDefinitions.push_back("target");
+        }
+    }
+
     DetectorConstruction* physWorld = new DetectorConstruction(target_thick,
                                                                target_material,
                                                                detector_distance,
@@ -579,12 +1024,71 @@ int main(int argc,char** argv) {
                                                                target_angle,
                                                                target_rotate,
                                                                world_size,
-                                                               magnetDefinitions);
+                                                               magnetDefinitions,
+                                                               regionDefinitions);
 
-    ParallelWorldConstruction* magnetSensorWorld =
-        new ParallelWorldConstruction("MagnetSensorWorld",physWorld);
-    physWorld->RegisterParallelWorld(magnetSensorWorld);
-    physlist->RegisterPhysics(new G4ParallelWorldPhysics("MagnetSensorWorld"));
+    if (not scoringPlanes.empty()) {
+        physWorld->SetScoringPlanes(scoringPlanes);
+    }
+
+    if (not targetPlanes.empty()) {
+        physWorld->SetTargetPlanes(targetPlanes);
+    }
+
+    if (massWorldScoring) {
+        physWorld->SetMassWorldScoring(true);
+    }
+    // The MagnetSensorWorld also holds the target planes
+    if (not massWorldScoring or not targetPlanes.empty()) {
+        ParallelWorldConstruction* magnetSensorWorld =
+            new ParallelWorldConstruction("MagnetSensorWorld",physWorld);
+        physWorld->RegisterParallelWorld(magnetSensorWorld);
+        physlist->RegisterPhysics(new G4ParallelWorldPhysics("MagnetSensorWorld"));
+    }
+
+    ImportanceWorldConstruction* importanceWorld = NULL;
+    if (importanceDefinition != "") {
+        importanceWorld = new ImportanceWorldConstruction("ImportanceWorld", physWorld, importanceDefinition);
+        physWorld->RegisterParallelWorld(importanceWorld);
+        physlist->RegisterPhysics(new ImportancePhysics("ImportanceWorld", importanceWorld->GetParticles()));
+        physlist->RegisterPhysics(new G4ParallelWorldPhysics("ImportanceWorld"));
+    }
+
+    CrossSectionBiasingOperator* xsBiasOperator = NULL;
+    if (xsBiasDefinition != "") {
+        xsBiasOperator = new CrossSectionBiasingOperator(xsBiasDefinition);
+        xsBiasOperator->ConfigurePhysics(physlist);
+    }
+
+    // The fast simulation process is shared by the target and object models (fastOptics, absorb)
+    G4bool useFastSim  = (fastTarget != "");
+    G4bool useAbsorber = false; // The absorbers also need the neutral particles
+    for (auto mag : physWorld->magnets) {
+        if (mag->UsesFastSimulation()) useFastSim = true;
+        if (mag->UsesAbsorber())       useAbsorber = true;
+    }
+    if (useFastSim or useAbsorber) {
+        physlist->RegisterPhysics(new TargetFastSimPhysics(useAbsorber));
+    }
+
+    // Per-region physics; must be configured before the physics list is constructed
+    G4bool useStepLimiter = false;
+    G4bool useInactivate  = false;
+    for (auto reg : physWorld->regions) {
+        reg->ConfigurePhysics(physlist);
+        if (reg->GetMaxStep() > 0.0)          useStepLimiter = true;
+        if (not reg->GetInactivate().empty()) useInactivate = true;
+    }
+    for (auto mag : physWorld->magnets) {
+        if (mag->GetFieldMaxStep() > 0.0)     useStepLimiter = true;
+    }
+    if (useStepLimiter) {
+        physlist->RegisterPhysics(new G4StepLimiterPhysics());
+    }
+    if (useInactivate) {
+        // Must come after all other physics constructors
+        physlist->RegisterPhysics(new RegionPhysics(physWorld->regions));
+    }
 
     runManager->SetUserInitialization(physWorld);
 
@@ -597,10 +1101,16 @@ int main(int argc,char** argv) {
                                                                     beam_zpos,
                                                                     doBacktrack,
                                                                     covarianceString,
+                                                                    covarMatrixString,
                                                                     beam_rCut,
                                                                     rngSeed,
                                                                     beam_eFlat_min,
-                                                                    beam_eFlat_max);
+                                                                    beam_eFlat_max,
+                                                                    phaseSpaceIn,
+                                                                    beamFileIn,
+                                                                    beamHistDefinitions,
+                                                                    primariesPerEvent,
+                                                                    numEvents);
     runManager->SetUserAction(gen_action);
     //
     RunAction* run_action = new RunAction;
@@ -608,11 +1118,68 @@ int main(int argc,char** argv) {
     //
     EventAction* event_action = new EventAction(run_action);
     runManager->SetUserAction(event_action);
+    //
+    if (primariesPerEvent > 1) {
+        TrackingAction* tracking_action = new TrackingAction;
+        runManager->SetUserAction(tracking_action);
+    }
+    //
+    G4bool looperThresholds = (looperWarnE >= 0.0 or looperImportantE >= 0.0 or looperTrials >= 0);
+    if (killAfterTracker or killBackward or not killEnergy.empty() or
+        eventStepBudget > 0 or eventTimeBudget > 0.0 or looperThresholds) {
+        SteppingAction* stepping_action = new SteppingAction(physWorld,
+                                                             killAfterTracker,
+                                                             killBackward,
+                                                             killEnergy,
+                                                             eventStepBudget,
+                                                             eventTimeBudget);
+        runManager->SetUserAction(stepping_action);
+    }
+    //
+    if (not noStack.empty() or not killEnergy.empty()) {
+        StackingAction* stacking_action = new StackingAction(physWorld, noStack, killEnergy);
+        runManager->SetUserAction(stacking_action);
+    }
 
     // Initialize G4 kernel
     runManager->Initialize();
 
     physWorld->PostInitialize();
+    if (looperThresholds) {
+        SteppingAction::SetLooperThresholds(looperWarnE, looperImportantE, looperTrials);
+    }
+    if (importanceWorld != NULL) {
+        importanceWorld->CreateImportanceStore();
+    }
+    if (xsBiasOperator != NULL) {
+        if (not physWorld->GetHasTarget()) {
+            G4cerr << "Error: --xsBias requires a target." << G4endl;
+            exit(1);
+        }
+        xsBiasOperator->AttachTo(physWorld->getTargetLV());
+        xsBiasOperator->Print();
+    }
+    if (fastTarget != "") {
+        if (not physWorld->GetHasTarget()) {
+            G4cerr << "Error: --fastTarget requires a target." << G4endl;
+            exit(1);
+        }
+        TargetFastSimModel* fastSimModel =
+            new TargetFastSimModel("TargetFastSimModel",
+                                   G4RegionStore::GetInstance()->GetRegion("target_region"),
+                                   fastTarget == "validate");
+        fastSimModel->Print();
+    }
+    if (fieldBenchmark > 0) {
+        for (auto mag : physWorld->magnets) {
+            mag->BenchmarkField(fieldBenchmark);
+        }
+    }
+    if (navigationBenchmark > 0) {
+        for (auto mag : physWorld->magnets) {
+            mag->BenchmarkNavigation(navigationBenchmark);
+        }
+    }
 
     //Set root file output filename
     RootFileWriter::GetInstance()->setFilename(filename_out);
@@ -623,6 +1190,10 @@ int main(int argc,char** argv) {
     RootFileWriter::GetInstance()->setPositionCutoffR(cutoff_radius);
     RootFileWriter::GetInstance()->setEdepDensDZ(edep_dens_dz);
     RootFileWriter::GetInstance()->setEngNbins(engNbins); // 0 = auto
+    RootFileWriter::GetInstance()->setPhaseSpaceOut(phaseSpaceOut);
+    RootFileWriter::GetInstance()->setDriftProjections(driftProjections);
+    RootFileWriter::GetInstance()->setFastSimValidation(fastTarget == "validate");
+    RootFileWriter::GetInstance()->setEventBudget(eventStepBudget > 0 or eventTimeBudget > 0.0);
     RootFileWriter::GetInstance()->setNumEvents(numEvents); // May be 0
 
 #ifdef G4VIS_USE
@@ -636,6 +1207,9 @@ int main(int argc,char** argv) {
     // Get the pointer to the User Interface manager
     G4UImanager* UImanager = G4UImanager::GetUIpointer();
 
+    // -n counts primaries; the last event takes the remainder
+    const G4int numG4Events = (numEvents + primariesPerEvent - 1) / primariesPerEvent;
+
     if (argc_effective != 1) { // batch mode
         if (useGUI) {
             G4cout << "UseGUI is not compatible with batch mode!" << G4endl;
@@ -652,8 +1226,8 @@ int main(int argc,char** argv) {
         UImanager->ApplyCommand("/control/execute vis.mac");
 #endif
         if (numEvents > 0) {
-            G4cout << G4String("'/run/beamOn ") + std::to_string(numEvents) << "'" << G4endl;
-            UImanager->ApplyCommand(G4String("/run/beamOn ") + std::to_string(numEvents));
+            G4cout << G4String("'/run/beamOn ") + std::to_string(numG4Events) << "'" << G4endl;
+            UImanager->ApplyCommand(G4String("/run/beamOn ") + std::to_string(numG4Events));
         }
 
         if (ui->IsGUI())
@@ -664,8 +1238,8 @@ int main(int argc,char** argv) {
 
     //Run given number of events
     if (useGUI==false and numEvents > 0) {
-        G4cout << G4String("'/run/beamOn ") + std::to_string(numEvents) << "'" << G4endl;
-        UImanager->ApplyCommand(G4String("/run/beamOn ") + std::to_string(numEvents));
+        G4cout << G4String("'/run/beamOn ") + std::to_string(numG4Events) << "'" << G4endl;
+        UImanager->ApplyCommand(G4String("/run/beamOn ") + std::to_string(numG4Events));
     }
 
     G4cout <<"Done." << G4endl;
@@ -701,6 +1275,7 @@ void printHelp(G4double target_thick,
                G4double beam_offset,
                G4double beam_zpos,
                G4double beam_rCut,
+               G4String covarMatrixString,
                G4bool   doBacktrack,
                G4int    rngSeed,
                G4String filename_out,
@@ -711,7 +1286,31 @@ void printHelp(G4double target_thick,
                G4double cutoff_radius,
                G4double edep_dens_dz,
                G4int    engNbins,
-               std::vector<G4String> &magnetDefinitions) {
+               std::vector<G4double> &scoringPlanes,
+               std::vector<G4double> &targetPlanes,
+               std::vector<G4double> &driftProjections,
+               std::vector<G4String> &magnetDefinitions,
+               G4bool   killAfterTracker,
+               G4bool   killBackward,
+               std::map<G4int,G4double> &killEnergy,
+               std::set<G4int> &noStack,
+               G4double looperWarnE,
+               G4double looperImportantE,
+               G4int    looperTrials,
+               G4int    eventStepBudget,
+               G4double eventTimeBudget,
+               G4int    primariesPerEvent,
+               std::vector<G4String> &regionDefinitions,
+               G4String importanceDefinition,
+               G4String xsBiasDefinition,
+               G4String phaseSpaceOut,
+               G4String phaseSpaceIn,
+               G4String beamFileIn,
+               std::vector<G4String> &beamHistDefinitions,
+               G4String fastTarget,
+               G4int fieldBenchmark,
+               G4int navigationBenchmark,
+               G4bool massWorldScoring) {
             G4cout << "Welcome to MiniScatter!" << G4endl
                    << G4endl
                    << "Usage/options:" << G4endl;
@@ -773,13 +1372,19 @@ void printHelp(G4double target_thick,
                    << " Set realistic beam distribution (on target surface); " << G4endl
                    << " if optional part given then x,y are treated separately" << G4endl;
 
+            G4cout << "--covarMatrix s11,s12,...,snn : " << G4endl
+                   << " Set a gaussian beam distribution from a full covariance matrix, possibly with x-y coupling." << G4endl
+                   << " Give the upper triangle row by row: 10 numbers for 4D (x[m], x'[rad], y[m], y'[rad])," << G4endl
+                   << " or 21 numbers for 6D (adding z[m] and dE/E). Can not be combined with -c." << G4endl;
+
             G4cout << "--beamRcut <double> : Radial cutoff for the beam distribution." << G4endl
                    << " If given alone, generate a circular uniform distribution." << G4endl
                    << " If given together with -c, generate a multivariate gaussian with all particles starting within the given radius." << G4endl
                    << " Default/current value = " << beam_rCut << G4endl;
 
             G4cout << "-s <int>    : Set the initial seed,   default/current value = "
-                   << rngSeed << G4endl;
+                   << rngSeed << G4endl
+                   << " The beam sampling (-c, --beamRcut, ...) uses a separate random stream from the same seed." << G4endl;
 
             G4cout << "-g : Use a GUI" << G4endl;
 
@@ -807,6 +1412,42 @@ void printHelp(G4double target_thick,
             G4cout << "--engNbins             : Number of bins for 1D energy histograms (0 => internal default), "
                    << "default/current value = " << engNbins << G4endl;
 
+            G4cout << "--plane z(,z,...)      : Add thin vacuum scoring planes at the given z positions [mm]," << G4endl
+                   << " in addition to the tracker at -d. Each plane 'plane_<i>' (numbered from 1 in the given order)" << G4endl
+                   << " gets the same histograms, Twiss parameters and particle counts as the tracker," << G4endl
+                   << " so that a distance scan can be done in a single run." << G4endl
+                   << " The planes must not overlap the target, the tracker, the objects or each other," << G4endl
+                   << " and are not supported with a rotated target or detector." << G4endl
+                   << " Current settings:";
+            for (auto z : scoringPlanes) {
+                G4cout << " " << z;
+            }
+            G4cout << " [mm]" << G4endl;
+
+            G4cout << "--targetPlane d(,d,...) : Add scoring planes inside the target at the given depths" << G4endl
+                   << " from its upstream face [mm]. Each plane 'target_plane_<i>' records the particles crossing it" << G4endl
+                   << " in the forward direction, with the same histograms and particle counts as the target exit." << G4endl
+                   << " This approximates the target exit for thinner targets (ignoring backscattering from the" << G4endl
+                   << " material downstream of the plane), so that a thickness scan can be done in a single run." << G4endl
+                   << " The planes are in a parallel world, and only limit the step lengths in the target." << G4endl
+                   << " Current settings:";
+            for (auto d : targetPlanes) {
+                G4cout << " " << d;
+            }
+            G4cout << " [mm]" << G4endl;
+
+            G4cout << "--project z(,z,...)    : Project the phase space of the particles leaving the target," << G4endl
+                   << " or the most downstream object, in straight lines through the vacuum" << G4endl
+                   << " to the given z positions [mm] after each event, without any further tracking." << G4endl
+                   << " Each 'projection_<i>' gets the same histograms, Twiss parameters" << G4endl
+                   << " and particle counts as the tracker; particles outside the tracker area are counted as lost," << G4endl
+                   << " and the (weighted) number lost at each projection is written as 'projection_lost'." << G4endl
+                   << " Current settings:";
+            for (auto z : driftProjections) {
+                G4cout << " " << z;
+            }
+            G4cout << " [mm]" << G4endl;
+
             G4cout << "--object/--magnet (*)pos:type:length:gradient(:type=val1:specific=val2:arguments=val3) : "
                    << " Create an object (which may be a magnet) of the given type at the given position. " << G4endl
                    << " If a '*' is prepended the position (<double> [mm]), the position is the " << G4endl
@@ -820,6 +1461,18 @@ void printHelp(G4double target_thick,
                    << "     yOffset:   Center offset in Y (<double> [mm]) " << G4endl
                    << "     xRot:      Rotation around horizontal axis (<double> [mm])" << G4endl
                    << "     yRot:      Rotation around vertical axis (<double> [mm])" << G4endl
+                   << " Field integration key=val pairs (for PLASMA1 and FIELDMAP1):" << G4endl
+                   << "     stepper:   ClassicalRK4 (default), DormandPrince745, BogackiShampine23," << G4endl
+                   << "                BogackiShampine45, CashKarpRKF45, NystromRK4 (pure magnetic fields)," << G4endl
+                   << "                or PlasmaLens (PLASMA1 only; analytic inside the capillary, ClassicalRK4 outside)" << G4endl
+                   << "     minStep:   Minimum step for the chord finder (<double> [mm])" << G4endl
+                   << "     deltaChord, deltaOneStep, deltaIntersection: Integration accuracy (<double> [mm])" << G4endl
+                   << "     epsMin, epsMax: Minimum / maximum relative integration accuracy (<double>)" << G4endl
+                   << "     Parameters that are not given use the Geant4 defaults." << G4endl
+                   << "     fieldVolume: Volume with the field; 'main' (default) is the whole object slab," << G4endl
+                   << "                'crystal' or 'capillary' for PLASMA1, 'map' (grid extent) for FIELDMAP1." << G4endl
+                   << "     fieldMargin: Margin added around the crystal or map field volume (<double> [mm])" << G4endl
+                   << "     fieldMaxStep: Maximum step length inside the field volume (<double> [mm])" << G4endl
                    << "   Note that the offset is applied first," << G4endl
                    << "     then the object is rotated around the offset point." << G4endl
                    << "     The xRot is applied before the yRot." << G4endl
@@ -830,21 +1483,182 @@ void printHelp(G4double target_thick,
                    << "                as the total current [A] instead of in [T/m]." << G4endl
                    << "     width:     Capillay crystal width (<double> [mm])" << G4endl
                    << "     height:    Capillay crystal height (<double> [mm])" << G4endl
+                   << "     booleanHole: Flag (<True/False>) to build the crystal as a G4SubtractionSolid" << G4endl
+                   << "                instead of a box with a vacuum capillary daughter volume (default)." << G4endl
+                   << "     fastOptics: Flag (<True/False>) to move particles entering the capillary directly" << G4endl
+                   << "                to the exit with the thick-lens transfer map of the linear field." << G4endl
+                   << "                Particles that would touch the crystal are tracked normally." << G4endl
                    << "  'COLLIMATOR1':" << G4endl
                    << "     radius:    Channel radius (<double> [mm])" << G4endl
                    << "     width:     Absorber width (<double> [mm])" << G4endl
                    << "     height:    Absorber height (<double> [mm])" << G4endl
                    << "     material:  Absorber material (similar to -m)" << G4endl
+                   << "     booleanHole: Flag (<True/False>) to build the absorber as a G4SubtractionSolid" << G4endl
+                   << "                instead of a box with a vacuum channel daughter volume (default)." << G4endl
+                   << "     absorb:    Flag (<True/False>) to kill all particles entering the absorber," << G4endl
+                   << "                depositing their kinetic energy; they are counted as '<name>_absorbed'." << G4endl
                    << "  'TARGET':" << G4endl
                    << "     width:     Target width (<double> [mm])" << G4endl
                    << "     height:    Target height (<double> [mm])" << G4endl
-                   << "     material:  Target material (similar to -m)" << G4endl;
+                   << "     material:  Target material (similar to -m)" << G4endl
+                   << "     absorb:    Flag (<True/False>), same as for COLLIMATOR1." << G4endl
+                   << "  'FIELDMAP1':" << G4endl
+                   << "     file:      Field map file; the gradient parameter is used as a scale factor." << G4endl
+                   << "                Format ([mm], [T], '#' for comments): A header line" << G4endl
+                   << "                '1D nr rmin rmax', '2D nr rmin rmax nz zmin zmax' or" << G4endl
+                   << "                '3D nx xmin xmax ny ymin ymax nz zmin zmax', followed by one line" << G4endl
+                   << "                'Br Btheta Bz' (1D/2D) or 'Bx By Bz' (3D) per grid point," << G4endl
+                   << "                with the first coordinate varying fastest." << G4endl
+                   << "                Coordinates are relative to the object center; the field is zero outside the grid." << G4endl;
 
             G4cout << "Currently have the following magnet setups:" << G4endl;
             for (auto mag : magnetDefinitions) {
                 G4cout << mag << G4endl;
             }
 
+            G4cout << "--killAfterTracker     : Kill all tracks downstream of the last scoring plane "
+                   << "(tracker or object exit), default/current value = "
+                   << (killAfterTracker?"true":"false") << G4endl;
+
+            G4cout << "--killBackward         : Kill all backwards-going tracks upstream of the target "
+                   << "(or first object), default/current value = "
+                   << (killBackward?"true":"false") << G4endl;
+
+            G4cout << "--killEnergy PDG:E[MeV](,PDG:E[MeV],...) : "
+                   << "Kill all tracks of the given species with kinetic energy below E." << G4endl
+                   << " Tracks inside the target and the magnets are not killed, so their energy deposit is kept;" << G4endl
+                   << " however tracks killed elsewhere never reach them, which changes the scored energy deposit." << G4endl
+                   << " Current settings:";
+            for (auto it : killEnergy) {
+                G4cout << " " << it.first << ":" << it.second/MeV;
+            }
+            G4cout << G4endl;
+
+            G4cout << "--looperThresholds warnE[MeV]:importantE[MeV]:trials : " << G4endl
+                   << " Thresholds for killing particles looping in a field: Loopers below warnE are killed silently," << G4endl
+                   << " loopers below importantE are killed after one attempt, and loopers above importantE" << G4endl
+                   << " are killed after the given number of trials. Use -1 to keep the Geant4 default." << G4endl
+                   << " Killed loopers and the time spent on them are reported at the end of the run." << G4endl
+                   << " Current settings: " << looperWarnE/MeV << ":" << looperImportantE/MeV << ":" << looperTrials << G4endl;
+
+            G4cout << "--eventBudget maxSteps(:maxTime[s]) : " << G4endl
+                   << " Kill all remaining tracks of an event after the given number of steps" << G4endl
+                   << " or wall-clock time; 0 => no limit. The killed tracks are counted as 'killed_budget'." << G4endl
+                   << " Their energy is missing from the energy deposits; the aborted events are counted, and their" << G4endl
+                   << " killed kinetic energy is written to the histogram 'budget_killed_energy'." << G4endl
+                   << " Current settings: " << eventStepBudget << ":" << eventTimeBudget << G4endl;
+
+            G4cout << "--primariesPerEvent <int> : " << G4endl
+                   << " Put several independently generated primaries into each event, which reduces the per-event" << G4endl
+                   << " overhead for thin or no targets. -n still gives the number of primaries, and the output" << G4endl
+                   << " (energy deposits, particle counts, eventIDs) is still per primary." << G4endl
+                   << " The --eventBudget applies to the whole event. Can not be combined with --phaseSpaceIn." << G4endl
+                   << " Default/current value = " << primariesPerEvent << G4endl;
+
+            G4cout << "--noStack PDG(,PDG,...) : Never track secondaries of the given species, "
+                   << "e.g. '22' for photons or '2112' for neutrons." << G4endl
+                   << " Current settings:";
+            for (auto PDG : noStack) {
+                G4cout << " " << PDG;
+            }
+            G4cout << G4endl;
+            G4cout << " Killed tracks are counted as particle types 'killed_<reason>' at the end of the run." << G4endl;
+
+            G4cout << "--region name(:key=val:key=val...) : Physics settings for a part of the geometry." << G4endl
+                   << " The name is 'world', 'target', or the name of an object ('magnet_1', 'magnet_2', ...)." << G4endl
+                   << " Accepted keys:" << G4endl
+                   << "     cut:        Production cut for gamma, e-, e+ and proton (<double> [mm])," << G4endl
+                   << "                 for 'world' this is the default for all regions (normally 0.1 mm)." << G4endl
+                   << "     em:         EM physics option, e.g. 'G4EmStandard_opt4', 'G4EmStandardSS' or 'G4EmLivermore'," << G4endl
+                   << "                 this sets the msc model and step limitation (not for 'world')." << G4endl
+                   << "     maxStep:    Maximum step length (<double> [mm])" << G4endl
+                   << "     inactivate: Comma-separated list of processes to switch off, e.g. 'msc,eIoni,eBrem,annihil'." << G4endl
+                   << "                 If used for 'world', the target and all objects automatically get their own regions." << G4endl
+                   << " Currently have the following region setups:" << G4endl;
+            for (auto reg : regionDefinitions) {
+                G4cout << " " << reg << G4endl;
+            }
+
+            G4cout << "--importance R:r1,r2,...:ratio(:particles) or Z:n:ratio(:particles) : " << G4endl
+                   << " Use importance biasing (geometric splitting and Russian roulette)." << G4endl
+                   << " 'R' makes concentric cylinders along z with radius r1 < r2 < ... [mm]," << G4endl
+                   << "   where the importance is multiplied by 'ratio' for each shell going outwards." << G4endl
+                   << " 'Z' makes n slabs of equal thickness through the target," << G4endl
+                   << "   where the importance is multiplied by 'ratio' for each slab going downstream." << G4endl
+                   << " 'particles' is a comma-separated list of particle names to bias, default 'e-,e+,gamma,proton'." << G4endl
+                   << " All histograms, statistics and TTrees are filled with the track weights." << G4endl
+                   << " Current setting: '" << importanceDefinition << "'" << G4endl;
+
+            G4cout << "--xsBias factor(:particles=a,b,...)(:processes=a,b,...) : " << G4endl
+                   << " Multiply the cross sections of the discrete processes in the target by 'factor'," << G4endl
+                   << " using the Geant4 generic biasing. Useful for thin or low-pressure gas targets." << G4endl
+                   << " 'particles' is a comma-separated list of particle names to bias, default 'e-,e+,gamma,proton'." << G4endl
+                   << " 'processes' is a comma-separated list of process names to bias, default all." << G4endl
+                   << " Processes without a discrete part (e.g. multiple scattering) are not affected." << G4endl
+                   << " All histograms, statistics and TTrees are filled with the track weights." << G4endl
+                   << " Current setting: '" << xsBiasDefinition << "'" << G4endl;
+
+            G4cout << "--phaseSpaceOut <filename> : " << G4endl
+                   << " Write all particles exiting the downstream face of the target going forward" << G4endl
+                   << " (position, momentum, energy, weight, eventID)" << G4endl
+                   << " to a compact binary file, for use with --phaseSpaceIn." << G4endl
+                   << " Current setting: '" << phaseSpaceOut << "'" << G4endl;
+
+            G4cout << "--phaseSpaceIn <filename> : " << G4endl
+                   << " Instead of generating the beam, start each event with the particles that exited" << G4endl
+                   << " the target in one event of a run with --phaseSpaceOut." << G4endl
+                   << " This allows scanning the downstream objects without re-simulating the target." << G4endl
+                   << " Requires running without a target (-t 0); use the same beam energy and type as when writing." << G4endl
+                   << " The file is read while running and restarted from the beginning if it runs out." << G4endl
+                   << " Current setting: '" << phaseSpaceIn << "'" << G4endl;
+
+            G4cout << "--beamFile <filename>(,resample) : " << G4endl
+                   << " Instead of generating the beam, read one particle per event (x, x', y, y', E, PDG, weight)" << G4endl
+                   << " from a binary beam file, as written by writeBeamFile() in scripts/miniScatterDriver.py." << G4endl
+                   << " The particles start at the -z position like a generated beam; -e and -b still set the nominal beam." << G4endl
+                   << " The file is read in chunks, and restarted from the beginning if it runs out." << G4endl
+                   << " With ',resample', the file is memory mapped and the particles are picked at random." << G4endl
+                   << " Can not be combined with --phaseSpaceIn, -c, --covarMatrix, --beamRcut, or a flat energy distribution." << G4endl
+                   << " Current setting: '" << beamFileIn << "'" << G4endl;
+
+            G4cout << "--beamHist <filename>:<histname>:xy|xxp|yyp : " << G4endl
+                   << " Sample two of the beam coordinates from a 2D histogram (TH2) in a ROOT file," << G4endl
+                   << " e.g. a screen image (xy) or a phase space (xxp or yyp) such as init_phasespaceX." << G4endl
+                   << " The axis units are [mm] for x,y and [rad] for x',y'." << G4endl
+                   << " The other coordinates are generated as usual, e.g. by -c." << G4endl
+                   << " May be given once for xxp and once for yyp. Can not be combined with --beamRcut." << G4endl
+                   << " Current settings:";
+            for (auto beamHist : beamHistDefinitions) {
+                G4cout << " '" << beamHist << "'";
+            }
+            G4cout << G4endl;
+
+            G4cout << "--fastTarget on|validate : " << G4endl
+                   << " Use a parameterised model for charged particles crossing a thin target," << G4endl
+                   << " moving them directly from the front to the back face." << G4endl
+                   << " The exit angle and displacement are sampled from the Highland formula," << G4endl
+                   << " and the energy loss from the Urban (Landau/Vavilov) straggling model; no secondaries are made." << G4endl
+                   << " Tracks losing more than 10% of their energy are simulated normally." << G4endl
+                   << " 'validate' runs the full simulation, and writes the model predictions to the histograms" << G4endl
+                   << " fastsim_validate_exit_angle and fastsim_validate_exit_energy for comparison." << G4endl
+                   << " Current setting: '" << fastTarget << "'" << G4endl;
+
+            G4cout << "--fieldBenchmark <int> : " << G4endl
+                   << " Before running, time the given number of field evaluations at random points" << G4endl
+                   << " inside each magnet with a field, and print the time per call." << G4endl
+                   << " Current setting: " << fieldBenchmark << G4endl;
+
+            G4cout << "--navigationBenchmark <int> : " << G4endl
+                   << " Before running, time the given number of geometry navigation calls (locate + compute step)" << G4endl
+                   << " at random points and directions inside each magnet, and print the time per call." << G4endl
+                   << " Current setting: " << navigationBenchmark << G4endl;
+
+            G4cout << "--massWorldScoring : Score the magnet exits and energy deposits with sensitive detectors" << G4endl
+                   << " on the magnet volumes themselves, instead of on copies in a parallel world." << G4endl
+                   << " This removes the parallel world navigation from every step." << G4endl
+                   << " Only the crossings of the downstream face are recorded in both cases." << G4endl
+                   << " Default/current value = " << (massWorldScoring?"true":"false") << G4endl;
+
             G4cout << G4endl
                    << G4endl;
 
@@ -0,0 +1,45 @@
+/*
+ * This file is part of MiniScatter.
+ *
+ *  MiniScatter is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  MiniScatter is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with MiniScatter.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef AbsorberFastSimModel_h
+#define AbsorberFastSimModel_h 1
+
+#include "G4VFastSimulationModel.hh"
+#include "globals.hh"
+
+//--------------------------------------------------------------------------------
+
+// "Black absorber": Every track entering the envelope volume (not its daughters) is killed immediately,
+// and its kinetic energy is deposited at the entry point.
+// The killed tracks are counted per species in the RootFileWriter as counterName.
+
+class AbsorberFastSimModel : public G4VFastSimulationModel {
+public:
+    AbsorberFastSimModel(G4String modelName, G4Region* envelope, G4String counterName_in);
+    virtual ~AbsorberFastSimModel(){};
+
+    virtual G4bool IsApplicable(const G4ParticleDefinition&) { return true; };
+    virtual G4bool ModelTrigger(const G4FastTrack& fastTrack);
+    virtual void   DoIt(const G4FastTrack& fastTrack, G4FastStep& fastStep);
+
+private:
+    G4String counterName;
+};
+
+//--------------------------------------------------------------------------------
+
+#endif
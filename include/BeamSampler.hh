@@ -0,0 +1,109 @@
+/*
+ * This file is part of MiniScatter.
+ *
+ *  MiniScatter is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  MiniScatter is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with MiniScatter.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef BeamSampler_h
+#define BeamSampler_h 1
+
+#include "globals.hh"
+#include "CLHEP/Random/MixMaxRng.h"
+
+//System of units defines variables like "s" and "m" in the global scope,
+// which are then shadowed inside functions in the header. Let's ignore it.
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wshadow"
+#include "TMatrixDfwd.h"
+#pragma GCC diagnostic pop
+
+#include <vector>
+
+// -----------------------------------------------------------------------------------------
+
+// Random number source for the beam generation.
+// Correlated gaussian vectors are sampled a block at a time:
+// the uniforms are drawn in one go from a private MixMax engine (a separate stream from G4Random),
+// converted with Box-Muller, and multiplied by the Cholesky factor of the covariance matrix.
+// The primaries are then served from the block buffer.
+// With a radial cut, (x,y) are sampled directly from the truncated distribution,
+// and the other coordinates from their gaussian distribution conditional on (x,y);
+// the cost per sample does not depend on how tight the cut is.
+
+class BeamSampler {
+public:
+    BeamSampler(G4long seed, G4int blockSize_in = 4096);
+
+    // Set the covariance matrix (up to 6x6) and compute its Cholesky factor
+    void SetCovariance(const TMatrixD& covar);
+    G4int GetDim() const {return dim;};
+
+    // Only generate samples with (x0+x)^2 + (y0+y)^2 <= R^2, where x and y are coordinates 0 and 2.
+    // Must be called after SetCovariance(); units as in the covariance matrix.
+    void SetRadialCut(G4double R, G4double x0, G4double y0);
+
+    // The next correlated gaussian vector, of length GetDim()
+    const G4double* NextGaussian() {
+        if (blockPos == blockSize) {
+            if (hasCut) FillBlockCut();
+            else        FillBlock();
+        }
+        return &(block[dim*(blockPos++)]);
+    };
+
+    // Uniform in (0,1)
+    G4double Uniform() {return engine.flat();};
+
+    static const G4int maxDim = 6;
+    static const G4int streamID = 1; // MixMax stream of the beam, G4Random uses the seed alone
+
+private:
+    void FillNormals();
+    void FillBlock();
+    void FillBlockCut();
+    // Gaussian with standard deviation sigma truncated to [lo,hi], by inverse CDF from the uniform u
+    static G4double TruncatedGaussian(G4double lo, G4double hi, G4double sigma, G4double u);
+
+    CLHEP::MixMaxRng engine;
+
+    G4int dim = 0;
+    G4double C[maxDim][maxDim]; // Covariance matrix
+    G4double L[maxDim][maxDim]; // Lower-triangular Cholesky factor, covar = L*L^T
+
+    // Radial cut; (x,y) are sampled in the principal axes frame (a1,a2) of their covariance,
+    // in which the cut is a circle centered on (cutC1,cutC2).
+    G4bool   hasCut = false;
+    G4bool   cutRound;        // Round beam centered in the cut, sample the radius directly
+    G4double cutR;
+    G4double cutC1, cutC2;
+    G4double cutSig1, cutSig2;
+    G4double cutCos, cutSin;  // (x,y) = a1*(cos,sin) + a2*(-sin,cos)
+    std::vector<G4double> cutTableA;   // Tabulated CDF of the a1 marginal inside the cut
+    std::vector<G4double> cutTableCDF;
+    G4int    numOther;                 // Coordinates other than (x,y), given (x,y):
+    G4int    idxOther[maxDim];         //  v[idxOther[i]] = K[i]*(x,y) + Lcond[i]*n
+    G4double K[maxDim][2];
+    G4double Lcond[maxDim][maxDim];
+    std::vector<G4double> cutUniforms;
+
+    G4int blockSize;
+    G4int blockPos;
+    std::vector<G4double> uniforms;
+    std::vector<G4double> normals;
+    std::vector<G4double> block;
+};
+
+// -----------------------------------------------------------------------------------------
+
+#endif
@@ -0,0 +1,84 @@
+/*
+ * This file is part of MiniScatter.
+ *
+ *  MiniScatter is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  MiniScatter is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with MiniScatter.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef CrossSectionBiasing_h
+#define CrossSectionBiasing_h 1
+
+#include "G4VBiasingOperator.hh"
+#include "globals.hh"
+
+#include <map>
+#include <vector>
+
+class G4BOptnChangeCrossSection;
+class G4ParticleDefinition;
+class G4VModularPhysicsList;
+
+//--------------------------------------------------------------------------------
+
+// Scales the cross sections of the discrete physics processes by a constant factor
+// inside the volumes it is attached to (normally the target), using the Geant4
+// generic biasing framework. This makes interactions in thin or low-pressure targets
+// more frequent, and the track weights are corrected accordingly.
+// Parsed from a string 'factor(:particles=a,b,...)(:processes=a,b,...)',
+// see printHelp() in MiniScatter.cc.
+
+class CrossSectionBiasingOperator : public G4VBiasingOperator {
+public:
+    CrossSectionBiasingOperator(G4String inputString);
+    virtual ~CrossSectionBiasingOperator(){};
+
+    // Register the G4GenericBiasingPhysics; call before runManager->Initialize()
+    void ConfigurePhysics(G4VModularPhysicsList* physlist);
+
+    void Print();
+
+    // Create the biasing operations, one per wrapped process
+    virtual void StartRun();
+
+private:
+    virtual G4VBiasingOperation* ProposeOccurenceBiasingOperation(const G4Track* track,
+                                                                  const G4BiasingProcessInterface* callingProcess);
+    virtual G4VBiasingOperation* ProposeFinalStateBiasingOperation(const G4Track*,
+                                                                   const G4BiasingProcessInterface*) {
+        return 0;
+    };
+    virtual G4VBiasingOperation* ProposeNonPhysicsBiasingOperation(const G4Track*,
+                                                                   const G4BiasingProcessInterface*) {
+        return 0;
+    };
+
+    using G4VBiasingOperator::OperationApplied;
+    virtual void OperationApplied(const G4BiasingProcessInterface* callingProcess,
+                                  G4BiasingAppliedCase biasingCase,
+                                  G4VBiasingOperation* occurenceOperationApplied,
+                                  G4double weightForOccurenceInteraction,
+                                  G4VBiasingOperation* finalStateOperationApplied,
+                                  const G4VParticleChange* particleChangeProduced);
+
+    G4double factor = 1.0;                  // Cross section multiplier
+    std::vector<G4String> particleNames;     // Particles to bias
+    std::vector<G4String> processNames;      // Processes to bias; empty => all physics processes
+
+    std::vector<const G4ParticleDefinition*> particlesToBias;
+    std::map<const G4BiasingProcessInterface*, G4BOptnChangeCrossSection*> changeCrossSectionOperations;
+    G4bool isSetup = false;
+};
+
+//--------------------------------------------------------------------------------
+
+#endif
@@ -22,11 +22,13 @@
 #include "G4Box.hh"
 #include "G4LogicalVolume.hh"
 #include "G4VPhysicalVolume.hh"
+#include "G4VTouchable.hh"
 #include "G4Material.hh"
 
 #include <vector>
 
 class MagnetBase; // Forward declaration
+class RegionDefinition;
 
 //--------------------------------------------------------------------------------
 
@@ -41,7 +43,8 @@ public:
                          G4double TargetAngle_in,
                          G4bool   TargetRotated_in,
                          G4double WorldSize_in,
-                         std::vector <G4String> &magnetDefinitions_in);
+                         std::vector <G4String> &magnetDefinitions_in,
+                         std::vector <G4String> &regionDefinitions_in);
     ~DetectorConstruction(){};
 
 private:
@@ -57,18 +60,46 @@ public:
     //    void SetMagField(G4double);
     G4VPhysicalVolume* Construct();
     void PostInitialize(); // To be called after construct, but before tracking starts
+
+    // True if the given mass-world touchable is inside the target or the material of one of the magnets,
+    // i.e. where the energy deposit is scored.
+    G4bool IsInScoringVolume(const G4VTouchable* touchable) const;
+
+    // Score the magnet exits with SDs on the magnet volumes in the mass world,
+    // instead of in the MagnetSensorWorld parallel world. Must be set before Construct().
+    void SetMassWorldScoring(G4bool massWorldScoring_in) {massWorldScoring = massWorldScoring_in;};
+    G4bool GetMassWorldScoring() const {return massWorldScoring;};
+
+    // Extra thin scoring planes at the given z positions [mm],
+    // each with a MyTrackerSD named GetScoringPlaneName(i). Must be set before Construct().
+    void SetScoringPlanes(std::vector<G4double> &scoringPlanes_in);
+    const std::vector<G4double>& GetScoringPlanes() const {return scoringPlanes;};
+    static G4String GetScoringPlaneName(size_t idx) {return "plane_" + std::to_string(idx+1);};
+
+    // Scoring planes inside the target at the given depths from its upstream face [mm].
+    // They are built in the MagnetSensorWorld parallel world, each with a MyTrackerSD
+    // named GetTargetPlaneName(i). Must be set before Construct().
+    void SetTargetPlanes(std::vector<G4double> &targetPlanes_in);
+    const std::vector<G4double>& GetTargetPlanes() const {return targetPlanes;};
+    G4double GetTargetPlaneZ(size_t idx) const {return -TargetThickness/2.0 + targetPlanes[idx] + DetectorThickness/2.0;};
+    static G4String GetTargetPlaneName(size_t idx) {return "target_plane_" + std::to_string(idx+1);};
 public:
 
     const G4VPhysicalVolume* getphysiWorld() {return physiWorld;};
     const G4VPhysicalVolume* getTargetPV()   {return physiTarget;};
+    G4LogicalVolume*         getTargetLV()   {return logicTarget;};
 
     inline G4double getTargetThickness() const {return TargetThickness;};
     inline G4double getTargetSizeX()     const {return TargetSizeX;};
     inline G4double getTargetSizeY()     const {return TargetSizeY;};
+    inline G4double getTargetAngle()     const {return TargetAngle;};
+    inline G4bool   getTargetRotated()   const {return TargetRotated;};
 
     inline G4double getDetectorDistance() const {return DetectorDistance;};
     inline G4double getDetectorSizeX()    const {return TargetSizeX;};
     inline G4double getDetectorSizeY()    const {return TargetSizeY;};
+    inline G4double getDetectorThickness() const {return DetectorThickness;};
+    inline G4bool   getDetectorRotated()  const {return DetectorRotated;};
 
     inline G4double getWorldSizeZ()       const {return WorldSizeZ;};
     inline G4double getWorldSizeX()       const {return WorldSizeX;};
@@ -140,9 +171,16 @@ private:
 public:
     // This one needs to be accessed by e.g. the rootFileWriter
     std::vector <MagnetBase*> magnets;
+    // Needed by main() to set up the per-region physics
+    std::vector <RegionDefinition*> regions;
 private:
     std::vector <G4VPhysicalVolume*> magnetPVs;
 
+    G4bool massWorldScoring = false;
+
+    std::vector<G4double> scoringPlanes; // [G4 units]
+    std::vector<G4double> targetPlanes;  // Depths [G4 units]
+
 private:
     void DefineMaterials();
     G4Material* DefineGas(G4String TargetMaterial_in);
@@ -0,0 +1,57 @@
+/*
+ * This file is part of MiniScatter.
+ *
+ *  MiniScatter is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  MiniScatter is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with MiniScatter.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef DriftProjection_h
+#define DriftProjection_h 1
+
+#include "globals.hh"
+
+#include <vector>
+
+//--------------------------------------------------------------------------------
+
+// Structure-of-arrays buffer of the particles leaving the last piece of material
+// (target or object) in one event, used for projecting them through the downstream vacuum
+// to any z position without further tracking.
+// Positions in [mm], slopes px/pz and py/pz, kinetic energy in [MeV].
+
+class DriftBuffer {
+public:
+    void Add(G4double x_in, G4double y_in, G4double z_in,
+             G4double xp_in, G4double yp_in, G4double E_in,
+             G4double weight_in, G4int PDG_in, G4int charge_in, G4int primaryIdx_in);
+    void Clear();
+    size_t size() const {return x.size();};
+
+    // Straight-line projection of all the stored particles to zProj [mm]
+    void Project(G4double zProj, std::vector<G4double>& xOut, std::vector<G4double>& yOut) const;
+
+    std::vector<G4double> x;
+    std::vector<G4double> y;
+    std::vector<G4double> z;
+    std::vector<G4double> xp;
+    std::vector<G4double> yp;
+    std::vector<G4double> E;
+    std::vector<G4double> weight;
+    std::vector<G4int>    PDG;
+    std::vector<G4int>    charge;
+    std::vector<G4int>    primaryIdx;
+};
+
+//--------------------------------------------------------------------------------
+
+#endif
@@ -0,0 +1,67 @@
+/*
+ * This file is part of MiniScatter.
+ *
+ *  MiniScatter is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  MiniScatter is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with MiniScatter.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef HistogramSampler_h
+#define HistogramSampler_h 1
+
+#include "globals.hh"
+
+#include <vector>
+
+// -----------------------------------------------------------------------------------------
+
+// Sample two beam coordinates from a measured 2D distribution, e.g. a screen image (x,y)
+// or a phase space histogram (x,x'), stored as a TH2 in a ROOT file.
+// The bins are picked with a Walker/Vose alias table, built once,
+// so each sample costs the same regardless of the number of bins;
+// the position inside the bin is uniform.
+// Axis units are [mm] for x,y and [rad] for x',y', as in the init_phasespace* histograms.
+
+class HistogramSampler {
+public:
+    // Definition format: 'fileName:histName:coords', with coords one of xy, xxp, yyp
+    HistogramSampler(G4String definition);
+
+    // Sample a point (a,b) in axis units, from 4 uniforms in [0,1)
+    void Sample(G4double u1, G4double u2, G4double u3, G4double u4, G4double& a, G4double& b) const;
+
+    // Beam coordinate index of each axis, 0=x, 1=x', 2=y, 3=y'
+    G4int GetCoordA() const {return coordA;};
+    G4int GetCoordB() const {return coordB;};
+
+    void Print();
+
+private:
+    G4String fileName;
+    G4String histName;
+    G4String coords;
+    G4int coordA;
+    G4int coordB;
+
+    G4int nBinsA;
+    std::vector<G4double> lowEdgeA, widthA;
+    std::vector<G4double> lowEdgeB, widthB;
+
+    // Alias table over the bins, index = iB*nBinsA + iA
+    std::vector<G4double> aliasProb;
+    std::vector<G4int>    aliasIdx;
+    G4double sumWeights;
+};
+
+// -----------------------------------------------------------------------------------------
+
+#endif
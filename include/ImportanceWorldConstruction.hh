@@ -0,0 +1,82 @@
+/*
+ * This file is part of MiniScatter.
+ *
+ *  MiniScatter is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  MiniScatter is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with MiniScatter.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef ImportanceWorldConstruction_hh
+#define ImportanceWorldConstruction_hh 1
+
+#include "G4VUserParallelWorld.hh"
+#include "G4VPhysicsConstructor.hh"
+
+#include "DetectorConstruction.hh"
+
+#include <vector>
+
+// Parallel geometry holding the cells used for importance biasing (geometric splitting and Russian roulette).
+// Tracks going from a cell with importance I1 into a cell with importance I2 are split into I2/I1 copies
+// (if I2>I1) or killed with probability 1-I2/I1 (if I2<I1), and the track weights adjusted accordingly.
+// The cells are set up from a string, see printHelp() in MiniScatter.cc:
+//  'R:r1,r2,...:ratio(:particles)' : Concentric cylinders along z with radius r1 < r2 < ... [mm];
+//                                    the importance is multiplied by 'ratio' for each shell going outwards.
+//  'Z:n:ratio(:particles)'         : n slabs of equal thickness in the target;
+//                                    the importance is multiplied by 'ratio' for each slab going downstream.
+// The optional 'particles' is a comma-separated list of particle names to bias, default 'e-,e+,gamma,proton'.
+
+class ImportanceWorldConstruction : public G4VUserParallelWorld {
+public:
+    ImportanceWorldConstruction(G4String worldName, DetectorConstruction* mainGeometryConstruction_in,
+                                G4String importanceDefinition);
+    virtual ~ImportanceWorldConstruction(){};
+
+    virtual void Construct();
+
+    // Fill the G4IStore; call after runManager->Initialize()
+    void CreateImportanceStore();
+
+    const std::vector<G4String>& GetParticles() const {return particles;};
+
+private:
+    DetectorConstruction* mainGeometryConstruction = NULL;
+
+    G4bool                radialCells = false; // Radial shells if true, else z slabs in the target
+    std::vector<G4double> radialBounds;        // [G4 units]
+    G4int                 numSlabs = 0;
+    G4double              ratio    = 1.0;      // Importance ratio between neighbouring cells
+    std::vector<G4String> particles;
+
+    G4VPhysicalVolume* ghostWorld = NULL;
+    G4double           ghostWorldImportance = 1.0;
+    std::vector<G4VPhysicalVolume*> cellPVs;
+    std::vector<G4double>           cellImportances;
+};
+
+// Attaches the importance sampling process for the parallel world to the biased particles.
+// The geometry sampler is created in ConstructProcess(), when the parallel world volume exists.
+
+class ImportancePhysics : public G4VPhysicsConstructor {
+public:
+    ImportancePhysics(G4String worldName_in, const std::vector<G4String> &particles_in);
+    virtual ~ImportancePhysics(){};
+
+    virtual void ConstructParticle(){};
+    virtual void ConstructProcess();
+
+private:
+    G4String              worldName;
+    std::vector<G4String> particles;
+};
+
+#endif
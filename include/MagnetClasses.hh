@@ -26,6 +26,11 @@
 #include "G4MagneticField.hh"
 #include "G4Navigator.hh"
 
+class G4FieldManager;
+class G4Region;
+
+#include <vector>
+
 /** Magnet field base classes
  *  (must be on top, as it is used in the MagnetBase)
  * **/
@@ -38,6 +43,20 @@ public:
     virtual void PostInitialize() {
         SetupTransform();
     }
+
+    // Transformations between the global frame and the frame of the field
+    G4ThreeVector PointToLocal(const G4ThreeVector& p) const {
+        return fIsTranslationOnly ? p + fTranslation : fGlobalToLocal.TransformPoint(p);
+    }
+    G4ThreeVector AxisToLocal(const G4ThreeVector& a) const {
+        return fIsTranslationOnly ? a : fGlobalToLocal.TransformAxis(a);
+    }
+    G4ThreeVector PointToGlobal(const G4ThreeVector& p) const {
+        return fIsTranslationOnly ? p - fTranslation : fLocalToGlobal.TransformPoint(p);
+    }
+    G4ThreeVector AxisToGlobal(const G4ThreeVector& a) const {
+        return fIsTranslationOnly ? a : fLocalToGlobal.TransformAxis(a);
+    }
 private:
     G4ThreeVector centerPoint;
     G4LogicalVolume* fieldLV;
@@ -46,6 +65,25 @@ protected:
     void SetupTransform();
     G4AffineTransform fGlobalToLocal;
 
+    // Precomputed by SetupTransform(), for fast field evaluation
+    G4AffineTransform fLocalToGlobal;
+    G4bool        fIsTranslationOnly = false; // No xRot/yRot
+    G4ThreeVector fTranslation;               // Global->local translation
+
+    inline G4ThreeVector GlobalToLocalPoint(const G4double point[4]) const {
+        if (fIsTranslationOnly) {
+            return G4ThreeVector(point[0]+fTranslation.x(), point[1]+fTranslation.y(), point[2]+fTranslation.z());
+        }
+        return fGlobalToLocal.TransformPoint(G4ThreeVector(point[0],point[1],point[2]));
+    }
+    inline void LocalToGlobalAxis(G4double field[3]) const {
+        if (fIsTranslationOnly) return;
+        G4ThreeVector B = fLocalToGlobal.TransformAxis(G4ThreeVector(field[0],field[1],field[2]));
+        field[0] = B.x();
+        field[1] = B.y();
+        field[2] = B.z();
+    }
+
     G4double gradient; // [T/m]
 };
 
@@ -78,12 +116,30 @@ public:
             // There are "magnets" with no field
             field->PostInitialize();
         }
+        if (absorberRegion != NULL) {
+            CreateAbsorberModel();
+        }
     }
 
+    // Time the field evaluation at random points in the field volume
+    void BenchmarkField(G4int nCalls);
+    // Time the geometry navigation (locate + compute step) at random points and directions in the object
+    void BenchmarkNavigation(G4int nCalls);
+
+    // Objects with a fast simulation model need their own region and the fast simulation process;
+    // the model itself is created in PostInitialize()
+    virtual G4bool UsesFastSimulation() const { return false; };
+    // The black absorber also needs the fast simulation process,
+    // but its model is attached to the absorber region made in MakeAbsorberRegion()
+    G4bool UsesAbsorber() const { return absorb; };
+
     G4double GetLength()    const { return length;  };
     G4double GetXOffset()   const { return xOffset; };
     G4double GetYOffset()   const { return yOffset; };
 
+    // The G4StepLimiterPhysics is needed if > 0
+    G4double GetFieldMaxStep() const { return fieldMaxStep; };
+
 protected:
     G4double zPos;     // [G4 units]
     G4bool   doRelPos;
@@ -102,9 +158,44 @@ protected:
 
     FieldBase* field = NULL;
 
+    // Field integration settings, common for all objects with a field;
+    // negative values => Geant4 defaults
+    G4String stepperName       = "ClassicalRK4";
+    G4double minStep           = -1.0; // [G4 length units], <0 => object-specific default
+    G4double deltaChord        = -1.0; // [G4 length units]
+    G4double deltaOneStep      = -1.0; // [G4 length units]
+    G4double deltaIntersection = -1.0; // [G4 length units]
+    G4double epsMin            = -1.0;
+    G4double epsMax            = -1.0;
+    // Create the field manager with stepper and chord finder for the field
+    G4FieldManager* MakeFieldManager(G4double defaultMinStep);
+
+    // Volume the field is attached to: "main" => the whole mainLV (default),
+    // other values are object-specific tighter volumes, which are enlarged by fieldMargin.
+    G4String fieldVolume  = "main";
+    G4double fieldMargin  = 0.0;  // [G4 length units]
+    G4double fieldMaxStep = -1.0; // [G4 length units], <0 => No step limit inside the field volume
+    // Attach the field manager (and the step limit) to a volume
+    void AttachFieldManager(G4LogicalVolume* fieldLV, G4FieldManager* fieldMgr);
+    // Create a vacuum box of size (width+2*fieldMargin, height+2*fieldMargin, length) centered in the mainLV,
+    // and attach the field manager to it. Objects inside the field should be placed in the returned LV.
+    G4LogicalVolume* MakeFieldBoxLV(G4double width, G4double height, G4FieldManager* fieldMgr);
+
     G4LogicalVolume* mainLV = NULL;
     G4LogicalVolume* MakeNewMainLV(G4String name_postfix);
 
+    // "Black absorber" mode: kill all tracks entering the absorber volume, depositing their energy
+    G4bool absorb = false;
+    G4Region* absorberRegion = NULL;
+    // Put absorberLV in its own region; the AbsorberFastSimModel is attached to it in PostInitialize()
+    void MakeAbsorberRegion(G4LogicalVolume* absorberLV);
+    void CreateAbsorberModel();
+
+    // Holes along the z axis are made as a vacuum cylinder daughter volume (default),
+    // which is much cheaper to navigate than the G4SubtractionSolid used with booleanHole=True
+    G4bool booleanHole = false;
+    G4LogicalVolume* MakeHoleLV(G4LogicalVolume* motherLV, G4double radius, G4String holeName);
+
     G4double mainLV_w = 0.0; // Width  of mainLV after removing what is needed for trans and rot [G4 units]
     G4double mainLV_h = 0.0; // Height of mainLV after removing what is needed for trans and rot [G4 units]
 
@@ -114,6 +205,7 @@ protected:
     virtual void ConstructDetectorLV();
     G4LogicalVolume* detectorLV = NULL;
     G4VSensitiveDetector* magnetSD = NULL;
+    void SetSensitiveDetectorRecursive(G4LogicalVolume* LV);
 
 public:
     const G4String magnetName;
@@ -124,16 +216,21 @@ public:
     virtual void Construct() = 0;
     G4LogicalVolume* GetMainLV() const;
     G4LogicalVolume* GetDetectorLV() const;
-    void AddSD(); // Adds an SD to the detectorLV
+    // Adds an SD to the detectorLV in the parallel world,
+    // or with massWorld=true to the mainLV and all its daughters in the mass world
+    void AddSD(G4bool massWorld=false);
 
 public:
     //Parsing helpers
     void ParseOffsetRot(G4String k, G4String v);
+    static G4bool IsFieldParameter(G4String k);
+    void ParseFieldParameter(G4String k, G4String v);
 
     G4bool   ParseBool  (G4String inStr, G4String readWhat);
     G4double ParseDouble(G4String inStr, G4String readWhat);
 
     void PrintCommonParameters();
+    void PrintFieldParameters();
 };
 
 /** Various magnets or objects **/
@@ -146,11 +243,15 @@ public:
                   G4String magnetName_in);
 
     virtual void Construct();
+    virtual void PostInitialize();
+    virtual G4bool UsesFastSimulation() const { return fastOptics; };
 private:
     G4double plasmaTotalCurrent; // [A]
     G4double capRadius;          // [G4 length units]
     G4double cryWidth;           // [G4 length units]
     G4double cryHeight;          // [G4 length units]
+
+    G4bool fastOptics = false;   // Use the transfer map instead of tracking through the capillary
 };
 
 class FieldPLASMA1 : public FieldBase {
@@ -159,10 +260,65 @@ public:
                  G4ThreeVector centerPoint_in, G4LogicalVolume* fieldLV_in);
     virtual void GetFieldValue(const G4double point[4], G4double field[6]) const;
 
+    G4double GetCapRadius()  const {return capRadius;};
+    G4double GetGradientG4() const {return gradient_G4;};
+
 private:
     G4double plasmaTotalCurrent; // [A]
     G4double capRadius;  // [G4 units]
 
+    // Precomputed for GetFieldValue()
+    G4double capRadius2;     // [G4 units]
+    G4double gradient_G4;    // [G4 units]
+    G4double currentFactor;  // mu0*I/(2*pi) [G4 units]
+};
+
+// TABULATED FIELD MAP
+
+class MagnetFIELDMAP1 : public MagnetBase {
+public:
+    MagnetFIELDMAP1(G4double zPos_in, G4bool doRelPos_in, G4double length_in, G4double gradient_in,
+                    std::map<G4String,G4String> &keyValPairs_in, DetectorConstruction* detCon_in,
+                    G4String magnetName_in);
+
+    virtual void Construct();
+private:
+    G4String fileName;
+};
+
+class FieldFIELDMAP1 : public FieldBase {
+public:
+    // Read the map from fileName_in; it is multiplied by scale_in
+    FieldFIELDMAP1(G4String fileName_in, G4double scale_in,
+                   G4ThreeVector centerPoint_in, G4LogicalVolume* fieldLV_in);
+    virtual void GetFieldValue(const G4double point[4], G4double field[6]) const;
+
+    G4double GetMinSpacing() const;
+    // Half-extent of the grid in local x and y, centered on the object axis [G4 units]
+    void GetTransverseHalfExtent(G4double& halfX, G4double& halfY) const;
+
+private:
+    void ReadFile(G4String fileName);
+
+    // Interpolate in a grid of NDIM dimensions at the (local) coordinates u,
+    // returning the 3 tabulated components. Returns false if outside the grid.
+    template <int NDIM> G4bool Interpolate(const G4double u[3], G4double B[3]) const;
+
+    G4int nDim = 0; // 1 => Radial (r), 2 => Cylindrical (r,z), 3 => Cartesian (x,y,z)
+    G4int    nPts[3]   = {1,1,1};
+    G4double uMin[3]   = {0.0,0.0,0.0}; // [G4 units]
+    G4double uMax[3]   = {0.0,0.0,0.0}; // [G4 units]
+    G4double invDU[3]  = {0.0,0.0,0.0}; // 1/spacing [1/G4 units]
+    G4int    stride[3] = {0,0,0};       // Node index stride per dimension
+
+    // Field values, 3 components per node, first coordinate varying fastest.
+    // Components are (Br,Btheta,Bz) for 1D and 2D maps, (Bx,By,Bz) for 3D maps. [G4 units]
+    std::vector<G4double> fieldData;
+
+    // The corner values of the cell used in the previous call,
+    // since consecutive calls from the stepper are normally in the same cell
+    mutable G4int    lastCell = -1;
+    mutable G4double cellData[8*3];
 };
 
 // CIRCULAR OPENING COLLIMATOR
@@ -58,6 +58,14 @@ public:
     inline const G4ThreeVector& GetPreStepPoint()  const {return preStepPoint;}
     inline const G4ThreeVector& GetPostStepPoint() const {return postStepPoint;}
 
+    // Statistical weight of the track, != 1 when using importance biasing
+    inline void SetWeight(G4double weight_in) {weight = weight_in;}
+    inline G4double GetWeight() const {return weight;}
+
+    // Index of the primary this track descends from, != 0 with several primaries per event
+    inline void SetPrimaryIdx(G4int primaryIdx_in) {primaryIdx = primaryIdx_in;}
+    inline G4int GetPrimaryIdx() const {return primaryIdx;}
+
 private:
 
     G4double fDepositedEnergy;      // Energy deposit
@@ -65,6 +73,9 @@ private:
 
     G4ThreeVector preStepPoint;
     G4ThreeVector postStepPoint;
+
+    G4double weight = 1.0;
+    G4int    primaryIdx = 0;
 };
 
 typedef G4THitsCollection<MyEdepHit> MyEdepHitsCollection;
@@ -18,9 +18,12 @@
 #define TargetSD
 
 #include "G4VSensitiveDetector.hh"
+#include "G4Transform3D.hh"
 #include "MyEdepHit.hh"
 #include "MyTrackerHit.hh"
 
+#include <vector>
+
 class G4HCofThisEvent;
 class G4TouchableHistory;
 class G4Step;
@@ -38,7 +41,27 @@ public:
     virtual G4bool ProcessHits(G4Step* aStep,G4TouchableHistory* history);
 
     virtual void EndOfEvent(G4HCofThisEvent*) {};
+
+    // Only record the boundary crossings on the face z = exitZ in the local frame of the object,
+    // where globalToLocal transforms from the global to the local frame
+    void SetExitFace(const G4Transform3D& globalToLocal_in, G4double exitZ_in) {
+        globalToLocal = globalToLocal_in;
+        exitZ = exitZ_in;
+        hasExitFace = true;
+    };
+
+    // Sum the energy deposit (multiplied by the weight) of each event into a single hit per primary,
+    // instead of making one hit per step. The step positions are then not available.
+    void SetAccumulateEdep(G4bool accumulateEdep_in) {
+        accumulateEdep = accumulateEdep_in;
+    };
 private:
+    G4bool        hasExitFace = false;
+    G4Transform3D globalToLocal;
+    G4double      exitZ       = 0.0; // [G4 length units]
+
+    G4bool     accumulateEdep = false;
+    std::vector<MyEdepHit*> edepSums;  // The running sums for this event if accumulateEdep, per primary
 
     // Data members
     MyEdepHitsCollection* fHitsCollection_edep;
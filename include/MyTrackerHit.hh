@@ -53,6 +53,14 @@ public:
 
     inline void SetType(G4String type) {particleType = type;}
     inline const G4String& GetType() const {return particleType;}
+
+    // Statistical weight of the track, != 1 when using importance biasing
+    inline void SetWeight(G4double weight_in) {weight = weight_in;}
+    inline G4double GetWeight() const {return weight;}
+
+    // Index of the primary this track descends from, != 0 with several primaries per event
+    inline void SetPrimaryIdx(G4int primaryIdx_in) {primaryIdx = primaryIdx_in;}
+    inline G4int GetPrimaryIdx() const {return primaryIdx;}
 private:
 
     G4ThreeVector trackPosition; //Global coordinates [G4 units]
@@ -63,6 +71,9 @@ private:
     G4int    particleCharge;
 
     G4String particleType;
+
+    G4double weight = 1.0;
+    G4int    primaryIdx = 0;
 };
 
 typedef G4THitsCollection<MyTrackerHit> MyTrackerHitsCollection;
@@ -39,8 +39,14 @@ public:
     virtual G4bool ProcessHits(G4Step* aStep,G4TouchableHistory* history);
 
     virtual void EndOfEvent(G4HCofThisEvent*) {};
+
+    // Only record tracks crossing into the volume in the +z direction,
+    // and silently ignore steps starting inside it (e.g. for planes inside the target)
+    void SetForwardOnly(G4bool forwardOnly_in) {forwardOnly = forwardOnly_in;};
 private:
 
+    G4bool forwardOnly = false;
+
     DetectorConstruction* detectorConstruction;
 
     // Data members
@@ -24,6 +24,7 @@
 
 // Parallel geometry in which the magnet sensitive detectors are defined;
 // this gets around the problem of how to attach the SDs correctly onto complex magnet geometries.
+// It also holds the scoring planes inside the target.
 
 class ParallelWorldConstruction : public G4VUserParallelWorld {
 public:
@@ -36,6 +37,7 @@ public:
 private:
     DetectorConstruction* mainGeometryConstruction = NULL;
     std::vector <G4VPhysicalVolume*> magnetDetectorPVs;
+    std::vector <G4LogicalVolume*>   targetPlaneLVs;
 };
 
 #endif
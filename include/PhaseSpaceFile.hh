@@ -0,0 +1,170 @@
+/*
+ * This file is part of MiniScatter.
+ *
+ *  MiniScatter is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  MiniScatter is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with MiniScatter.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef PhaseSpaceFile_h
+#define PhaseSpaceFile_h 1
+
+#include "globals.hh"
+
+#include <cstdint>
+#include <fstream>
+#include <vector>
+
+//--------------------------------------------------------------------------------
+
+// Binary file of the particles crossing the target exit plane, used for
+// splitting a simulation in a target stage and a downstream stage.
+// Layout: One phaseSpaceHeader, followed by phaseSpaceRecords sorted by eventID.
+// Records are written and read one event at a time, so the file is never fully
+// loaded into memory.
+
+struct phaseSpaceHeader {
+    char     magic[8];         // "MSPHSP1"
+    uint64_t numEvents;        // Number of primaries simulated in the target stage
+    uint64_t numRecordEvents;  // Number of those events that had at least one record
+    uint64_t numRecords;       // Total number of records in the file
+};
+
+struct phaseSpaceRecord {
+    float x;  // [mm]
+    float y;  // [mm]
+    float z;  // [mm]
+
+    float px; // [MeV/c]
+    float py; // [MeV/c]
+    float pz; // [MeV/c]
+
+    float E;  // Kinetic energy [MeV]
+
+    float weight;
+
+    int32_t PDG;
+    int32_t eventID;
+};
+
+//--------------------------------------------------------------------------------
+
+class PhaseSpaceFileWriter {
+public:
+    PhaseSpaceFileWriter(G4String fileName_in);
+    ~PhaseSpaceFileWriter();
+
+    void Write(const phaseSpaceRecord& record);
+    // Write the final header and close the file
+    void Close(uint64_t numEvents);
+
+private:
+    G4String fileName;
+    std::ofstream outFile;
+    phaseSpaceHeader header;
+    int32_t lastEventID = -1;
+};
+
+//--------------------------------------------------------------------------------
+
+class PhaseSpaceFileReader {
+public:
+    PhaseSpaceFileReader(G4String fileName_in);
+    ~PhaseSpaceFileReader();
+
+    // Get all the records from the next event in the file.
+    // When the end of the file is reached, it starts over from the beginning.
+    void ReadEvent(std::vector<phaseSpaceRecord>& records);
+
+    const phaseSpaceHeader& GetHeader() const {return header;};
+    G4int GetNumRewinds() const {return numRewinds;};
+
+    void Print();
+
+private:
+    G4bool ReadRecord(phaseSpaceRecord& record);
+    void Rewind();
+
+    G4String fileName;
+    std::ifstream inFile;
+    phaseSpaceHeader header;
+
+    phaseSpaceRecord nextRecord; // Lookahead, first record of the next event
+    G4int numRewinds = 0;
+};
+
+//--------------------------------------------------------------------------------
+
+// Binary file of beam particles, e.g. converted from an upstream tracking code,
+// which are used as primaries one per event.
+// Layout: One beamFileHeader, followed by numRecords beamFileRecords.
+// The writer is scripts/miniScatterDriver.py:writeBeamFile().
+
+struct beamFileHeader {
+    char     magic[8];   // "MSBEAM1"
+    uint64_t numRecords;
+};
+
+struct beamFileRecord {
+    float x;  // [mm]
+    float xp; // [rad]
+    float y;  // [mm]
+    float yp; // [rad]
+
+    float E;  // Kinetic energy [MeV]
+
+    float weight;
+
+    int32_t PDG;
+};
+
+class BeamFileReader {
+public:
+    // If resample, the file is memory mapped and the records are picked at random;
+    // otherwise the file is read sequentially in chunks, and restarted if it runs out.
+    BeamFileReader(G4String fileName_in, G4bool resample_in);
+    ~BeamFileReader();
+
+    // Get the next record in the file
+    const beamFileRecord& ReadNext();
+    // Get a random record, u is uniform in [0,1)
+    const beamFileRecord& ReadRandom(G4double u);
+
+    G4bool GetResample() const {return resample;};
+    uint64_t GetNumRecords() const {return header.numRecords;};
+    G4int GetNumRewinds() const {return numRewinds;};
+
+    void Print();
+
+private:
+    void ReadChunk();
+
+    G4String fileName;
+    G4bool resample;
+    beamFileHeader header;
+
+    // Sequential reading
+    std::ifstream inFile;
+    static const size_t chunkSize = 65536; // Number of records read at a time
+    std::vector<beamFileRecord> chunk;
+    size_t chunkPos = 0;
+    G4int numRewinds = 0;
+
+    // Resampling
+    void*  mapAddr = NULL;
+    size_t mapSize = 0;
+    const beamFileRecord* mapRecords = NULL;
+};
+
+//--------------------------------------------------------------------------------
+
+#endif
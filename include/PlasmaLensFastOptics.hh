@@ -0,0 +1,63 @@
+/*
+ * This file is part of MiniScatter.
+ *
+ *  MiniScatter is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  MiniScatter is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with MiniScatter.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef PlasmaLensFastOptics_h
+#define PlasmaLensFastOptics_h 1
+
+#include "G4VFastSimulationModel.hh"
+#include "G4ThreeVector.hh"
+#include "globals.hh"
+
+class FieldPLASMA1;
+
+//--------------------------------------------------------------------------------
+
+// Transfer-map ("fast optics") transport through a PLASMA1 lens.
+// A charged particle entering the front face of the lens inside the capillary is
+// moved directly to the back face with the thick-lens map of the linear field,
+// using the same second order (predictor-corrector in uz) map as PlasmaLensStepper.
+// The maximum radius of the trajectory over the lens is computed analytically;
+// tracks that would touch the crystal (r >= capRadius anywhere along the lens)
+// are tracked normally, as is anything not entering through the front face.
+// No energy is lost and no secondaries are produced, i.e. the capillary is
+// assumed to be vacuum.
+
+class PlasmaLensFastOpticsModel : public G4VFastSimulationModel {
+public:
+    PlasmaLensFastOpticsModel(G4String modelName, G4Region* envelope,
+                              const FieldPLASMA1* field_in, G4double length_in);
+    virtual ~PlasmaLensFastOpticsModel(){};
+
+    virtual G4bool IsApplicable(const G4ParticleDefinition& particle);
+    virtual G4bool ModelTrigger(const G4FastTrack& fastTrack);
+    virtual void   DoIt(const G4FastTrack& fastTrack, G4FastStep& fastStep);
+
+    void Print();
+
+private:
+    // Apply the map to the track (local coordinates).
+    // Returns false if the track should not be parameterised.
+    G4bool ComputeExit(const G4FastTrack& fastTrack,
+                       G4ThreeVector& exitPos, G4ThreeVector& exitDir, G4double& pathLength);
+
+    const FieldPLASMA1* field;
+    G4double length; // [G4 length units]
+};
+
+//--------------------------------------------------------------------------------
+
+#endif
@@ -0,0 +1,68 @@
+/*
+ * This file is part of MiniScatter.
+ *
+ *  MiniScatter is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  MiniScatter is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with MiniScatter.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef PlasmaLensStepper_h
+#define PlasmaLensStepper_h 1
+
+#include "G4MagIntegratorStepper.hh"
+#include "G4ThreeVector.hh"
+#include "globals.hh"
+
+class G4Mag_EqRhs;
+class FieldPLASMA1;
+
+//--------------------------------------------------------------------------------
+
+// Stepper for the linear focusing field inside a plasma lens capillary,
+// B = g*(-y, x, 0) in the lens frame.
+// Here the transverse motion is a harmonic oscillator, x'' = -kappa*uz*x with
+// kappa = q*c*g/|p|, and uz - kappa*r^2/2 is conserved. The step is taken
+// analytically with uz held constant, first at its initial value (predictor)
+// and then at its average over the step (corrector); the difference is the
+// error estimate. No field evaluations are needed.
+// Steps that start or end outside the capillary are passed to a G4ClassicalRK4.
+
+class PlasmaLensStepper : public G4MagIntegratorStepper {
+public:
+    PlasmaLensStepper(G4Mag_EqRhs* equation_in, const FieldPLASMA1* field_in);
+    virtual ~PlasmaLensStepper();
+
+    virtual void Stepper(const G4double yIn[], const G4double dydx[], G4double h,
+                         G4double yOut[], G4double yErr[]);
+    virtual G4double DistChord() const;
+    virtual G4int IntegratorOrder() const {return 2;};
+
+    // Analytic step of length h with constant uz and focusing constant K = kappa*uz (lens frame)
+    static void Propagate(const G4ThreeVector& pos0, const G4ThreeVector& u0, G4double K, G4double uz,
+                          G4double h, G4ThreeVector& pos1, G4ThreeVector& u1);
+
+private:
+
+    G4Mag_EqRhs* equation;
+    const FieldPLASMA1* field;
+    G4MagIntegratorStepper* fallbackStepper;
+
+    // For DistChord(), lens frame
+    G4bool lastStepFallback = true;
+    G4ThreeVector chordStart;
+    G4ThreeVector chordMid;
+    G4ThreeVector chordEnd;
+};
+
+//--------------------------------------------------------------------------------
+
+#endif
@@ -25,11 +25,14 @@
 // which are then shadowed inside functions in the header. Let's ignore it.
 #pragma GCC diagnostic push
 #pragma GCC diagnostic ignored "-Wshadow"
-#include "TMatrixDfwd.h"
-#include "TDecompChol.h"
+#include "TMatrixD.h"
 #pragma GCC diagnostic pop
 
-#include "TRandom.h"
+#include "BeamSampler.hh"
+#include "HistogramSampler.hh"
+#include "PhaseSpaceFile.hh"
+
+#include <vector>
 
 class G4ParticleGun;
 class G4Event;
@@ -37,6 +40,11 @@ class DetectorConstruction;
 
 // -----------------------------------------------------------------------------------------
 
+// Starting point of a primary [G4 units]
+struct generatedPrimary {
+    G4double x, xp, y, yp, E, weight;
+};
+
 class PrimaryGeneratorAction : public G4VUserPrimaryGeneratorAction
 {
 public:
@@ -47,10 +55,16 @@ public:
                            G4double beam_zpos_in,
                            G4bool   doBacktrack_in,
                            G4String covarianceString_in,
+                           G4String covarMatrixString_in,
                            G4double Rcut_in,
                            G4int rngSeed,
                            G4double beam_energy_min_in,
-                           G4double beam_energy_max_in );
+                           G4double beam_energy_max_in,
+                           G4String phaseSpaceIn_in,
+                           G4String beamFileIn_in,
+                           std::vector<G4String> &beamHistDefinitions,
+                           G4int primariesPerEvent_in,
+                           G4int numPrimariesTotal_in );
     virtual ~PrimaryGeneratorAction();
     void GeneratePrimaries(G4Event*);
 
@@ -92,25 +106,49 @@ private:
     TMatrixD covarX;
     TMatrixD covarY;
 
-    // covar = covar_L*covar_L^T, which is used for generation.
-    // Note that ROOT's cholesky routine return the upper-triangular covar_LU^T,
-    // so a transpose is neccessary.
-    TMatrixD covarX_L;
-    TMatrixD covarY_L;
+    // Full covariance matrix, 4D (x,x',y,y') or 6D (x,x',y,y',z,dE/E) [m,rad,1],
+    // given as the comma-separated upper triangle, row by row
+    G4String covarMatrixString;
+    void setupCovarianceMatrix();
+    G4double beta_rel_0 = 1.0; // Relativistic beta at the nominal beam energy, for the z -> time offset
 
     //Setup for circular uniform distribution / Rcut
     G4double Rcut; // [mm]
 
-    TRandom* RNG;
+    BeamSampler* sampler = NULL;
     G4int rngSeed; // Seed to use when random-generating particles within Twiss distribution
 
     //Setup for uniform energy distribution between min/max
     G4double beam_energy_min; // [MeV]
     G4double beam_energy_max; // [MeV]
 
+    //Setup for reading the particles from a phase space file instead of generating the beam
+    G4String phaseSpaceIn;    // File name, "" => generate the beam as usual
+    PhaseSpaceFileReader* phaseSpaceReader = NULL;
+    std::vector<phaseSpaceRecord> phaseSpaceEvent;
+    void GeneratePhaseSpacePrimaries(G4Event* anEvent);
+
+    //Setup for reading the beam particles from a beam file
+    G4String beamFileIn;      // File name, optionally followed by ',resample'; "" => generate the beam as usual
+    BeamFileReader* beamFileReader = NULL;
+    void GenerateBeamFilePrimary(G4Event* anEvent);
+
+    //Setup for sampling beam coordinates from 2D histograms,
+    // overriding the coordinates from the gaussian or pencil beam
+    std::vector<HistogramSampler*> beamHists;
+
+    //Setup for several primaries per event
+    G4int primariesPerEvent;  // Number of primaries in each event
+    G4int numPrimariesTotal;  // Number of primaries in the run, or 0 if unknown (GUI)
+    void GenerateBeamPrimary(G4Event* anEvent);
+
 public:
     //Leave the generated positions where RootFileWriter can pick it up [G4 units]
     G4double x,xp, y,yp, E;
+    G4double weight = 1.0;
+
+    // All the primaries of the current event
+    std::vector<generatedPrimary> generatedPrimaries;
 };
 
 // -----------------------------------------------------------------------------------------
@@ -0,0 +1,68 @@
+/*
+ * This file is part of MiniScatter.
+ *
+ *  MiniScatter is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  MiniScatter is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with MiniScatter.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef RegionDefinition_h
+#define RegionDefinition_h 1
+
+#include "globals.hh"
+
+#include <vector>
+
+class DetectorConstruction;
+class G4VModularPhysicsList;
+class G4Region;
+
+//--------------------------------------------------------------------------------
+
+// Physics settings for one part of the geometry; the target ("target"),
+// an object ("magnet_N"), or everything else ("world").
+// Parsed from a string 'name(:key=val:key=val...)', see printHelp() in MiniScatter.cc.
+
+class RegionDefinition {
+public:
+    RegionDefinition(G4String inputString);
+
+    // Set the physics list options; call before runManager->Initialize()
+    void ConfigurePhysics(G4VModularPhysicsList* physlist);
+    // Create the G4Region; called at the end of DetectorConstruction::Construct()
+    void Construct(DetectorConstruction* detCon);
+
+    void Print();
+
+    const G4String& GetName()       const {return regionName;};
+    G4String        GetG4RegionName() const;
+    G4Region*       GetRegion()     const;
+
+    G4double GetCut()     const {return cut;};
+    G4String GetEmPhysics() const {return emPhysics;};
+    G4double GetMaxStep() const {return maxStep;};
+    const std::vector<G4String>& GetInactivate() const {return inactivate;};
+
+private:
+    G4String regionName;
+
+    G4double cut       = -1.0; // Production cut for gamma, e-, e+, proton [G4 units]; <0 => default
+    G4String emPhysics = "";   // EM option name passed to G4EmParameters::AddPhysics(); "" => physics list default
+    G4double maxStep   = -1.0; // Maximum step length [G4 units]; <0 => no limit
+    std::vector<G4String> inactivate; // Names of processes to switch off in this region
+
+    G4Region* theRegion = NULL;
+};
+
+//--------------------------------------------------------------------------------
+
+#endif
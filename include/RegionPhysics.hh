@@ -0,0 +1,89 @@
+/*
+ * This file is part of MiniScatter.
+ *
+ *  MiniScatter is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  MiniScatter is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with MiniScatter.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef RegionPhysics_h
+#define RegionPhysics_h 1
+
+#include "G4VPhysicsConstructor.hh"
+#include "G4WrapperProcess.hh"
+#include "globals.hh"
+
+#include <vector>
+
+class RegionDefinition;
+class G4Region;
+
+//--------------------------------------------------------------------------------
+
+// Switches off the wrapped process for tracks that are inside one of the given regions.
+// Both the discrete and continuous parts are skipped, so that a region with all
+// the EM processes inactivated becomes pure transport.
+
+class RegionInactivatedProcess : public G4WrapperProcess {
+public:
+    RegionInactivatedProcess(G4VProcess* process_in, std::vector<const G4Region*> &inactiveRegions_in);
+    virtual ~RegionInactivatedProcess(){};
+
+    virtual void StartTracking(G4Track* track);
+
+    virtual G4double PostStepGetPhysicalInteractionLength(const G4Track& track,
+                                                          G4double previousStepSize,
+                                                          G4ForceCondition* condition);
+    virtual G4double AlongStepGetPhysicalInteractionLength(const G4Track& track,
+                                                           G4double previousStepSize,
+                                                           G4double currentMinimumStep,
+                                                           G4double& proposedSafety,
+                                                           G4GPILSelection* selection);
+    virtual G4VParticleChange* AlongStepDoIt(const G4Track& track, const G4Step& step);
+
+private:
+    inline G4bool IsInactive(const G4Track& track) const {
+        const G4Region* region = track.GetVolume()->GetLogicalVolume()->GetRegion();
+        for (auto r : inactiveRegions) {
+            if (r == region) return true;
+        }
+        return false;
+    };
+
+    std::vector<const G4Region*> inactiveRegions;
+
+    // If the previous step was taken with the process switched off,
+    // it must not count towards the number of interaction lengths left.
+    // Reset in StartTracking(), as only one track is tracked at a time.
+    G4bool lastStepInactive = false;
+};
+
+//--------------------------------------------------------------------------------
+
+// Wraps the processes listed with 'inactivate=' in the region definitions.
+// Must be registered after all the other physics constructors.
+
+class RegionPhysics : public G4VPhysicsConstructor {
+public:
+    RegionPhysics(std::vector<RegionDefinition*> &regions_in);
+    virtual ~RegionPhysics(){};
+
+    virtual void ConstructParticle(){};
+    virtual void ConstructProcess();
+
+private:
+    std::vector<RegionDefinition*> regions;
+};
+
+//--------------------------------------------------------------------------------
+
+#endif
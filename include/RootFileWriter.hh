@@ -26,7 +26,11 @@
 #include "TH3.h"
 #include <map>
 
+#include "DriftProjection.hh"
+
 class TRandom;
+class PhaseSpaceFileWriter;
+class MyTrackerHit;
 
 // Use a simple struct for writing to ROOT file,
 // since this requires no dictionary to read.
@@ -41,6 +45,8 @@ struct trackerHitStruct {
 
     Double_t E; // [MeV]
 
+    Double_t weight; // Statistical weight, 1.0 if not biased
+
     Int_t PDG;
     Int_t charge;
 
@@ -55,9 +61,45 @@ public:
         numParticles = 0;
     }
     // In both cases, the index is the PDG id.
-    std::map<G4int,G4int> particleTypes;    // The number of particles of each type
+    std::map<G4int,G4double> particleTypes; // The (weighted) number of particles of each type
     std::map<G4int,G4String> particleNames; // The name of each particle type
-    G4int numParticles;
+    G4double numParticles;
+};
+
+// The histograms of the particles hitting a tracker-like plane (the tracker, a scoring plane,
+// or a target depth plane), and the sums for the average hit position and RMS.
+// Booked, filled, and written by the RootFileWriter::*PlaneHistograms() methods.
+class planeHistograms {
+public:
+    G4String name;
+    G4bool   targetPlane = false; // Target depth planes also have angle histograms
+
+    TH1D* numParticles = NULL;
+    TH1D* energy       = NULL;
+    std::map<G4int,TH1D*> type_energy;
+    std::map<G4int,TH1D*> type_cutoff_energy;
+    TH2D* hitPos        = NULL;
+    TH2D* hitPos_cutoff = NULL;
+    TH2D* phasespaceX        = NULL;
+    TH2D* phasespaceY        = NULL;
+    TH2D* phasespaceX_cutoff = NULL;
+    TH2D* phasespaceY_cutoff = NULL;
+    std::map<G4int,TH1D*> Rpos;
+    std::map<G4int,TH1D*> Rpos_cutoff;
+    TH1D* angle        = NULL;
+    TH1D* angle_cutoff = NULL;
+
+    G4double particleHit_x  = 0.0;
+    G4double particleHit_xx = 0.0;
+    G4double particleHit_y  = 0.0;
+    G4double particleHit_yy = 0.0;
+
+    // Charged particles above the energy cutoff only
+    G4double particleHit_x_cutoff  = 0.0;
+    G4double particleHit_xx_cutoff = 0.0;
+    G4double particleHit_y_cutoff  = 0.0;
+    G4double particleHit_yy_cutoff = 0.0;
+    G4double numParticles_cutoff   = 0.0;
 };
 
 class RootFileWriter {
@@ -103,6 +145,45 @@ public:
     }
     void setEngNbins(G4int edepNbins_in);
 
+    void setPhaseSpaceOut(G4String phaseSpaceOut_in) {
+        this->phaseSpaceOut = phaseSpaceOut_in;
+    }
+
+    // Project the particles leaving the last target/object through the vacuum to these z positions [mm]
+    void setDriftProjections(std::vector<G4double> &driftProjections_in) {
+        this->driftProjections = driftProjections_in;
+    }
+
+    void setFastSimValidation(G4bool fastSimValidation_in) {
+        this->fastSimValidation = fastSimValidation_in;
+    }
+    // Exit angle [deg] and energy [MeV] predicted by the TargetFastSimModel in validation mode
+    void FillFastSimValidation(G4double exitangle, G4double energy, G4double weight) {
+        fastsim_validate_exitangle->Fill(exitangle, weight);
+        fastsim_validate_energy->Fill(energy, weight);
+    }
+
+    // Count the tracks killed by the SteppingAction / StackingAction,
+    // the counts are printed and written together with the other particle types.
+    void CountKilledTrack(G4String reason, G4int PDG, G4String type, G4double weight=1.0) {
+        FillParticleTypes(typeCounter[reason], PDG, type, weight);
+    }
+    // Wall-clock time [s] spent on tracks that were killed, printed at the end of the run
+    void AddKilledTrackTime(G4String reason, G4double seconds) {
+        killedTrackTime[reason] += seconds;
+    }
+
+    // The SteppingAction has an event step/time budget
+    void setEventBudget(G4bool eventBudget_in) {
+        this->eventBudget = eventBudget_in;
+    }
+    // Kinetic energy [G4 units] of a track killed by the event budget;
+    // marks the current event as aborted
+    void AddBudgetKilledEnergy(G4double energy, G4double weight) {
+        eventBudgetKilledEnergy += energy*weight;
+        eventBudgetAborted = true;
+    }
+
 private:
     RootFileWriter(){
         has_filename_out = false;
@@ -147,6 +228,14 @@ private:
     TH3D* target_edep_dens;
     TH2D* target_edep_rdens;
 
+    // Target depth plane histograms, same as for the tracker plus the angle, one entry per plane
+    std::vector<planeHistograms> targetPlaneHists;
+
+    // Target fast simulation validation histograms
+    G4bool fastSimValidation = false;
+    TH1D* fastsim_validate_exitangle = NULL;
+    TH1D* fastsim_validate_energy    = NULL;
+
     // Magnet histograms
     std::vector<TH1D*> magnet_edep;
     std::vector<std::map<G4int,TH1D*>> magnet_exit_Rpos;
@@ -159,19 +248,10 @@ private:
     std::vector<std::map<G4int,TH1D*>> magnet_exit_cutoff_energy;
 
     //Tracker histograms
-    TH1D* tracker_numParticles;
-    TH1D* tracker_energy;
-    std::map<G4int,TH1D*> tracker_type_energy;
-    std::map<G4int,TH1D*> tracker_type_cutoff_energy;
-    TH2D* tracker_hitPos;
-    TH2D* tracker_hitPos_cutoff;
-    TH2D* tracker_phasespaceX;
-    TH2D* tracker_phasespaceY;
-    TH2D* tracker_phasespaceX_cutoff;
-    TH2D* tracker_phasespaceY_cutoff;
-
-    std::map<G4int,TH1D*> tracker_Rpos;
-    std::map<G4int,TH1D*> tracker_Rpos_cutoff;
+    planeHistograms trackerHists;
+
+    // Scoring plane histograms, same as for the tracker, one entry per plane
+    std::vector<planeHistograms> planeHists;
 
     //Initial distribution
     TH2D* init_phasespaceX;
@@ -183,27 +263,22 @@ private:
 
     // Count the number of each particle type that hits the tracker
     std::map<G4String,particleTypesCounter> typeCounter;
+    std::map<G4String,G4double> killedTrackTime; // [s]
 
-    // Compute means and standard deviations of where the particles hit the tracker
-    G4double tracker_particleHit_x;
-    G4double tracker_particleHit_xx;
-    G4double tracker_particleHit_y;
-    G4double tracker_particleHit_yy;
-
-    G4double tracker_particleHit_x_cutoff;
-    G4double tracker_particleHit_xx_cutoff;
-    G4double tracker_particleHit_y_cutoff;
-    G4double tracker_particleHit_yy_cutoff;
-
-    G4int numParticles_cutoff;
+    // Events aborted by the event budget, and the kinetic energy of the tracks killed in each of them
+    G4bool   eventBudget             = false;
+    G4bool   eventBudgetAborted      = false;
+    G4double eventBudgetKilledEnergy = 0.0; // [G4 units]
+    G4int    numBudgetAbortedEvents  = 0;
+    TH1D*    budget_killed_energy    = NULL;
 
     //Target exit angle RMS
     G4double target_exitangle;
     G4double target_exitangle2;
-    G4int target_exitangle_numparticles;
+    G4double target_exitangle_numparticles;
     G4double target_exitangle_cutoff;
     G4double target_exitangle2_cutoff;
-    G4int target_exitangle_cutoff_numparticles;
+    G4double target_exitangle_cutoff_numparticles;
 
     // Internal stuff
     //Output file naming
@@ -231,6 +306,25 @@ private:
     //Energy deposition and energy-remaining number of bins
     G4int engNbins = 1000;
 
+    // Phase space file of the particles exiting the target, "" => don't write
+    G4String phaseSpaceOut = "";
+    PhaseSpaceFileWriter* phaseSpaceWriter = NULL;
+    // Only the forward crossings of the downstream face of the target are written;
+    // the face is at z = phaseSpaceExitZ in the frame of the target, which is rotated by phaseSpaceAngle around y.
+    G4double phaseSpaceExitZ  = 0.0; // [G4 units]
+    G4double phaseSpaceAngle  = 0.0; // [rad]
+
+    // Drift projections, [mm], empty => disabled
+    std::vector<G4double> driftProjections;
+    DriftBuffer driftBuffer;
+    G4int    driftSourceMagIdx = -1;    // Index of the object whose exit is projected, -1 => target exit
+    G4double driftSourceZ      = 0.0;   // [G4 units]
+    std::map<G4int,G4String> driftTypeNames;
+    std::vector<planeHistograms> driftHists; // One per projection, same as for the tracker
+    std::vector<G4double> driftLost;         // (Weighted) number of particles outside the tracker, per projection
+    std::vector<G4double> driftXProj;        // Per-event projection scratch buffers [mm]
+    std::vector<G4double> driftYProj;
+
     // RNG for sampling over the step
     TRandom* RNG;
 
@@ -240,8 +334,19 @@ private:
                         // so it may be 0 if this was not set.
 
     void PrintTwissParameters(TH2D* phaseSpaceHist);
+    void DoDriftProjections(G4int numPrimaries);
+    void WriteDriftProjections();
+
+    // Book the histograms of a tracker-like plane, with names starting with the given name
+    void BookPlaneHistograms(planeHistograms& ph, G4String name, G4double minR, G4bool targetPlane=false);
+    // Fill the histograms (except numParticles) and the sums with one hit
+    void FillPlaneHistograms(planeHistograms& ph, const MyTrackerHit* hit);
+    // Fill the histograms from the hits collection of the plane for this event
+    void DoPlaneEvent(planeHistograms& ph, G4HCofThisEvent* HCE, G4int numPrimaries);
+    // Write and delete the histograms; the 2D histograms are only written if not in quickmode
+    void WritePlaneHistograms(planeHistograms& ph);
     void PrintParticleTypes(particleTypesCounter& pt, G4String name);
-    void FillParticleTypes(particleTypesCounter& pt, G4int PDG, G4String type);
+    void FillParticleTypes(particleTypesCounter& pt, G4int PDG, G4String type, G4double weight=1.0);
 };
 
 #endif
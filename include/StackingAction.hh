@@ -0,0 +1,58 @@
+/*
+ * This file is part of MiniScatter.
+ *
+ *  MiniScatter is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  MiniScatter is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with MiniScatter.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef StackingAction_h
+#define StackingAction_h 1
+
+#include "G4UserStackingAction.hh"
+#include "globals.hh"
+
+#include <map>
+#include <set>
+
+class G4Track;
+class DetectorConstruction;
+
+//--------------------------------------------------------------------------------
+
+// Rejects secondaries of the given species before they are ever tracked,
+// as well as any new track below the SteppingAction kinetic energy threshold for its species
+// which is not created inside the target or a magnet.
+// The rejected tracks are counted in the RootFileWriter.
+
+class StackingAction : public G4UserStackingAction {
+public:
+    StackingAction(DetectorConstruction* detCon_in,
+                   std::set<G4int> &noStack_in,
+                   std::map<G4int,G4double> &killEnergy_in);
+    virtual ~StackingAction(){};
+
+    G4ClassificationOfNewTrack ClassifyNewTrack(const G4Track* aTrack);
+
+private:
+    DetectorConstruction* detCon;
+
+    // PDG ids of secondaries that should never be tracked
+    std::set<G4int> noStack;
+
+    // Kill all tracks of a given PDG id with kinetic energy below a given threshold
+    std::map<G4int,G4double> killEnergy; // PDG -> [G4 units]
+};
+
+//--------------------------------------------------------------------------------
+
+#endif
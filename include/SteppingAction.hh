@@ -0,0 +1,83 @@
+/*
+ * This file is part of MiniScatter.
+ *
+ *  MiniScatter is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  MiniScatter is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with MiniScatter.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef SteppingAction_h
+#define SteppingAction_h 1
+
+#include "G4UserSteppingAction.hh"
+#include "globals.hh"
+
+#include <map>
+#include <chrono>
+
+class DetectorConstruction;
+class G4Step;
+
+//--------------------------------------------------------------------------------
+
+// Kills tracks which can never reach any of the scoring planes,
+// in order to avoid spending CPU time on following them to the world boundary.
+// Also enforces a per-event step / wall-clock budget, and counts the loopers
+// killed by the transportation together with the time spent on them.
+// The killed tracks are counted in the RootFileWriter.
+
+class SteppingAction : public G4UserSteppingAction {
+public:
+    SteppingAction(DetectorConstruction* detCon_in,
+                   G4bool killAfterTracker_in,
+                   G4bool killBackward_in,
+                   std::map<G4int,G4double> &killEnergy_in,
+                   G4int eventStepBudget_in,
+                   G4double eventTimeBudget_in);
+    virtual ~SteppingAction(){};
+
+    void UserSteppingAction(const G4Step* aStep);
+
+    // Set the looping particle thresholds of the (coupled) transportation of all particles,
+    // must be called after the run manager is initialized. Values < 0 => keep the Geant4 default.
+    static void SetLooperThresholds(G4double warningEnergy, G4double importantEnergy, G4int numTrials);
+
+private:
+    DetectorConstruction* detCon;
+
+    // Kill all tracks which are downstream of the last scoring plane
+    G4bool   killAfterTracker;
+    G4double killAfterTracker_z; // [G4 units]
+
+    // Kill all backwards-going tracks which are upstream of the target / first object
+    G4bool   killBackward;
+    G4double killBackward_z; // [G4 units]
+
+    // Kill all tracks of a given PDG id with kinetic energy below a given threshold,
+    // except inside the target and the magnets where the energy deposit is scored
+    std::map<G4int,G4double> killEnergy; // PDG -> [G4 units]
+
+    // Kill all remaining tracks in an event after this many steps / this much wall-clock time,
+    // 0 => no limit
+    G4int    eventStepBudget;
+    G4double eventTimeBudget; // [s]
+    G4int    currentEventID = -1;
+    G4int    eventSteps     = 0;
+    std::chrono::steady_clock::time_point eventStartTime;
+
+    // For the time spent on tracks killed as loopers
+    std::chrono::steady_clock::time_point trackStartTime;
+};
+
+//--------------------------------------------------------------------------------
+
+#endif
@@ -0,0 +1,97 @@
+/*
+ * This file is part of MiniScatter.
+ *
+ *  MiniScatter is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  MiniScatter is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with MiniScatter.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef TargetFastSimModel_h
+#define TargetFastSimModel_h 1
+
+#include "G4VFastSimulationModel.hh"
+#include "G4VPhysicsConstructor.hh"
+#include "globals.hh"
+
+class G4UniversalFluctuation;
+class G4ParticleDefinition;
+
+//--------------------------------------------------------------------------------
+
+// Parameterised transport of charged particles through a thin target.
+// A particle entering the front face of the target is moved directly to the
+// back face, with the exit angle and lateral displacement sampled from the
+// Highland multiple scattering formula and the energy loss sampled from the
+// Urban straggling model (G4UniversalFluctuation), which covers the
+// Landau, Vavilov and Gaussian regimes.
+// No secondaries are produced. Tracks losing more than maxLossFraction of their
+// energy, or that would leave through the sides, are tracked normally.
+//
+// In validation mode the model does not take over the tracks. It samples the
+// parameterised exit angle and energy of each track that would have been
+// parameterised, and sends them to the RootFileWriter. They can then be compared
+// with the fully simulated target_exit_angle and target_exit_energy histograms.
+
+class TargetFastSimModel : public G4VFastSimulationModel {
+public:
+    TargetFastSimModel(G4String modelName, G4Region* envelope, G4bool validate_in);
+    virtual ~TargetFastSimModel();
+
+    virtual G4bool IsApplicable(const G4ParticleDefinition& particle);
+    virtual G4bool ModelTrigger(const G4FastTrack& fastTrack);
+    virtual void   DoIt(const G4FastTrack& fastTrack, G4FastStep& fastStep);
+
+    void Print();
+
+private:
+    // Sample the exit point, direction and energy loss (all local coordinates)
+    void SampleExit(const G4FastTrack& fastTrack,
+                    G4ThreeVector& exitPos, G4ThreeVector& exitDir, G4double& eLoss);
+
+    // Compute the path length through the target along the initial direction
+    // and the mean energy loss along it. Computed once by ModelTrigger(),
+    // and then reused by SampleExit() and DoIt() for the same track.
+    void ComputePathLength(const G4FastTrack& fastTrack);
+
+    G4bool validate;
+
+    G4double pathLength   = -1.0; // [G4 units], <0 if the track should not be parameterised
+    G4double pathMeanLoss = 0.0;  // [G4 units]
+
+    G4double maxLossFraction = 0.1; // Parameterise only if mean loss < this * kinetic energy
+
+    G4UniversalFluctuation* fluct;
+    const G4ParticleDefinition* fluctParticle = NULL; // Particle type fluct is initialised for
+};
+
+//--------------------------------------------------------------------------------
+
+// Adds the G4FastSimulationManagerProcess to all charged particles,
+// or to all particles if neutralParticles is set (needed by the absorbers).
+// The charged-only models are restricted by their own IsApplicable().
+
+class TargetFastSimPhysics : public G4VPhysicsConstructor {
+public:
+    TargetFastSimPhysics(G4bool neutralParticles_in = false) :
+        G4VPhysicsConstructor("TargetFastSimPhysics"), neutralParticles(neutralParticles_in) {};
+    virtual ~TargetFastSimPhysics(){};
+
+    virtual void ConstructParticle(){};
+    virtual void ConstructProcess();
+
+private:
+    G4bool neutralParticles;
+};
+
+//--------------------------------------------------------------------------------
+
+#endif
@@ -0,0 +1,64 @@
+/*
+ * This file is part of MiniScatter.
+ *
+ *  MiniScatter is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  MiniScatter is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with MiniScatter.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef TrackingAction_h
+#define TrackingAction_h 1
+
+#include "G4UserTrackingAction.hh"
+#include "G4VUserTrackInformation.hh"
+#include "G4Track.hh"
+#include "globals.hh"
+
+//--------------------------------------------------------------------------------
+
+// Index of the primary that a track descends from,
+// for when each event contains several primaries (--primariesPerEvent).
+
+class PrimaryTrackInformation : public G4VUserTrackInformation {
+public:
+    PrimaryTrackInformation(G4int primaryIdx_in) : primaryIdx(primaryIdx_in) {};
+    virtual ~PrimaryTrackInformation(){};
+
+    G4int GetPrimaryIdx() const {return primaryIdx;};
+
+    // 0 if the track has no PrimaryTrackInformation, i.e. with one primary per event
+    static G4int GetPrimaryIdx(const G4Track* track) {
+        const G4VUserTrackInformation* info = track->GetUserInformation();
+        return info == NULL ? 0 : static_cast<const PrimaryTrackInformation*>(info)->GetPrimaryIdx();
+    };
+
+private:
+    G4int primaryIdx;
+};
+
+//--------------------------------------------------------------------------------
+
+// Tags the primaries with their index in the event, and passes the index on to their secondaries.
+// The primaries are assumed to get the track IDs 1,2,3,... in the order they were generated.
+
+class TrackingAction : public G4UserTrackingAction {
+public:
+    TrackingAction(){};
+    virtual ~TrackingAction(){};
+
+    void PreUserTrackingAction(const G4Track* aTrack);
+    void PostUserTrackingAction(const G4Track* aTrack);
+};
+
+//--------------------------------------------------------------------------------
+
+#endif
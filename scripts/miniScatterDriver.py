@@ -29,9 +29,12 @@ def runScatter(simSetup, quiet=False):
         if not key in ("THICK", "MAT", "PRESS", "DIST", "ANG", "TARG_ANG", "WORLDSIZE", "PHYS",\
                        "N", "ENERGY", "ENERGY_FLAT",\
                        "BEAM", "XOFFSET", "ZOFFSET", "ZOFFSET_BACKTRACK",\
-                       "COVAR", "BEAM_RCUT", "SEED", \
+                       "COVAR", "COVAR_MATRIX", "BEAM_RCUT", "SEED", \
                        "OUTNAME", "OUTFOLDER", "QUICKMODE", "MINIROOT",\
-                       "CUTOFF_ENERGYFRACTION", "CUTOFF_RADIUS", "EDEP_DZ", "ENG_NBINS"):
+                       "CUTOFF_ENERGYFRACTION", "CUTOFF_RADIUS", "EDEP_DZ", "ENG_NBINS",\
+                       "KILL_AFTER_TRACKER", "KILL_BACKWARD", "KILL_ENERGY", "NO_STACK",\
+                       "REGION", "IMPORTANCE", "XS_BIAS", "PHASESPACE_OUT", "PHASESPACE_IN", "BEAM_FILE", "BEAM_HIST", "FAST_TARGET",\
+                       "LOOPER_THRESHOLDS", "EVENT_BUDGET", "PRIMARIES_PER_EVENT", "MASSWORLD_SCORING", "PLANES", "TARGET_PLANES", "PROJECT"):
             if key.startswith("MAGNET"):
                 continue
             raise KeyError("Did not expect key {} in the simSetup".format(key))
@@ -101,6 +104,11 @@ def runScatter(simSetup, quiet=False):
         else:
             raise ValueError("Expected len(COVAR) == 3 or 6")
 
+    if "COVAR_MATRIX" in simSetup:
+        if not len(simSetup["COVAR_MATRIX"]) in (10,21):
+            raise ValueError("Expected len(COVAR_MATRIX) == 10 (4D) or 21 (6D)")
+        cmd += ["--covarMatrix", ",".join(map(str,simSetup["COVAR_MATRIX"]))]
+
     if "BEAM_RCUT" in simSetup:
         cmd += ["--beamRcut", str(simSetup["BEAM_RCUT"])]
 
@@ -137,6 +145,87 @@ def runScatter(simSetup, quiet=False):
     if "ENG_NBINS" in simSetup:
         cmd += ["--engNbins", str(simSetup["ENG_NBINS"])]
 
+    if "KILL_AFTER_TRACKER" in simSetup:
+        if simSetup["KILL_AFTER_TRACKER"] == True:
+            cmd += ["--killAfterTracker"]
+        else:
+            assert simSetup["KILL_AFTER_TRACKER"] == False
+
+    if "KILL_BACKWARD" in simSetup:
+        if simSetup["KILL_BACKWARD"] == True:
+            cmd += ["--killBackward"]
+        else:
+            assert simSetup["KILL_BACKWARD"] == False
+
+    if "KILL_ENERGY" in simSetup:
+        #Expecting a dict {PDG : E[MeV]}
+        cmd += ["--killEnergy", ",".join([str(int(k))+":"+str(float(v)) for k,v in simSetup["KILL_ENERGY"].items()])]
+
+    if "NO_STACK" in simSetup:
+        #Expecting a list of PDG ids
+        cmd += ["--noStack", ",".join([str(int(p)) for p in simSetup["NO_STACK"]])]
+
+    if "LOOPER_THRESHOLDS" in simSetup:
+        #Expecting a tuple (warnE[MeV], importantE[MeV], trials), -1 => Geant4 default
+        (warnE, importantE, trials) = simSetup["LOOPER_THRESHOLDS"]
+        cmd += ["--looperThresholds", str(float(warnE))+":"+str(float(importantE))+":"+str(int(trials))]
+
+    if "EVENT_BUDGET" in simSetup:
+        #Expecting maxSteps, or a tuple (maxSteps, maxTime[s])
+        if type(simSetup["EVENT_BUDGET"]) == tuple:
+            cmd += ["--eventBudget", str(int(simSetup["EVENT_BUDGET"][0]))+":"+str(float(simSetup["EVENT_BUDGET"][1]))]
+        else:
+            cmd += ["--eventBudget", str(int(simSetup["EVENT_BUDGET"]))]
+
+    if "PRIMARIES_PER_EVENT" in simSetup:
+        cmd += ["--primariesPerEvent", str(int(simSetup["PRIMARIES_PER_EVENT"]))]
+
+    if "REGION" in simSetup:
+        #Expecting a dict {name : {key : val}}
+        for name,keyval in simSetup["REGION"].items():
+            reg_cmd = str(name)
+            for k,v in keyval.items():
+                reg_cmd += ":" + str(k)+"="+str(v)
+            cmd += ["--region", reg_cmd]
+
+    if "IMPORTANCE" in simSetup:
+        cmd += ["--importance", str(simSetup["IMPORTANCE"])]
+
+    if "XS_BIAS" in simSetup:
+        cmd += ["--xsBias", str(simSetup["XS_BIAS"])]
+
+    if "PHASESPACE_OUT" in simSetup:
+        cmd += ["--phaseSpaceOut", str(simSetup["PHASESPACE_OUT"])]
+    if "PHASESPACE_IN" in simSetup:
+        cmd += ["--phaseSpaceIn", str(simSetup["PHASESPACE_IN"])]
+    if "BEAM_FILE" in simSetup:
+        cmd += ["--beamFile", str(simSetup["BEAM_FILE"])]
+    if "BEAM_HIST" in simSetup:
+        #List of 'filename:histname:coords'
+        for beamHist in simSetup["BEAM_HIST"]:
+            cmd += ["--beamHist", str(beamHist)]
+
+    if "FAST_TARGET" in simSetup:
+        cmd += ["--fastTarget", str(simSetup["FAST_TARGET"])]
+
+    if "MASSWORLD_SCORING" in simSetup:
+        if simSetup["MASSWORLD_SCORING"] == True:
+            cmd += ["--massWorldScoring"]
+        else:
+            assert simSetup["MASSWORLD_SCORING"] == False
+
+    if "PLANES" in simSetup:
+        #Expecting a list of z positions [mm]
+        cmd += ["--plane", ",".join([str(float(z)) for z in simSetup["PLANES"]])]
+
+    if "TARGET_PLANES" in simSetup:
+        #Expecting a list of depths into the target [mm]
+        cmd += ["--targetPlane", ",".join([str(float(d)) for d in simSetup["TARGET_PLANES"]])]
+
+    if "PROJECT" in simSetup:
+        #Expecting a list of z positions [mm]
+        cmd += ["--project", ",".join([str(float(z)) for z in simSetup["PROJECT"]])]
+
     if "MAGNET" in simSetup:
         for mag in simSetup["MAGNET"]:
             mag_cmd = ""
@@ -164,6 +253,31 @@ def runScatter(simSetup, quiet=False):
     if not quiet:
         print ("Done!")
 
+def writeBeamFile(filename, x, xp, y, yp, E, PDG, weight=None):
+    """
+    Writes a beam file for use with --beamFile / BEAM_FILE.
+    x,y [mm], xp,yp [rad], E = kinetic energy [MeV], PDG = particle code (scalar or array),
+    weight = statistical weight (default 1.0).
+    """
+    import numpy as np
+
+    x = np.asarray(x)
+    N = len(x)
+    records = np.empty(N, dtype=[("x","<f4"),("xp","<f4"),("y","<f4"),("yp","<f4"),
+                                 ("E","<f4"),("weight","<f4"),("PDG","<i4")])
+    records["x"]      = x
+    records["xp"]     = xp
+    records["y"]      = y
+    records["yp"]     = yp
+    records["E"]      = E
+    records["weight"] = 1.0 if weight is None else weight
+    records["PDG"]    = PDG
+
+    with open(filename, "wb") as beamFile:
+        beamFile.write(b"MSBEAM1\0")
+        beamFile.write(np.array([N], dtype="<u8").tobytes())
+        records.tofile(beamFile)
+
 #Names of the planes in which the twiss parameters / number of particles of each type
 # have been extracted
 twissDets    = ("init","target_exit","target_exit_cutoff","tracker","tracker_cutoff")
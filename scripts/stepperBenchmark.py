@@ -0,0 +1,99 @@
+#!/usr/bin/env python3
+
+"""
+This file is part of MiniScatter.
+
+MiniScatter is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+MiniScatter is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with MiniScatter.  If not, see <https://www.gnu.org/licenses/>.
+"""
+
+## Script to compare the field integration settings (stepper and accuracy parameters)
+## for a plasma lens, reporting the time per event and the deviation of the emittance
+## at the tracker from a high-accuracy reference run.
+## Usage: ./stepperBenchmark.py (N) (gradient [T/m])
+
+import sys
+import os
+import time
+
+import miniScatterDriver
+
+N        = 10000
+GRADIENT = 300.0 #[T/m]
+if len(sys.argv) > 1:
+    N = int(sys.argv[1])
+if len(sys.argv) > 2:
+    GRADIENT = float(sys.argv[2])
+
+OUTFOLDER = os.path.join(os.path.dirname(os.path.abspath(__file__)), "plots", "stepperBenchmark")
+os.makedirs(OUTFOLDER, exist_ok=True)
+
+baseSetup = {}
+baseSetup["THICK"]     = 0.0
+baseSetup["DIST"]      = 300.0 #[mm]
+baseSetup["ENERGY"]    = 200.0 #[MeV]
+baseSetup["BEAM"]      = "e-"
+baseSetup["COVAR"]     = (1.0, 0.1, 0.0) #epsN [um], beta [m], alpha
+baseSetup["PHYS"]      = "QGSP_FTFP_BERT__SS"
+baseSetup["SEED"]      = 123
+baseSetup["QUICKMODE"] = True
+baseSetup["MINIROOT"]  = True
+baseSetup["OUTFOLDER"] = OUTFOLDER
+
+lensKeyval = {"radius":0.5, "width":4.0, "height":4.0}
+
+# Name -> field integration key=val pairs
+settings = [("reference",        {"stepper":"DormandPrince745", "deltaChord":1e-4, "deltaOneStep":1e-5,
+                                  "deltaIntersection":1e-5, "epsMin":1e-8, "epsMax":1e-7}),
+            ("ClassicalRK4",     {"stepper":"ClassicalRK4"}),
+            ("DormandPrince745", {"stepper":"DormandPrince745"}),
+            ("BogackiShampine23",{"stepper":"BogackiShampine23"}),
+            ("BogackiShampine45",{"stepper":"BogackiShampine45"}),
+            ("CashKarpRKF45",    {"stepper":"CashKarpRKF45"}),
+            ("NystromRK4",       {"stepper":"NystromRK4"}),
+            ("PlasmaLens",       {"stepper":"PlasmaLens"}),
+            ("DP745_loose",      {"stepper":"DormandPrince745", "deltaChord":0.1, "deltaOneStep":0.1,
+                                  "epsMin":1e-4, "epsMax":1e-3}),
+            ("NystromRK4_loose", {"stepper":"NystromRK4", "deltaChord":0.1, "deltaOneStep":0.1,
+                                  "epsMin":1e-4, "epsMax":1e-3})]
+
+def runSetting(name, fieldKeyval, numEvents):
+    simSetup = baseSetup.copy()
+    simSetup["N"]       = numEvents
+    simSetup["OUTNAME"] = "stepperBenchmark_" + name
+    keyval = lensKeyval.copy()
+    keyval.update(fieldKeyval)
+    simSetup["MAGNET"] = [{"pos":5.0, "mag_pos_relative":True, "type":"PLASMA1",
+                           "length":15.0, "gradient":GRADIENT, "keyval":keyval}]
+    t0 = time.time()
+    miniScatterDriver.runScatter(simSetup, quiet=True)
+    return time.time()-t0, os.path.join(OUTFOLDER, simSetup["OUTNAME"]+".root")
+
+results = {}
+for (name, fieldKeyval) in settings:
+    print("Running '{}'...".format(name))
+    # Subtract the initialization time, measured by a run with no events
+    (tInit, dummy) = runSetting(name, fieldKeyval, 0)
+    (tRun, rootFile) = runSetting(name, fieldKeyval, N)
+    (twiss, numPart, objects) = miniScatterDriver.getData(rootFile, quiet=True)
+    results[name] = ((tRun-tInit)/N, twiss["tracker"]["x"]["eps"], twiss["tracker"]["y"]["eps"])
+
+(tRef, epsRefX, epsRefY) = results["reference"]
+print()
+print("{:20s} {:>16s} {:>12s} {:>16s} {:>16s}".format("Setting", "Time/event [ms]", "Speedup",
+                                                      "d(eps_x)/eps [%]", "d(eps_y)/eps [%]"))
+for (name, fieldKeyval) in settings:
+    (t, epsX, epsY) = results[name]
+    print("{:20s} {:16.4f} {:12.2f} {:16.4f} {:16.4f}".format(name, t*1e3, tRef/t,
+                                                          (epsX-epsRefX)/epsRefX*100,
+                                                          (epsY-epsRefY)/epsRefY*100))
@@ -0,0 +1,54 @@
+/*
+ * This file is part of MiniScatter.
+ *
+ *  MiniScatter is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  MiniScatter is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with MiniScatter.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "AbsorberFastSimModel.hh"
+
+#include "RootFileWriter.hh"
+
+#include "G4FastTrack.hh"
+#include "G4FastStep.hh"
+#include "G4Track.hh"
+#include "G4ParticleDefinition.hh"
+#include "G4VPhysicalVolume.hh"
+#include "G4LogicalVolume.hh"
+
+//--------------------------------------------------------------------------------
+
+AbsorberFastSimModel::AbsorberFastSimModel(G4String modelName, G4Region* envelope, G4String counterName_in) :
+    G4VFastSimulationModel(modelName, envelope),
+    counterName(counterName_in) {
+}
+
+G4bool AbsorberFastSimModel::ModelTrigger(const G4FastTrack& fastTrack) {
+    // Not in daughter volumes, e.g. an aperture
+    return fastTrack.GetPrimaryTrack()->GetVolume()->GetLogicalVolume() == fastTrack.GetEnvelopeLogicalVolume();
+}
+
+void AbsorberFastSimModel::DoIt(const G4FastTrack& fastTrack, G4FastStep& fastStep) {
+    const G4Track* track = fastTrack.GetPrimaryTrack();
+
+    fastStep.KillPrimaryTrack();
+    fastStep.ProposePrimaryTrackPathLength(0.0);
+    fastStep.ProposeTotalEnergyDeposited(track->GetKineticEnergy());
+
+    RootFileWriter::GetInstance()->CountKilledTrack(counterName,
+                                                    track->GetDefinition()->GetPDGEncoding(),
+                                                    track->GetDefinition()->GetParticleSubType(),
+                                                    track->GetWeight());
+}
+
+//--------------------------------------------------------------------------------
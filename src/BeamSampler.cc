@@ -0,0 +1,274 @@
+/*
+ * This file is part of MiniScatter.
+ *
+ *  MiniScatter is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  MiniScatter is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with MiniScatter.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "BeamSampler.hh"
+
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wshadow"
+#include "TMatrixD.h"
+#include "TDecompChol.h"
+#include "TMath.h"
+#pragma GCC diagnostic pop
+
+#include <cmath>
+#include <cfloat>
+#include <algorithm>
+
+// -----------------------------------------------------------------------------------------
+
+BeamSampler::BeamSampler(G4long seed, G4int blockSize_in) :
+    blockSize(blockSize_in) {
+    // G4Random is also MixMax, seeded with setTheSeed(seed).
+    // Use the same seed with a separate stream ID, so that the beam is not correlated with the physics.
+    const long seeds[2] = {seed, streamID};
+    engine.setSeeds(seeds, 2);
+
+    blockPos = blockSize;
+}
+
+void BeamSampler::SetCovariance(const TMatrixD& covar) {
+    dim = covar.GetNrows();
+    if (dim != covar.GetNcols() or dim < 1 or dim > maxDim) {
+        G4cerr << "Error in BeamSampler::SetCovariance():" << G4endl
+               << " Expected a square matrix of size 1..." << maxDim << ", got "
+               << covar.GetNrows() << "x" << covar.GetNcols() << G4endl;
+        exit(1);
+    }
+
+    // ROOT's cholesky routine returns the upper-triangular U = L^T
+    TDecompChol covar_Utmp(covar,1e-9);
+    if (not covar_Utmp.Decompose()) {
+        G4cerr << "Error in BeamSampler::SetCovariance():" << G4endl
+               << " The covariance matrix is not positive definite." << G4endl;
+        covar.Print();
+        exit(1);
+    }
+    const TMatrixD& U = covar_Utmp.GetU();
+    for (G4int i = 0; i < maxDim; i++) {
+        for (G4int j = 0; j < maxDim; j++) {
+            L[i][j] = (i < dim and j <= i) ? U[j][i] : 0.0;
+            C[i][j] = (i < dim and j < dim) ? covar[i][j] : 0.0;
+        }
+    }
+    hasCut = false;
+
+    // The buffers always hold an even number of normals for Box-Muller
+    const G4int numNormals = blockSize*dim + (blockSize*dim)%2;
+    uniforms.resize(numNormals);
+    normals.resize(numNormals);
+    block.resize(blockSize*dim);
+    blockPos = blockSize;
+}
+
+void BeamSampler::FillNormals() {
+    const G4int numNormals = normals.size();
+    engine.flatArray(numNormals, uniforms.data());
+
+    // Box-Muller; plain loops over the arrays, so that the compiler can vectorise them
+    const G4double* __restrict__ u = uniforms.data();
+    G4double* __restrict__ n = normals.data();
+    for (G4int i = 0; i < numNormals; i += 2) {
+        const G4double r     = sqrt(-2.0*log(std::max(u[i],DBL_MIN)));
+        const G4double theta = 2.0*M_PI*u[i+1];
+        n[i]   = r*cos(theta);
+        n[i+1] = r*sin(theta);
+    }
+}
+
+void BeamSampler::FillBlock() {
+    FillNormals();
+
+    // Correlate
+    const G4double* __restrict__ n = normals.data();
+    G4double* __restrict__ b = block.data();
+    for (G4int k = 0; k < blockSize; k++) {
+        const G4double* nk = n + k*dim;
+        G4double*       bk = b + k*dim;
+        for (G4int i = 0; i < dim; i++) {
+            G4double sum = 0.0;
+            for (G4int j = 0; j <= i; j++) {
+                sum += L[i][j]*nk[j];
+            }
+            bk[i] = sum;
+        }
+    }
+
+    blockPos = 0;
+}
+
+void BeamSampler::SetRadialCut(G4double R, G4double x0, G4double y0) {
+    if (dim < 3) {
+        G4cerr << "Error in BeamSampler::SetRadialCut():" << G4endl
+               << " Expected a covariance matrix including x and y, got dim = " << dim << G4endl;
+        exit(1);
+    }
+    if (R <= 0.0) {
+        G4cerr << "Error in BeamSampler::SetRadialCut():" << G4endl
+               << " Expected R > 0, got " << R << G4endl;
+        exit(1);
+    }
+    cutR = R;
+
+    // Principal axes of the (x,y) covariance; the cut circle is invariant under the rotation
+    const G4double sxx = C[0][0];
+    const G4double sxy = C[0][2];
+    const G4double syy = C[2][2];
+    const G4double theta = 0.5*atan2(2*sxy, sxx-syy);
+    cutCos = cos(theta);
+    cutSin = sin(theta);
+    cutSig1 = sqrt(sxx*cutCos*cutCos + 2*sxy*cutSin*cutCos + syy*cutSin*cutSin);
+    cutSig2 = sqrt(sxx*cutSin*cutSin - 2*sxy*cutSin*cutCos + syy*cutCos*cutCos);
+    cutC1 =  cutCos*x0 + cutSin*y0;
+    cutC2 = -cutSin*x0 + cutCos*y0;
+
+    cutRound = fabs(cutSig1-cutSig2) < 1e-9*cutSig1 and x0 == 0.0 and y0 == 0.0;
+    if (not cutRound) {
+        // The marginal of a1 is the gaussian times the probability of a2 falling inside the circle;
+        // tabulate its CDF, the inversion then costs the same for any cut.
+        const G4int numTable = 4096;
+        cutTableA.resize(numTable);
+        cutTableCDF.resize(numTable);
+        G4double pdf_prev = 0.0;
+        for (G4int i = 0; i < numTable; i++) {
+            const G4double a1 = -cutC1 - cutR + 2*cutR*i/(numTable-1);
+            const G4double h2 = cutR*cutR - (a1+cutC1)*(a1+cutC1);
+            const G4double h  = h2 > 0.0 ? sqrt(h2) : 0.0;
+            G4double lo = (-cutC2 - h)/cutSig2;
+            G4double hi = (-cutC2 + h)/cutSig2;
+            if (lo > 0.0) {
+                std::swap(lo,hi);
+                lo = -lo; hi = -hi;
+            }
+            const G4double pdf = exp(-0.5*a1*a1/(cutSig1*cutSig1)) * (TMath::Freq(hi) - TMath::Freq(lo));
+            cutTableA[i]   = a1;
+            cutTableCDF[i] = (i == 0) ? 0.0 : cutTableCDF[i-1] + 0.5*(pdf+pdf_prev);
+            pdf_prev = pdf;
+        }
+        if (not (cutTableCDF.back() > 0.0)) {
+            G4cerr << "Error in BeamSampler::SetRadialCut():" << G4endl
+                   << " The cut R = " << R << " at (" << x0 << "," << y0 << ")"
+                   << " contains no part of the beam distribution." << G4endl;
+            exit(1);
+        }
+        for (auto& cdf : cutTableCDF) {
+            cdf /= cutTableCDF.back();
+        }
+    }
+
+    // Distribution of the other coordinates conditional on (x,y):
+    // mean K*(x,y) with K = C_oP * C_PP^-1, covariance C_oo - K * C_Po.
+    numOther = 0;
+    for (G4int i = 0; i < dim; i++) {
+        if (i != 0 and i != 2) {
+            idxOther[numOther++] = i;
+        }
+    }
+    const G4double det = sxx*syy - sxy*sxy;
+    for (G4int i = 0; i < numOther; i++) {
+        const G4int o = idxOther[i];
+        K[i][0] = ( C[o][0]*syy - C[o][2]*sxy)/det;
+        K[i][1] = (-C[o][0]*sxy + C[o][2]*sxx)/det;
+    }
+    if (numOther > 0) {
+        TMatrixD covarCond(numOther,numOther);
+        for (G4int i = 0; i < numOther; i++) {
+            for (G4int j = 0; j < numOther; j++) {
+                covarCond[i][j] = C[idxOther[i]][idxOther[j]]
+                    - K[i][0]*C[0][idxOther[j]] - K[i][1]*C[2][idxOther[j]];
+            }
+        }
+        TDecompChol covarCond_Utmp(covarCond,1e-9);
+        if (not covarCond_Utmp.Decompose()) {
+            G4cerr << "Error in BeamSampler::SetRadialCut():" << G4endl
+                   << " The conditional covariance matrix is not positive definite." << G4endl;
+            covarCond.Print();
+            exit(1);
+        }
+        const TMatrixD& U = covarCond_Utmp.GetU();
+        for (G4int i = 0; i < numOther; i++) {
+            for (G4int j = 0; j < numOther; j++) {
+                Lcond[i][j] = (j <= i) ? U[j][i] : 0.0;
+            }
+        }
+    }
+
+    cutUniforms.resize(2*blockSize);
+    hasCut   = true;
+    blockPos = blockSize;
+}
+
+void BeamSampler::FillBlockCut() {
+    // The gaussians for the other coordinates are the normals of the (x,y)-free slots
+    FillNormals();
+    engine.flatArray(2*blockSize, cutUniforms.data());
+
+    const G4double* __restrict__ n = normals.data();
+    const G4double* __restrict__ u = cutUniforms.data();
+    G4double* __restrict__ b = block.data();
+    for (G4int k = 0; k < blockSize; k++) {
+        G4double a1;
+        G4double a2;
+        if (cutRound) {
+            // r^2 is exponentially distributed; invert its CDF truncated at R
+            const G4double norm = -expm1(-0.5*cutR*cutR/(cutSig1*cutSig1));
+            const G4double r    = cutSig1*sqrt(-2.0*log1p(-u[2*k]*norm));
+            const G4double t    = 2.0*M_PI*u[2*k+1];
+            a1 = r*cos(t);
+            a2 = r*sin(t);
+        }
+        else {
+            const auto it = std::upper_bound(cutTableCDF.begin()+1, cutTableCDF.end()-1, u[2*k]);
+            const size_t i = it - cutTableCDF.begin();
+            const G4double dCDF = cutTableCDF[i] - cutTableCDF[i-1];
+            const G4double frac = dCDF > 0.0 ? (u[2*k] - cutTableCDF[i-1]) / dCDF : 0.5;
+            a1 = cutTableA[i-1] + frac*(cutTableA[i] - cutTableA[i-1]);
+
+            const G4double h2 = cutR*cutR - (a1+cutC1)*(a1+cutC1);
+            const G4double h  = h2 > 0.0 ? sqrt(h2) : 0.0;
+            a2 = TruncatedGaussian(-cutC2 - h, -cutC2 + h, cutSig2, u[2*k+1]);
+        }
+
+        const G4double x = a1*cutCos - a2*cutSin;
+        const G4double y = a1*cutSin + a2*cutCos;
+        const G4double* nk = n + k*dim;
+        G4double*       bk = b + k*dim;
+        bk[0] = x;
+        bk[2] = y;
+        for (G4int i = 0; i < numOther; i++) {
+            G4double sum = K[i][0]*x + K[i][1]*y;
+            for (G4int j = 0; j <= i; j++) {
+                sum += Lcond[i][j]*nk[idxOther[j]];
+            }
+            bk[idxOther[i]] = sum;
+        }
+    }
+
+    blockPos = 0;
+}
+
+G4double BeamSampler::TruncatedGaussian(G4double lo, G4double hi, G4double sigma, G4double u) {
+    if (lo > 0.0) {
+        // Work in the lower tail, where the CDF is accurate
+        return -TruncatedGaussian(-hi, -lo, sigma, u);
+    }
+    const G4double Flo = TMath::Freq(lo/sigma);
+    const G4double Fhi = TMath::Freq(hi/sigma);
+    const G4double p   = std::min(std::max(Flo + u*(Fhi-Flo), DBL_MIN), 1.0-DBL_EPSILON);
+    return sigma*TMath::NormQuantile(p);
+}
+
+// -----------------------------------------------------------------------------------------
@@ -0,0 +1,225 @@
+/*
+ * This file is part of MiniScatter.
+ *
+ *  MiniScatter is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  MiniScatter is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with MiniScatter.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "CrossSectionBiasing.hh"
+
+#include "G4BOptnChangeCrossSection.hh"
+#include "G4BiasingProcessInterface.hh"
+#include "G4BiasingProcessSharedData.hh"
+#include "G4GenericBiasingPhysics.hh"
+#include "G4VModularPhysicsList.hh"
+#include "G4ParticleTable.hh"
+#include "G4ParticleDefinition.hh"
+#include "G4ProcessManager.hh"
+#include "G4Track.hh"
+
+#include <string>
+
+//--------------------------------------------------------------------------------
+
+CrossSectionBiasingOperator::CrossSectionBiasingOperator(G4String inputString) :
+    G4VBiasingOperator("CrossSectionBiasingOperator") {
+    //Split by ':'
+    std::vector<G4String> argList;
+    str_size startPos = 0;
+    str_size endPos = 0;
+    do {
+        endPos   = inputString.index(":",startPos);
+        argList.push_back(inputString(startPos,endPos-startPos));
+        startPos = endPos+1;
+    } while (endPos != std::string::npos);
+
+    try {
+        factor = std::stod(std::string(argList[0]));
+    }
+    catch (const std::invalid_argument& ia) {
+        G4cerr << "Invalid argument when reading cross section biasing factor" << G4endl
+               << "Got: '" << argList[0] << "'" << G4endl
+               << "Expected a floating point number! (exponential notation is accepted)" << G4endl;
+        exit(1);
+    }
+    if (factor <= 0.0) {
+        G4cerr << "Error in CrossSectionBiasingOperator: The factor must be > 0" << G4endl;
+        exit(1);
+    }
+
+    for (size_t i = 1; i < argList.size(); i++) {
+        str_size eqPos = argList[i].index("=",0);
+        if (eqPos == std::string::npos) {
+            G4cerr << "Error when parsing key=val pair '" << argList[i] << "', no '=' found!" << G4endl;
+            exit(1);
+        }
+        G4String k = argList[i](0,eqPos);
+        G4String v = argList[i](eqPos+1,std::string::npos);
+
+        std::vector<G4String>* nameList = NULL;
+        if (k == "particles") {
+            nameList = &particleNames;
+        }
+        else if (k == "processes") {
+            nameList = &processNames;
+        }
+        else {
+            G4cerr << "Error in CrossSectionBiasingOperator: Unknown key '" << k << "' "
+                   << "(value = '" << v << "')" << G4endl;
+            exit(1);
+        }
+
+        // Comma-separated list of names
+        str_size pStart = 0;
+        str_size pEnd   = 0;
+        do {
+            pEnd = v.index(",",pStart);
+            G4String name = v(pStart,pEnd-pStart);
+            if (name != "") {
+                nameList->push_back(name);
+            }
+            pStart = pEnd+1;
+        } while (pEnd != std::string::npos);
+    }
+
+    if (particleNames.empty()) {
+        particleNames = {"e-", "e+", "gamma", "proton"};
+    }
+}
+
+//--------------------------------------------------------------------------------
+
+void CrossSectionBiasingOperator::ConfigurePhysics(G4VModularPhysicsList* physlist) {
+    G4GenericBiasingPhysics* biasingPhysics = new G4GenericBiasingPhysics();
+    for (auto pName : particleNames) {
+        if (processNames.empty()) {
+            biasingPhysics->Bias(pName);
+        }
+        else {
+            biasingPhysics->PhysicsBias(pName, processNames);
+        }
+    }
+    physlist->RegisterPhysics(biasingPhysics);
+}
+
+//--------------------------------------------------------------------------------
+
+void CrossSectionBiasingOperator::Print() {
+    G4cout << "Initialized CrossSectionBiasingOperator, parameters:" << G4endl;
+    G4cout << "\t factor                  = " << factor << G4endl;
+    G4cout << "\t particles               =";
+    for (auto pName : particleNames) {
+        G4cout << " " << pName;
+    }
+    G4cout << G4endl;
+    G4cout << "\t processes               =";
+    if (processNames.empty()) {
+        G4cout << " (all)";
+    }
+    for (auto procName : processNames) {
+        G4cout << " " << procName;
+    }
+    G4cout << G4endl;
+}
+
+//--------------------------------------------------------------------------------
+
+void CrossSectionBiasingOperator::StartRun() {
+    if (isSetup) return;
+
+    for (auto pName : particleNames) {
+        const G4ParticleDefinition* particle = G4ParticleTable::GetParticleTable()->FindParticle(pName);
+        if (particle == NULL) {
+            G4cerr << "Error in CrossSectionBiasingOperator::StartRun(): "
+                   << "Particle '" << pName << "' not found." << G4endl;
+            exit(1);
+        }
+        particlesToBias.push_back(particle);
+
+        const G4BiasingProcessSharedData* sharedData =
+            G4BiasingProcessInterface::GetSharedData(particle->GetProcessManager());
+        if (sharedData == NULL) {
+            G4cerr << "Error in CrossSectionBiasingOperator::StartRun(): "
+                   << "No biased processes found for particle '" << pName << "'." << G4endl;
+            exit(1);
+        }
+        for (auto wrapperProcess : sharedData->GetPhysicsBiasingProcessInterfaces()) {
+            G4String operationName = "XSchange-" + wrapperProcess->GetWrappedProcess()->GetProcessName();
+            changeCrossSectionOperations[wrapperProcess] = new G4BOptnChangeCrossSection(operationName);
+        }
+    }
+
+    isSetup = true;
+}
+
+//--------------------------------------------------------------------------------
+
+G4VBiasingOperation*
+CrossSectionBiasingOperator::ProposeOccurenceBiasingOperation(const G4Track* track,
+                                                              const G4BiasingProcessInterface* callingProcess) {
+    G4bool biasThis = false;
+    for (auto particle : particlesToBias) {
+        if (track->GetDefinition() == particle) {
+            biasThis = true;
+            break;
+        }
+    }
+    if (not biasThis) return 0;
+
+    // Processes without a discrete part (e.g. multiple scattering) can not be scaled
+    G4double analogInteractionLength = callingProcess->GetWrappedProcess()->GetCurrentInteractionLength();
+    if (analogInteractionLength > DBL_MAX/10.0) return 0;
+    G4double analogXS = 1.0/analogInteractionLength;
+
+    auto it = changeCrossSectionOperations.find(callingProcess);
+    if (it == changeCrossSectionOperations.end()) return 0;
+    G4BOptnChangeCrossSection* operation = it->second;
+
+    G4VBiasingOperation* previousOperation = callingProcess->GetPreviousOccurenceBiasingOperation();
+    if (previousOperation == 0 or operation->GetInteractionOccured()) {
+        // New track, or the previous interaction happened: Sample a new interaction length
+        operation->SetBiasedCrossSection(factor*analogXS);
+        operation->Sample();
+    }
+    else {
+        if (previousOperation != operation) {
+            G4cerr << "Error in CrossSectionBiasingOperator::ProposeOccurenceBiasingOperation(): "
+                   << "Unexpected previous operation '" << previousOperation->GetName() << "'" << G4endl;
+            exit(1);
+        }
+        // Continue with the current interaction length,
+        // taking into account the step just taken and that the cross section may have changed
+        operation->UpdateForStep(callingProcess->GetPreviousStepSize());
+        operation->SetBiasedCrossSection(factor*analogXS);
+        operation->UpdateForStep(0.0);
+    }
+
+    return operation;
+}
+
+//--------------------------------------------------------------------------------
+
+void CrossSectionBiasingOperator::OperationApplied(const G4BiasingProcessInterface* callingProcess,
+                                                   G4BiasingAppliedCase,
+                                                   G4VBiasingOperation* occurenceOperationApplied,
+                                                   G4double,
+                                                   G4VBiasingOperation*,
+                                                   const G4VParticleChange*) {
+    auto it = changeCrossSectionOperations.find(callingProcess);
+    if (it == changeCrossSectionOperations.end()) return;
+    if (it->second == occurenceOperationApplied) {
+        it->second->SetInteractionOccured();
+    }
+}
+
+//--------------------------------------------------------------------------------
@@ -20,6 +20,7 @@
 #include "MyTrackerSD.hh"
 
 #include "MagnetClasses.hh"
+#include "RegionDefinition.hh"
 
 #include "G4Isotope.hh"
 #include "G4Element.hh"
@@ -57,7 +58,8 @@ DetectorConstruction::DetectorConstruction(G4double TargetThickness_in,
                                            G4double TargetAngle_in,
                                            G4bool   TargetRotated_in,
                                            G4double WorldSize_in,
-                                           std::vector <G4String> &magnetDefinitions_in) :
+                                           std::vector <G4String> &magnetDefinitions_in,
+                                           std::vector <G4String> &regionDefinitions_in) :
     solidWorld(0),logicWorld(0),physiWorld(0),
     solidTarget(0),logicTarget(0),physiTarget(0),
     magnetDefinitions(magnetDefinitions_in) {
@@ -233,6 +235,11 @@ DetectorConstruction::DetectorConstruction(G4double TargetThickness_in,
 
     DetectorMaterial = vacuumMaterial;
 
+    // Per-region physics settings (the G4Regions are built in Construct())
+    for (auto rds : regionDefinitions_in) {
+        regions.push_back(new RegionDefinition(rds));
+    }
+
     G4cout << G4endl;
 }
 
@@ -333,6 +340,26 @@ G4VPhysicalVolume* DetectorConstruction::Construct() {
     SDman->AddNewDetector(detectorSD);
     logicDetector->SetSensitiveDetector(detectorSD);
 
+    // Extra scoring planes, made just like the "detector"
+    for (size_t i = 0; i < scoringPlanes.size(); i++) {
+        const G4String planeName = GetScoringPlaneName(i);
+
+        G4Box*           planeS  = new G4Box(planeName+"S", DetectorSizeX/2,DetectorSizeY/2,DetectorThickness/2);
+        G4LogicalVolume* planeLV = new G4LogicalVolume(planeS, DetectorMaterial, planeName+"LV");
+        new G4PVPlacement(NULL,                                       //No rotation
+                          G4ThreeVector(0.0,0.0,scoringPlanes[i]),    //its position
+                          planeLV,                                    //its logical volume
+                          planeName+"PV",                             //its name
+                          logicWorld,                                 //its mother
+                          false,                                      //pMany not used
+                          0,                                          //copy number
+                          true);                                      //Check for overlaps
+
+        G4VSensitiveDetector* planeSD = new MyTrackerSD(planeName);
+        SDman->AddNewDetector(planeSD);
+        planeLV->SetSensitiveDetector(planeSD);
+    }
+
     // Build magnets
     for (auto magnet : magnets) {
         // More or less repeated in ParallelWorldConstruction::Construct()
@@ -347,6 +374,42 @@ G4VPhysicalVolume* DetectorConstruction::Construct() {
                                                           true);
 
         magnetPVs.push_back(magnetPV);
+
+        if (massWorldScoring) {
+            magnet->AddSD(true);
+        }
+    }
+
+    // Build regions
+    G4bool worldInactivated = false;
+    for (auto reg : regions) {
+        if (reg->GetName() == "world" and not reg->GetInactivate().empty()) {
+            worldInactivated = true;
+        }
+    }
+    // The target and objects must not inherit the processes switched off in the world,
+    // and objects with a fast simulation model need a region to attach it to,
+    // so give them their own (default) regions if they don't have one already.
+    std::vector<G4String> needRegion;
+    if (worldInactivated and HasTarget) {
+        needRegion.push_back("target");
+    }
+    for (auto magnet : magnets) {
+        if (worldInactivated or magnet->UsesFastSimulation()) {
+            needRegion.push_back(magnet->magnetName);
+        }
+    }
+    for (auto name : needRegion) {
+        G4bool found = false;
+        for (auto reg : regions) {
+            if (reg->GetName() == name) found = true;
+        }
+        if (not found) {
+            regions.push_back(new RegionDefinition(name));
+        }
+    }
+    for (auto reg : regions) {
+        reg->Construct(this);
     }
 
     return physiWorld;
@@ -354,6 +417,101 @@ G4VPhysicalVolume* DetectorConstruction::Construct() {
 
 //------------------------------------------------------------------------------
 
+void DetectorConstruction::SetScoringPlanes(std::vector<G4double> &scoringPlanes_in) {
+    if (TargetRotated or DetectorRotated) {
+        G4cerr << "Error in DetectorConstruction::SetScoringPlanes():" << G4endl
+               << " Scoring planes are not supported with a rotated target or detector." << G4endl;
+        exit(1);
+    }
+
+    scoringPlanes.clear();
+    for (auto z_in : scoringPlanes_in) {
+        const G4double z = z_in*mm;
+        const G4double zMin = z - DetectorThickness/2.0;
+        const G4double zMax = z + DetectorThickness/2.0;
+
+        G4String overlap = "";
+        if (HasTarget and zMin < TargetThickness/2.0 and zMax > -TargetThickness/2.0) {
+            overlap = "the target";
+        }
+        if (fabs(z - DetectorDistance) < DetectorThickness) {
+            overlap = "the tracker";
+        }
+        for (auto mag : magnets) {
+            if (zMin < mag->getZ0() + mag->GetLength()/2.0 and
+                zMax > mag->getZ0() - mag->GetLength()/2.0) {
+                overlap = mag->magnetName;
+            }
+        }
+        for (auto z_other : scoringPlanes) {
+            if (fabs(z - z_other) < DetectorThickness) {
+                overlap = "another scoring plane";
+            }
+        }
+        if (overlap != "") {
+            G4cerr << "Error in DetectorConstruction::SetScoringPlanes():" << G4endl
+                   << " The scoring plane at z = " << z/mm << " [mm] overlaps with " << overlap << "." << G4endl;
+            exit(1);
+        }
+
+        scoringPlanes.push_back(z);
+
+        // Make sure that the world is long enough
+        G4double WorldSizeZ_minimum = (fabs(z) + DetectorThickness + WorldSizeZ_buffer)*2.0;
+        if (WorldSizeZ < WorldSizeZ_minimum) {
+            WorldSizeZ = WorldSizeZ_minimum;
+        }
+    }
+
+    G4cout << "Scoring planes:" << G4endl;
+    for (size_t i = 0; i < scoringPlanes.size(); i++) {
+        G4cout << "\t " << GetScoringPlaneName(i) << " z = " << scoringPlanes[i]/mm << " [mm]" << G4endl;
+    }
+    G4cout << G4endl;
+}
+
+//------------------------------------------------------------------------------
+
+void DetectorConstruction::SetTargetPlanes(std::vector<G4double> &targetPlanes_in) {
+    if (not HasTarget) {
+        G4cerr << "Error in DetectorConstruction::SetTargetPlanes():" << G4endl
+               << " Target planes requires a target." << G4endl;
+        exit(1);
+    }
+    if (TargetRotated) {
+        G4cerr << "Error in DetectorConstruction::SetTargetPlanes():" << G4endl
+               << " Target planes are not supported with a rotated target." << G4endl;
+        exit(1);
+    }
+
+    targetPlanes.clear();
+    for (auto depth_in : targetPlanes_in) {
+        const G4double depth = depth_in*mm;
+        if (depth <= 0.0 or depth + DetectorThickness >= TargetThickness) {
+            G4cerr << "Error in DetectorConstruction::SetTargetPlanes():" << G4endl
+                   << " The target plane at depth " << depth/mm << " [mm] is not inside the target, "
+                   << "which is " << TargetThickness/mm << " [mm] thick." << G4endl;
+            exit(1);
+        }
+        for (auto depth_other : targetPlanes) {
+            if (fabs(depth - depth_other) < DetectorThickness) {
+                G4cerr << "Error in DetectorConstruction::SetTargetPlanes():" << G4endl
+                       << " The target plane at depth " << depth/mm << " [mm] overlaps with another target plane." << G4endl;
+                exit(1);
+            }
+        }
+        targetPlanes.push_back(depth);
+    }
+
+    G4cout << "Target planes:" << G4endl;
+    for (size_t i = 0; i < targetPlanes.size(); i++) {
+        G4cout << "\t " << GetTargetPlaneName(i) << " depth = " << targetPlanes[i]/mm << " [mm]" << G4endl;
+    }
+    G4cout << G4endl;
+}
+
+//------------------------------------------------------------------------------
+
 void DetectorConstruction::DefineMaterials() {
     // List of available materials:
     // http://geant4-userdoc.web.cern.ch/geant4-userdoc/UsersGuides/ForApplicationDeveloper/html/Appendix/materialNames.html
@@ -667,3 +825,31 @@ void DetectorConstruction::PostInitialize() {
         mag->PostInitialize();
     }
 }
+
+//------------------------------------------------------------------------------
+
+G4bool DetectorConstruction::IsInScoringVolume(const G4VTouchable* touchable) const {
+    if (touchable == NULL or touchable->GetVolume() == NULL) {
+        return false;
+    }
+    // The target and the magnet main volumes are all placed directly in the world,
+    // so it is enough to search the volume and its ancestors.
+    // The magnet main volumes are vacuum boxes nearly as wide as the world,
+    // so only their non-vacuum daughters (jaws, plasma, yokes, ...) are counted.
+    const G4bool isVacuum = touchable->GetVolume()->GetLogicalVolume()->GetMaterial()->GetName() == "G4_Galactic";
+    for (G4int depth = 0; depth < touchable->GetHistoryDepth(); depth++) {
+        const G4VPhysicalVolume* PV = touchable->GetVolume(depth);
+        if (HasTarget and PV == physiTarget) {
+            return true;
+        }
+        if (depth == 0 or isVacuum) {
+            continue;
+        }
+        for (auto magnetPV : magnetPVs) {
+            if (PV == magnetPV) {
+                return true;
+            }
+        }
+    }
+    return false;
+}
@@ -0,0 +1,70 @@
+/*
+ * This file is part of MiniScatter.
+ *
+ *  MiniScatter is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  MiniScatter is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with MiniScatter.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "DriftProjection.hh"
+
+//--------------------------------------------------------------------------------
+
+void DriftBuffer::Add(G4double x_in, G4double y_in, G4double z_in,
+                      G4double xp_in, G4double yp_in, G4double E_in,
+                      G4double weight_in, G4int PDG_in, G4int charge_in, G4int primaryIdx_in) {
+    x.push_back(x_in);
+    y.push_back(y_in);
+    z.push_back(z_in);
+    xp.push_back(xp_in);
+    yp.push_back(yp_in);
+    E.push_back(E_in);
+    weight.push_back(weight_in);
+    PDG.push_back(PDG_in);
+    charge.push_back(charge_in);
+    primaryIdx.push_back(primaryIdx_in);
+}
+
+void DriftBuffer::Clear() {
+    x.clear();
+    y.clear();
+    z.clear();
+    xp.clear();
+    yp.clear();
+    E.clear();
+    weight.clear();
+    PDG.clear();
+    charge.clear();
+    primaryIdx.clear();
+}
+
+void DriftBuffer::Project(G4double zProj, std::vector<G4double>& xOut, std::vector<G4double>& yOut) const {
+    const size_t n = x.size();
+    xOut.resize(n);
+    yOut.resize(n);
+
+    // Plain loop over contiguous arrays without aliasing, so that the compiler can vectorise it
+    const G4double* __restrict__ x_p  = x.data();
+    const G4double* __restrict__ y_p  = y.data();
+    const G4double* __restrict__ z_p  = z.data();
+    const G4double* __restrict__ xp_p = xp.data();
+    const G4double* __restrict__ yp_p = yp.data();
+    G4double* __restrict__ xOut_p = xOut.data();
+    G4double* __restrict__ yOut_p = yOut.data();
+    for (size_t i = 0; i < n; i++) {
+        const G4double dz = zProj - z_p[i];
+        xOut_p[i] = x_p[i] + xp_p[i]*dz;
+        yOut_p[i] = y_p[i] + yp_p[i]*dz;
+    }
+}
+
+//--------------------------------------------------------------------------------
@@ -0,0 +1,145 @@
+/*
+ * This file is part of MiniScatter.
+ *
+ *  MiniScatter is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  MiniScatter is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with MiniScatter.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "HistogramSampler.hh"
+
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wshadow"
+#include "TFile.h"
+#include "TH2.h"
+#pragma GCC diagnostic pop
+
+#include <algorithm>
+
+// -----------------------------------------------------------------------------------------
+
+HistogramSampler::HistogramSampler(G4String definition) {
+    str_size pos1 = definition.index(":");
+    str_size pos2 = (pos1 == std::string::npos) ? std::string::npos : definition.index(":",pos1+1);
+    if (pos1 == std::string::npos or pos2 == std::string::npos) {
+        G4cerr << "Error in HistogramSampler: Expected format 'fileName:histName:coords', got '"
+               << definition << "'" << G4endl;
+        exit(1);
+    }
+    fileName = definition(0,pos1);
+    histName = definition(pos1+1,pos2-pos1-1);
+    coords   = definition(pos2+1,definition.length()-pos2-1);
+
+    if      (coords == "xy")  { coordA = 0; coordB = 2; }
+    else if (coords == "xxp") { coordA = 0; coordB = 1; }
+    else if (coords == "yyp") { coordA = 2; coordB = 3; }
+    else {
+        G4cerr << "Error in HistogramSampler: Expected coords 'xy', 'xxp', or 'yyp', got '"
+               << coords << "'" << G4endl;
+        exit(1);
+    }
+
+    TFile* histFile = TFile::Open(fileName.data(),"READ");
+    if (histFile == NULL or histFile->IsZombie()) {
+        G4cerr << "Error in HistogramSampler: Could not open file '" << fileName << "'" << G4endl;
+        exit(1);
+    }
+    TH2* hist = dynamic_cast<TH2*>(histFile->Get(histName.data()));
+    if (hist == NULL) {
+        G4cerr << "Error in HistogramSampler: No 2D histogram '" << histName
+               << "' in file '" << fileName << "'" << G4endl;
+        exit(1);
+    }
+
+    // Bin geometry; the under- and overflow bins are not used
+    nBinsA = hist->GetXaxis()->GetNbins();
+    const G4int nBinsB = hist->GetYaxis()->GetNbins();
+    for (G4int i = 1; i <= nBinsA; i++) {
+        lowEdgeA.push_back(hist->GetXaxis()->GetBinLowEdge(i));
+        widthA.push_back(hist->GetXaxis()->GetBinWidth(i));
+    }
+    for (G4int i = 1; i <= nBinsB; i++) {
+        lowEdgeB.push_back(hist->GetYaxis()->GetBinLowEdge(i));
+        widthB.push_back(hist->GetYaxis()->GetBinWidth(i));
+    }
+
+    // Vose's alias method: Scale the weights to mean 1,
+    // then pair each bin below 1 with a bin above 1 which fills up the rest of its column.
+    const G4int nBins = nBinsA*nBinsB;
+    std::vector<G4double> scaled(nBins);
+    sumWeights = 0.0;
+    for (G4int iB = 0; iB < nBinsB; iB++) {
+        for (G4int iA = 0; iA < nBinsA; iA++) {
+            const G4double w = hist->GetBinContent(iA+1,iB+1);
+            if (w < 0.0) {
+                G4cerr << "Error in HistogramSampler: Negative content in bin (" << iA+1 << "," << iB+1 << ")"
+                       << " of histogram '" << histName << "'" << G4endl;
+                exit(1);
+            }
+            scaled[iB*nBinsA+iA] = w;
+            sumWeights += w;
+        }
+    }
+    histFile->Close();
+    delete histFile;
+
+    if (not (sumWeights > 0.0)) {
+        G4cerr << "Error in HistogramSampler: Histogram '" << histName << "' is empty" << G4endl;
+        exit(1);
+    }
+
+    aliasProb.resize(nBins);
+    aliasIdx.resize(nBins);
+    std::vector<G4int> small;
+    std::vector<G4int> large;
+    for (G4int i = 0; i < nBins; i++) {
+        scaled[i] *= nBins/sumWeights;
+        aliasIdx[i] = i;
+        if (scaled[i] < 1.0) small.push_back(i);
+        else                 large.push_back(i);
+    }
+    while (not small.empty() and not large.empty()) {
+        const G4int s = small.back(); small.pop_back();
+        const G4int l = large.back(); large.pop_back();
+        aliasProb[s] = scaled[s];
+        aliasIdx[s]  = l;
+        scaled[l] = (scaled[l] + scaled[s]) - 1.0;
+        if (scaled[l] < 1.0) small.push_back(l);
+        else                 large.push_back(l);
+    }
+    // What is left is 1 up to rounding errors
+    for (auto i : large) aliasProb[i] = 1.0;
+    for (auto i : small) aliasProb[i] = 1.0;
+}
+
+void HistogramSampler::Sample(G4double u1, G4double u2, G4double u3, G4double u4, G4double& a, G4double& b) const {
+    const G4int nBins = aliasProb.size();
+    G4int bin = std::min(G4int(u1*nBins), nBins-1);
+    if (u2 >= aliasProb[bin]) {
+        bin = aliasIdx[bin];
+    }
+    const G4int iA = bin % nBinsA;
+    const G4int iB = bin / nBinsA;
+    a = lowEdgeA[iA] + u3*widthA[iA];
+    b = lowEdgeB[iB] + u4*widthB[iB];
+}
+
+void HistogramSampler::Print() {
+    G4cout << "Initialized HistogramSampler, parameters:" << G4endl;
+    G4cout << "\t fileName                = " << fileName << G4endl;
+    G4cout << "\t histName                = " << histName << G4endl;
+    G4cout << "\t coords                  = " << coords << G4endl;
+    G4cout << "\t nBins                   = " << nBinsA << " x " << lowEdgeB.size() << G4endl;
+    G4cout << "\t sumWeights              = " << sumWeights << G4endl;
+}
+
+// -----------------------------------------------------------------------------------------
@@ -0,0 +1,230 @@
+/*
+ * This file is part of MiniScatter.
+ *
+ *  MiniScatter is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  MiniScatter is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with MiniScatter.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "ImportanceWorldConstruction.hh"
+
+#include "G4PVPlacement.hh"
+#include "G4Box.hh"
+#include "G4Tubs.hh"
+#include "G4LogicalVolume.hh"
+#include "G4SystemOfUnits.hh"
+
+#include "G4IStore.hh"
+#include "G4GeometrySampler.hh"
+#include "G4TransportationManager.hh"
+
+#include <cmath>
+#include <string>
+
+ImportanceWorldConstruction::ImportanceWorldConstruction(G4String worldName,
+                                                         DetectorConstruction* mainGeometryConstruction_in,
+                                                         G4String importanceDefinition) :
+    G4VUserParallelWorld(worldName), mainGeometryConstruction(mainGeometryConstruction_in) {
+
+    //Split by ':'
+    std::vector<G4String> argList;
+    str_size startPos = 0;
+    str_size endPos = 0;
+    do {
+        endPos   = importanceDefinition.index(":",startPos);
+        argList.push_back(importanceDefinition(startPos,endPos-startPos));
+        startPos = endPos+1;
+    } while (endPos != std::string::npos);
+
+    if (argList.size() != 3 and argList.size() != 4) {
+        G4cerr << "Error when parsing importance input string '" << importanceDefinition << "'" << G4endl;
+        G4cerr << "Expected 'R:r1,r2,...:ratio(:particles)' or 'Z:n:ratio(:particles)'." << G4endl;
+        exit(1);
+    }
+
+    try {
+        if (argList[0] == "R") {
+            radialCells = true;
+            str_size bStart = 0;
+            str_size bEnd   = 0;
+            do {
+                bEnd = argList[1].index(",",bStart);
+                radialBounds.push_back(std::stod(std::string(argList[1](bStart,bEnd-bStart)))*mm);
+                bStart = bEnd+1;
+            } while (bEnd != std::string::npos);
+        }
+        else if (argList[0] == "Z") {
+            radialCells = false;
+            numSlabs = std::stoi(std::string(argList[1]));
+        }
+        else {
+            G4cerr << "Error in ImportanceWorldConstruction: Expected cell type 'R' or 'Z', got '"
+                   << argList[0] << "'" << G4endl;
+            exit(1);
+        }
+        ratio = std::stod(std::string(argList[2]));
+    }
+    catch (const std::invalid_argument& ia) {
+        G4cerr << "Invalid argument when reading importance input string '" << importanceDefinition << "'" << G4endl
+               << "Expected 'R:r1,r2,...:ratio' or 'Z:n:ratio', with n an integer and the rest "
+               << "floating point numbers (exponential notation is accepted)!" << G4endl;
+        exit(1);
+    }
+
+    if (argList.size() == 4) {
+        str_size pStart = 0;
+        str_size pEnd   = 0;
+        do {
+            pEnd = argList[3].index(",",pStart);
+            particles.push_back(argList[3](pStart,pEnd-pStart));
+            pStart = pEnd+1;
+        } while (pEnd != std::string::npos);
+    }
+    else {
+        particles = {"e-", "e+", "gamma", "proton"};
+    }
+
+    // Sanity checks
+    if (ratio <= 0.0) {
+        G4cerr << "Error in ImportanceWorldConstruction: ratio must be > 0" << G4endl;
+        exit(1);
+    }
+    if (radialCells) {
+        G4double maxR = std::min(mainGeometryConstruction->getWorldSizeX(),
+                                 mainGeometryConstruction->getWorldSizeY())/2.0;
+        for (size_t i = 0; i < radialBounds.size(); i++) {
+            if (radialBounds[i] <= 0.0 or (i > 0 and radialBounds[i] <= radialBounds[i-1])) {
+                G4cerr << "Error in ImportanceWorldConstruction: The radii must be > 0 and increasing" << G4endl;
+                exit(1);
+            }
+            if (radialBounds[i] >= maxR) {
+                G4cerr << "Error in ImportanceWorldConstruction: The radii must be < " << maxR/mm
+                       << " [mm] to fit inside the world" << G4endl;
+                exit(1);
+            }
+        }
+    }
+    else {
+        if (numSlabs < 1) {
+            G4cerr << "Error in ImportanceWorldConstruction: Need at least 1 slab" << G4endl;
+            exit(1);
+        }
+        if (not mainGeometryConstruction->GetHasTarget() or mainGeometryConstruction->getTargetRotated()) {
+            G4cerr << "Error in ImportanceWorldConstruction: "
+                   << "Importance slabs need an unrotated target" << G4endl;
+            exit(1);
+        }
+    }
+
+    G4cout << "Initialized importance biasing, parameters:" << G4endl;
+    if (radialCells) {
+        G4cout << "\t cells                   = R, bounds =";
+        for (auto r : radialBounds) {
+            G4cout << " " << r/mm;
+        }
+        G4cout << " [mm]" << G4endl;
+    }
+    else {
+        G4cout << "\t cells                   = Z, numSlabs = " << numSlabs << G4endl;
+    }
+    G4cout << "\t ratio                   = " << ratio << G4endl;
+    G4cout << "\t particles               =";
+    for (auto p : particles) {
+        G4cout << " " << p;
+    }
+    G4cout << G4endl;
+}
+
+void ImportanceWorldConstruction::Construct() {
+    ghostWorld = GetWorld();
+    G4LogicalVolume* ghostWorldLogical = ghostWorld->GetLogicalVolume();
+
+    const G4double worldHalfX = mainGeometryConstruction->getWorldSizeX()/2.0;
+    const G4double worldHalfY = mainGeometryConstruction->getWorldSizeY()/2.0;
+    const G4double worldHalfZ = mainGeometryConstruction->getWorldSizeZ()/2.0;
+
+    if (radialCells) {
+        // Nested cylinders, the outermost placed in the world;
+        // cell i covers radialBounds[i-1] < r < radialBounds[i].
+        const size_t numCells = radialBounds.size();
+        ghostWorldImportance = pow(ratio, numCells);
+
+        G4LogicalVolume* motherLV = ghostWorldLogical;
+        for (size_t i = numCells; i-- > 0; ) {
+            G4String cellName = "importanceCell_" + std::to_string(i);
+            G4Tubs* cellS = new G4Tubs(cellName+"S", 0.0, radialBounds[i], worldHalfZ, 0.0, 360.0*deg);
+            G4LogicalVolume* cellLV = new G4LogicalVolume(cellS, NULL, cellName+"LV");
+            cellPVs.push_back(new G4PVPlacement(NULL, G4ThreeVector(), cellLV, cellName+"PV",
+                                                motherLV, false, 0, true));
+            cellImportances.push_back(pow(ratio, i));
+            motherLV = cellLV;
+        }
+    }
+    else {
+        // Slabs through the target, plus one covering everything downstream of it.
+        // Upstream of the target is the ghost world, with the same importance as the first slab.
+        const G4double targetThickness = mainGeometryConstruction->getTargetThickness();
+        const G4double slabThickness   = targetThickness / numSlabs;
+        ghostWorldImportance = 1.0;
+
+        for (G4int i = 0; i < numSlabs; i++) {
+            G4String cellName = "importanceCell_" + std::to_string(i);
+            G4Box* cellS = new G4Box(cellName+"S", worldHalfX, worldHalfY, slabThickness/2.0);
+            G4LogicalVolume* cellLV = new G4LogicalVolume(cellS, NULL, cellName+"LV");
+            G4double zPos = -targetThickness/2.0 + (i+0.5)*slabThickness;
+            cellPVs.push_back(new G4PVPlacement(NULL, G4ThreeVector(0.0,0.0,zPos), cellLV, cellName+"PV",
+                                                ghostWorldLogical, false, 0, true));
+            cellImportances.push_back(pow(ratio, i));
+        }
+
+        G4String cellName = "importanceCell_" + std::to_string(numSlabs);
+        G4double downstreamHalfZ = (worldHalfZ - targetThickness/2.0)/2.0;
+        G4Box* cellS = new G4Box(cellName+"S", worldHalfX, worldHalfY, downstreamHalfZ);
+        G4LogicalVolume* cellLV = new G4LogicalVolume(cellS, NULL, cellName+"LV");
+        cellPVs.push_back(new G4PVPlacement(NULL, G4ThreeVector(0.0,0.0,targetThickness/2.0+downstreamHalfZ),
+                                            cellLV, cellName+"PV", ghostWorldLogical, false, 0, true));
+        cellImportances.push_back(pow(ratio, numSlabs-1));
+    }
+}
+
+void ImportanceWorldConstruction::CreateImportanceStore() {
+    G4IStore* istore = G4IStore::GetInstance(GetName());
+
+    istore->AddImportanceGeometryCell(ghostWorldImportance, *ghostWorld);
+    for (size_t i = 0; i < cellPVs.size(); i++) {
+        istore->AddImportanceGeometryCell(cellImportances[i], *(cellPVs[i]));
+    }
+
+    G4cout << "Importance store for '" << GetName() << "':" << G4endl;
+    G4cout << "\t " << ghostWorld->GetName() << " = " << ghostWorldImportance << G4endl;
+    for (size_t i = 0; i < cellPVs.size(); i++) {
+        G4cout << "\t " << cellPVs[i]->GetName() << " = " << cellImportances[i] << G4endl;
+    }
+}
+
+//--------------------------------------------------------------------------------
+
+ImportancePhysics::ImportancePhysics(G4String worldName_in, const std::vector<G4String> &particles_in) :
+    G4VPhysicsConstructor("ImportancePhysics"), worldName(worldName_in), particles(particles_in) { }
+
+void ImportancePhysics::ConstructProcess() {
+    // The parallel worlds are constructed before the physics, so the ghost world exists.
+    G4VPhysicalVolume* ghostWorld =
+        G4TransportationManager::GetTransportationManager()->GetParallelWorld(worldName);
+
+    for (auto particleName : particles) {
+        G4GeometrySampler* sampler = new G4GeometrySampler(ghostWorld, particleName);
+        sampler->SetParallel(true);
+        sampler->PrepareImportanceSampling(G4IStore::GetInstance(worldName), 0);
+        sampler->Configure();
+    }
+}
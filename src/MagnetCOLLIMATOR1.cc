@@ -38,9 +38,15 @@ MagnetCOLLIMATOR1::MagnetCOLLIMATOR1(G4double zPos_in, G4bool doRelPos_in, G4dou
         else if (it.first == "height") {
             height = ParseDouble(it.second, "absorber height") * mm;
         }
+        else if (it.first == "absorb") {
+            absorb = ParseBool(it.second, "absorb");
+        }
         else if (it.first == "material") {
             absorberMaterialName = it.second;
         }
+        else if (it.first == "booleanHole") {
+            booleanHole = ParseBool(it.second, "booleanHole");
+        }
         else if (it.first == "xOffset" || it.first == "yOffset" || it.first == "xRot" || it.first == "yRot") {
             ParseOffsetRot(it.first, it.second);
         }
@@ -62,6 +68,8 @@ MagnetCOLLIMATOR1::MagnetCOLLIMATOR1(G4double zPos_in, G4bool doRelPos_in, G4dou
     G4cout << "\t radius                  = " << radius/mm            << " [mm]"  << G4endl;
     G4cout << "\t width                   = " << width/mm             << " [mm]"  << G4endl;
     G4cout << "\t height                  = " << height/mm            << " [mm]"  << G4endl;
+    G4cout << "\t absorb                  = " << (absorb?"true":"false") << G4endl;
+    G4cout << "\t booleanHole             = " << (booleanHole?"true":"false") << G4endl;
 
 }
 
@@ -88,13 +96,15 @@ void MagnetCOLLIMATOR1::Construct() {
     }
 
     // Build the absorber
-    G4VSolid* absorberBox      = new G4Box(magnetName+"_absorberBoxS",
+    G4VSolid* absorberSolid    = new G4Box(magnetName+"_absorberBoxS",
                                            width/2.0, height/2.0, length/2.0);
-    G4VSolid* absorberCylinder = new G4Tubs(magnetName+"_absorberCylinderS",
-                                            0.0, radius, length,
-                                            0.0, 360.0*deg);
-    G4VSolid* absorberSolid    = new G4SubtractionSolid(magnetName+"_absorberS",
-                                                       absorberBox, absorberCylinder);
+    if (booleanHole) {
+        G4VSolid* absorberCylinder = new G4Tubs(magnetName+"_absorberCylinderS",
+                                                0.0, radius, length,
+                                                0.0, 360.0*deg);
+        absorberSolid              = new G4SubtractionSolid(magnetName+"_absorberS",
+                                                            absorberSolid, absorberCylinder);
+    }
 
     absorberMaterial = G4Material::GetMaterial(absorberMaterialName);
     if (not absorberMaterial){
@@ -119,6 +129,13 @@ void MagnetCOLLIMATOR1::Construct() {
                                                         false,
                                                         0,
                                                         true);
+    if (not booleanHole) {
+        MakeHoleLV(absorberLV, radius, "channel");
+    }
+
+    if (absorb) {
+        MakeAbsorberRegion(absorberLV);
+    }
 
     ConstructDetectorLV();
     BuildMainPV_transform();
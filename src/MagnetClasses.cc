@@ -25,6 +25,7 @@
 #include "G4SubtractionSolid.hh"
 
 #include "G4PVPlacement.hh"
+#include "G4UserLimits.hh"
 
 #include "MyTargetSD.hh"
 #include "G4SDManager.hh"
@@ -34,8 +35,22 @@
 #include "G4ChordFinder.hh"
 #include "G4ClassicalRK4.hh"
 #include "G4Mag_UsualEqRhs.hh"
+#include "G4DormandPrince745.hh"
+#include "G4BogackiShampine23.hh"
+#include "G4BogackiShampine45.hh"
+#include "G4CashKarpRKF45.hh"
+#include "G4NystromRK4.hh"
+#include "PlasmaLensStepper.hh"
+#include "AbsorberFastSimModel.hh"
+
+#include "G4Region.hh"
+#include "G4ProductionCutsTable.hh"
 
 #include "G4PhysicalConstants.hh"
+#include "CLHEP/Random/MixMaxRng.h"
+
+#include <chrono>
+#include <vector>
 
 MagnetBase* MagnetBase::MagnetFactory(G4String inputString, DetectorConstruction* detCon, G4String magnetName) {
 
@@ -133,6 +148,10 @@ MagnetBase* MagnetBase::MagnetFactory(G4String inputString, DetectorConstruction
         theMagnet = new MagnetCOLLIMATOR1 (magnetPos, doRelPos, magnetLength, magnetGradient,
                                            keyValPairs, detCon, magnetName);
     }
+    else if(magnetType == "FIELDMAP1") {
+        theMagnet = new MagnetFIELDMAP1   (magnetPos, doRelPos, magnetLength, magnetGradient,
+                                           keyValPairs, detCon, magnetName);
+    }
     else if(magnetType == "TARGET") {
         theMagnet = new MagnetTARGET      (magnetPos, doRelPos, magnetLength, magnetGradient,
                                            keyValPairs, detCon, magnetName);
@@ -177,6 +196,43 @@ G4LogicalVolume* MagnetBase::MakeNewMainLV(G4String name_postfix){
     return newMainLV;
 }
 
+void MagnetBase::MakeAbsorberRegion(G4LogicalVolume* absorberLV) {
+    absorberRegion = new G4Region(magnetName + "_absorber_region");
+    absorberRegion->AddRootLogicalVolume(absorberLV);
+    // Shared with the world, so that it follows SetDefaultCutValue()
+    absorberRegion->SetProductionCuts(G4ProductionCutsTable::GetProductionCutsTable()->GetDefaultProductionCuts());
+}
+
+void MagnetBase::CreateAbsorberModel() {
+    AbsorberFastSimModel* absorberModel =
+        new AbsorberFastSimModel(magnetName + "_absorber", absorberRegion, magnetName + "_absorbed");
+    G4cout << "Initialized AbsorberFastSimModel '" << absorberModel->GetName() << "'; "
+           << "tracks entering the absorber are counted as '" << magnetName + "_absorbed" << "'" << G4endl;
+}
+
+G4LogicalVolume* MagnetBase::MakeHoleLV(G4LogicalVolume* motherLV, G4double radius, G4String holeName) {
+    G4Material* vacuumMaterial = G4Material::GetMaterial("G4_Galactic");
+    if (not vacuumMaterial) {
+        G4cerr << "Internal error -- material G4_Galactic not found in MagnetBase::MakeHoleLV()!" << G4endl;
+        exit(1);
+    }
+
+    G4VSolid* holeSolid     = new G4Tubs(magnetName+"_"+holeName+"S",
+                                         0.0, radius, length/2.0,
+                                         0.0, 360.0*deg);
+    G4LogicalVolume* holeLV = new G4LogicalVolume(holeSolid, vacuumMaterial, magnetName+"_"+holeName+"LV");
+    //G4VPhysicalVolume* holePV =
+                            new G4PVPlacement(NULL,
+                                              G4ThreeVector(0.0,0.0,0.0),
+                                              holeLV,
+                                              magnetName + "_" + holeName + "PV",
+                                              motherLV,
+                                              false,
+                                              0,
+                                              true);
+    return holeLV;
+}
+
 G4LogicalVolume* MagnetBase::GetMainLV() const {
     //Returns the mainLV.
 
@@ -208,15 +264,30 @@ void MagnetBase::ConstructDetectorLV() {
 
     this->detectorLV = MakeNewMainLV("detector");
 }
-void MagnetBase::AddSD(){
-    // Add the TargetSD to the virtual logical volume of the magnet.
+void MagnetBase::AddSD(G4bool massWorld){
+    // Add the TargetSD to the virtual logical volume of the magnet,
+    // or to all the logical volumes of the magnet in the mass world.
     // This records the outgoing position and energy deposit in the magnet.
 
     // Get pointer to detector manager
     G4SDManager* SDman = G4SDManager::GetSDMpointer();
-    magnetSD = new MyTargetSD(magnetName);
+    MyTargetSD* targetSD = new MyTargetSD(magnetName);
+    targetSD->SetExitFace(mainPV_transform.inverse(), length/2.0);
+    targetSD->SetAccumulateEdep(true);
+    magnetSD = targetSD;
     SDman->AddNewDetector(magnetSD);
-    this->detectorLV->SetSensitiveDetector(magnetSD);
+    if (massWorld) {
+        SetSensitiveDetectorRecursive(this->mainLV);
+    }
+    else {
+        this->detectorLV->SetSensitiveDetector(magnetSD);
+    }
+}
+void MagnetBase::SetSensitiveDetectorRecursive(G4LogicalVolume* LV) {
+    LV->SetSensitiveDetector(magnetSD);
+    for (G4int i = 0; i < LV->GetNoDaughters(); i++) {
+        SetSensitiveDetectorRecursive(LV->GetDaughter(i)->GetLogicalVolume());
+    }
 }
 G4LogicalVolume* MagnetBase::GetDetectorLV() const {
     //Returns the detectorLV.
@@ -278,6 +349,182 @@ void MagnetBase::ParseOffsetRot(G4String k, G4String v) {
     }
 }
 
+G4bool MagnetBase::IsFieldParameter(G4String k) {
+    return k == "stepper"      or k == "minStep"           or k == "deltaChord" or
+           k == "deltaOneStep" or k == "deltaIntersection" or k == "epsMin"     or k == "epsMax" or
+           k == "fieldVolume"  or k == "fieldMargin"       or k == "fieldMaxStep";
+}
+
+void MagnetBase::ParseFieldParameter(G4String k, G4String v) {
+    if (k == "stepper") {
+        if (not (v == "ClassicalRK4"      or v == "DormandPrince745"  or
+                 v == "BogackiShampine23" or v == "BogackiShampine45" or
+                 v == "CashKarpRKF45"     or v == "NystromRK4"        or
+                 v == "PlasmaLens") ) {
+            G4cerr << "MagnetBase::ParseFieldParameter(): Unknown stepper '" << v << "'" << G4endl;
+            exit(1);
+        }
+        stepperName = v;
+    }
+    else if (k == "minStep") {
+        minStep = ParseDouble(v, "minStep") * mm;
+    }
+    else if (k == "deltaChord") {
+        deltaChord = ParseDouble(v, "deltaChord") * mm;
+    }
+    else if (k == "deltaOneStep") {
+        deltaOneStep = ParseDouble(v, "deltaOneStep") * mm;
+    }
+    else if (k == "deltaIntersection") {
+        deltaIntersection = ParseDouble(v, "deltaIntersection") * mm;
+    }
+    else if (k == "epsMin") {
+        epsMin = ParseDouble(v, "epsMin");
+    }
+    else if (k == "epsMax") {
+        epsMax = ParseDouble(v, "epsMax");
+    }
+    else if (k == "fieldVolume") {
+        // Checked by the object
+        fieldVolume = v;
+    }
+    else if (k == "fieldMargin") {
+        fieldMargin = ParseDouble(v, "fieldMargin") * mm;
+        if (fieldMargin < 0.0) {
+            G4cerr << "MagnetBase::ParseFieldParameter(): fieldMargin must be >= 0" << G4endl;
+            exit(1);
+        }
+    }
+    else if (k == "fieldMaxStep") {
+        fieldMaxStep = ParseDouble(v, "fieldMaxStep") * mm;
+    }
+    else {
+        G4cerr << "MagnetBase::ParseFieldParameter() cannot parse key '" << k << "' "
+               << "(value = '" << v << "')" << G4endl;
+        exit(1);
+    }
+}
+
+G4FieldManager* MagnetBase::MakeFieldManager(G4double defaultMinStep) {
+    if (field == NULL) {
+        G4cerr << "Internal error in MagnetBase::MakeFieldManager(): No field for '" << magnetName << "'" << G4endl;
+        exit(1);
+    }
+    if (minStep < 0.0) {
+        minStep = defaultMinStep;
+    }
+
+    G4FieldManager* fieldMgr = new G4FieldManager(field);
+    G4Mag_UsualEqRhs* fieldEquation = new G4Mag_UsualEqRhs(field);
+    G4MagIntegratorStepper* fieldStepper = NULL;
+    if      (stepperName == "ClassicalRK4")      fieldStepper = new G4ClassicalRK4(fieldEquation);
+    else if (stepperName == "DormandPrince745")  fieldStepper = new G4DormandPrince745(fieldEquation);
+    else if (stepperName == "BogackiShampine23") fieldStepper = new G4BogackiShampine23(fieldEquation);
+    else if (stepperName == "BogackiShampine45") fieldStepper = new G4BogackiShampine45(fieldEquation);
+    else if (stepperName == "CashKarpRKF45")     fieldStepper = new G4CashKarpRKF45(fieldEquation);
+    else if (stepperName == "NystromRK4")        fieldStepper = new G4NystromRK4(fieldEquation);
+    else if (stepperName == "PlasmaLens") {
+        const FieldPLASMA1* plasmaField = dynamic_cast<const FieldPLASMA1*>(field);
+        if (plasmaField == NULL) {
+            G4cerr << "Error in MagnetBase::MakeFieldManager(): The PlasmaLens stepper "
+                   << "can only be used with PLASMA1, not with '" << magnetType << "'." << G4endl;
+            exit(1);
+        }
+        fieldStepper = new PlasmaLensStepper(fieldEquation, plasmaField);
+    }
+
+    G4ChordFinder* fieldChordFinder = new G4ChordFinder(field, minStep, fieldStepper);
+    if (deltaChord > 0.0) {
+        fieldChordFinder->SetDeltaChord(deltaChord);
+    }
+    fieldMgr->SetChordFinder(fieldChordFinder);
+
+    if (deltaOneStep > 0.0) {
+        fieldMgr->SetDeltaOneStep(deltaOneStep);
+    }
+    if (deltaIntersection > 0.0) {
+        fieldMgr->SetDeltaIntersection(deltaIntersection);
+    }
+    if (epsMin > 0.0) {
+        fieldMgr->SetMinimumEpsilonStep(epsMin);
+    }
+    if (epsMax > 0.0) {
+        fieldMgr->SetMaximumEpsilonStep(epsMax);
+    }
+
+    PrintFieldParameters();
+
+    return fieldMgr;
+}
+
+void MagnetBase::AttachFieldManager(G4LogicalVolume* fieldLV, G4FieldManager* fieldMgr) {
+    fieldLV->SetFieldManager(fieldMgr,true);
+    if (fieldMaxStep > 0.0) {
+        fieldLV->SetUserLimits(new G4UserLimits(fieldMaxStep));
+    }
+}
+
+G4LogicalVolume* MagnetBase::MakeFieldBoxLV(G4double width, G4double height, G4FieldManager* fieldMgr) {
+    const G4double fieldBox_w = width  + 2*fieldMargin;
+    const G4double fieldBox_h = height + 2*fieldMargin;
+    if (fieldBox_w > mainLV_w or fieldBox_h > mainLV_h) {
+        G4cerr << "Error in MagnetBase::MakeFieldBoxLV():" << G4endl
+               << " The field volume for '" << magnetName << "' is wider than its allowed envelope"
+               << " including offsets and rotations." << G4endl;
+        exit(1);
+    }
+
+    G4Material* vacuumMaterial = G4Material::GetMaterial("G4_Galactic");
+    if (not vacuumMaterial) {
+        G4cerr << "Internal error -- material G4_Galactic not found in MagnetBase::MakeFieldBoxLV()!" << G4endl;
+        exit(1);
+    }
+
+    G4VSolid* fieldBox          = new G4Box(magnetName+"_fieldBoxS",
+                                            fieldBox_w/2.0, fieldBox_h/2.0, length/2.0);
+    G4LogicalVolume* fieldBoxLV = new G4LogicalVolume(fieldBox, vacuumMaterial, magnetName+"_fieldBoxLV");
+    //G4VPhysicalVolume* fieldBoxPV =
+                                  new G4PVPlacement(NULL,
+                                                    G4ThreeVector(0.0,0.0,0.0),
+                                                    fieldBoxLV,
+                                                    magnetName + "_fieldBoxPV",
+                                                    mainLV,
+                                                    false,
+                                                    0,
+                                                    true);
+    AttachFieldManager(fieldBoxLV, fieldMgr);
+
+    return fieldBoxLV;
+}
+
+void MagnetBase::PrintFieldParameters() {
+    G4cout << "Field integration for " << magnetName << ":" << G4endl;
+    G4cout << "\t fieldVolume             = " << fieldVolume        <<             G4endl;
+    if (fieldVolume != "main") {
+        G4cout << "\t fieldMargin             = " << fieldMargin/mm     << " [mm]"  << G4endl;
+    }
+    G4cout << "\t fieldMaxStep            = ";
+    if (fieldMaxStep > 0.0)      G4cout << fieldMaxStep/mm << " [mm]" << G4endl;
+    else                         G4cout << "(none)" << G4endl;
+    G4cout << "\t stepper                 = " << stepperName        <<             G4endl;
+    G4cout << "\t minStep                 = " << minStep/mm         << " [mm]"  << G4endl;
+    G4cout << "\t deltaChord              = ";
+    if (deltaChord > 0.0)        G4cout << deltaChord/mm << " [mm]" << G4endl;
+    else                         G4cout << "(default)" << G4endl;
+    G4cout << "\t deltaOneStep            = ";
+    if (deltaOneStep > 0.0)      G4cout << deltaOneStep/mm << " [mm]" << G4endl;
+    else                         G4cout << "(default)" << G4endl;
+    G4cout << "\t deltaIntersection       = ";
+    if (deltaIntersection > 0.0) G4cout << deltaIntersection/mm << " [mm]" << G4endl;
+    else                         G4cout << "(default)" << G4endl;
+    G4cout << "\t epsMin                  = ";
+    if (epsMin > 0.0)            G4cout << epsMin << G4endl;
+    else                         G4cout << "(default)" << G4endl;
+    G4cout << "\t epsMax                  = ";
+    if (epsMax > 0.0)            G4cout << epsMax << G4endl;
+    else                         G4cout << "(default)" << G4endl;
+}
+
 void MagnetBase::PrintCommonParameters() {
     G4cout << "Initialized a " << magnetType << ", parameters:" <<             G4endl;
     G4cout << "\t magnetName              = " << magnetName         <<             G4endl;
@@ -290,6 +537,77 @@ void MagnetBase::PrintCommonParameters() {
     G4cout << "\t yRot                    = " << yRot/deg           << " [deg]" << G4endl;
 }
 
+void MagnetBase::BenchmarkField(G4int nCalls) {
+    if (field == NULL) {
+        return;
+    }
+
+    // Generate the points up front, so that only the field evaluation is timed.
+    // Use a local engine, so that the benchmark does not change the random numbers of the run.
+    CLHEP::MixMaxRng engine(1);
+    const G4int nPoints = 1000;
+    std::vector<G4double> points(4*nPoints);
+    for (G4int i = 0; i < nPoints; i++) {
+        points[4*i+0] = xOffset + (engine.flat()-0.5)*mainLV_w;
+        points[4*i+1] = yOffset + (engine.flat()-0.5)*mainLV_h;
+        points[4*i+2] = getZ0() + (engine.flat()-0.5)*length;
+        points[4*i+3] = 0.0;
+    }
+
+    G4double B[6];
+    G4double Bsum = 0.0; // Keep the compiler from optimizing the calls away
+    auto tStart = std::chrono::steady_clock::now();
+    for (G4int i = 0; i < nCalls; i++) {
+        field->GetFieldValue(&points[4*(i%nPoints)], B);
+        Bsum += B[0]+B[1]+B[2];
+    }
+    auto tEnd = std::chrono::steady_clock::now();
+    G4double ns = std::chrono::duration<G4double,std::nano>(tEnd-tStart).count();
+
+    G4cout << "Field benchmark for magnet '" << magnetName << "' (" << magnetType << "): "
+           << nCalls << " calls, " << ns/nCalls << " [ns/call]"
+           << " (checksum = " << Bsum/tesla << ")" << G4endl;
+}
+
+void MagnetBase::BenchmarkNavigation(G4int nCalls) {
+    G4Navigator* trackingNavigator =
+        G4TransportationManager::GetTransportationManager()->GetNavigatorForTracking();
+    G4Navigator navigator;
+    navigator.SetWorldVolume(trackingNavigator->GetWorldVolume());
+
+    // Generate the points and directions up front, so that only the navigation is timed.
+    // Use a local engine, so that the benchmark does not change the random numbers of the run.
+    CLHEP::MixMaxRng engine(1);
+    const G4int nPoints = 1000;
+    std::vector<G4ThreeVector> points(nPoints);
+    std::vector<G4ThreeVector> directions(nPoints);
+    for (G4int i = 0; i < nPoints; i++) {
+        points[i].set(xOffset + (engine.flat()-0.5)*mainLV_w,
+                      yOffset + (engine.flat()-0.5)*mainLV_h,
+                      getZ0() + (engine.flat()-0.5)*length);
+        const G4double cosTheta = 2.0*engine.flat()-1.0;
+        const G4double sinTheta = sqrt(1.0-cosTheta*cosTheta);
+        const G4double phi      = twopi*engine.flat();
+        directions[i].set(sinTheta*cos(phi), sinTheta*sin(phi), cosTheta);
+    }
+
+    G4double stepSum = 0.0; // Keep the compiler from optimizing the calls away
+    G4double safety;
+    auto tStart = std::chrono::steady_clock::now();
+    for (G4int i = 0; i < nCalls; i++) {
+        const G4ThreeVector& p = points[i%nPoints];
+        const G4ThreeVector& d = directions[i%nPoints];
+        navigator.LocateGlobalPointAndSetup(p, &d, false, false);
+        stepSum += navigator.ComputeStep(p, d, kInfinity, safety);
+    }
+    auto tEnd = std::chrono::steady_clock::now();
+    G4double ns = std::chrono::duration<G4double,std::nano>(tEnd-tStart).count();
+
+    G4cout << "Navigation benchmark for magnet '" << magnetName << "' (" << magnetType << "): "
+           << nCalls << " calls, " << ns/nCalls << " [ns/call]"
+           << " (checksum = " << stepSum/mm << ")" << G4endl;
+}
+
 /** FIELD PATTERN BASE CLASS **/
 
 G4Navigator* FieldBase::fNavigator = NULL;
@@ -325,4 +643,9 @@ void FieldBase::SetupTransform() {
         exit(1);
     }
     fGlobalToLocal = touchable->GetHistory()->GetTopTransform();
+
+    // Avoid building the inverse and doing rotations in every GetFieldValue()
+    fLocalToGlobal     = fGlobalToLocal.Inverse();
+    fIsTranslationOnly = not fGlobalToLocal.IsRotated();
+    fTranslation       = fGlobalToLocal.NetTranslation();
 }
\ No newline at end of file
@@ -0,0 +1,278 @@
+/*
+ * This file is part of MiniScatter.
+ *
+ *  MiniScatter is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  MiniScatter is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with MiniScatter.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "MagnetClasses.hh"
+
+#include "G4FieldManager.hh"
+
+#include <fstream>
+#include <sstream>
+#include <cmath>
+#include <algorithm>
+
+MagnetFIELDMAP1::MagnetFIELDMAP1(G4double zPos_in, G4bool doRelPos_in, G4double length_in, G4double gradient_in,
+                                 std::map<G4String,G4String> &keyValPairs_in, DetectorConstruction* detCon_in,
+                                 G4String magnetName_in) :
+    MagnetBase(zPos_in, doRelPos_in, length_in, gradient_in, keyValPairs_in, detCon_in, magnetName_in, "FIELDMAP1") {
+
+    for (auto it : keyValPairs) {
+        if (it.first == "file") {
+            fileName = it.second;
+        }
+        else if (it.first == "xOffset" || it.first == "yOffset" || it.first == "xRot" || it.first == "yRot") {
+            ParseOffsetRot(it.first, it.second);
+        }
+        else if (IsFieldParameter(it.first)) {
+            ParseFieldParameter(it.first, it.second);
+        }
+        else {
+            G4cerr << "MagnetFIELDMAP1 did not understand key=value pair '"
+                   << it.first << "'='" << it.second << "'." << G4endl;
+            exit(1);
+        }
+    }
+
+    if (not (fieldVolume == "main" or fieldVolume == "map")) {
+        G4cerr << "Error in MagnetFIELDMAP1: fieldVolume must be 'main' or 'map', "
+               << "got '" << fieldVolume << "'." << G4endl;
+        exit(1);
+    }
+
+    if (fileName == "") {
+        G4cerr << "Error in MagnetFIELDMAP1: The key 'file' is required." << G4endl;
+        exit(1);
+    }
+
+    if (gradient == 0.0) {
+        G4cerr << "Warning in MagnetFIELDMAP1: The gradient (field map scale factor) is 0.0, "
+               << "so the field will be zero everywhere." << G4endl;
+    }
+
+    PrintCommonParameters();
+    G4cout << "\t fileName                = " << fileName           <<             G4endl;
+    G4cout << "\t (gradient is used as a scale factor for the field map)" << G4endl;
+}
+
+void MagnetFIELDMAP1::Construct() {
+    if (this->mainLV != NULL) {
+        G4cerr << "Error in MagnetFIELDMAP1::Construct(): The mainLV has already been constructed?" << G4endl;
+        exit(1);
+    }
+
+    this->mainLV = MakeNewMainLV("main");
+
+    FieldFIELDMAP1* mapField = new FieldFIELDMAP1(fileName, gradient,
+                                                  G4ThreeVector(xOffset, yOffset, getZ0()), mainLV);
+    field = mapField;
+    G4FieldManager* fieldMgr = MakeFieldManager(mapField->GetMinSpacing()/2.0);
+    if (fieldVolume == "map") {
+        // The field is zero outside the grid
+        G4double halfX, halfY;
+        mapField->GetTransverseHalfExtent(halfX, halfY);
+        MakeFieldBoxLV(2*halfX, 2*halfY, fieldMgr);
+    }
+    else {
+        AttachFieldManager(mainLV, fieldMgr);
+    }
+
+    ConstructDetectorLV();
+    BuildMainPV_transform();
+}
+
+/** FIELD PATTERN CLASS **/
+
+FieldFIELDMAP1::FieldFIELDMAP1(G4String fileName_in, G4double scale_in,
+                               G4ThreeVector centerPoint_in, G4LogicalVolume* fieldLV_in) :
+    FieldBase(centerPoint_in, fieldLV_in) {
+    ReadFile(fileName_in);
+    for (auto& B : fieldData) {
+        B *= scale_in;
+    }
+}
+
+void FieldFIELDMAP1::ReadFile(G4String fileName) {
+    // File format (lengths in [mm], fields in [T], '#' starts a comment line):
+    //  Header: '1D nr rmin rmax', '2D nr rmin rmax nz zmin zmax',
+    //          or '3D nx xmin xmax ny ymin ymax nz zmin zmax'
+    //  Then one line with 3 field components per grid point, the first coordinate varying fastest.
+    //  The components are 'Br Btheta Bz' for 1D and 2D maps and 'Bx By Bz' for 3D maps.
+    //  Coordinates are relative to the center of the object; 1D maps are independent of z.
+    std::ifstream inFile(fileName.data());
+    if (not inFile.is_open()) {
+        G4cerr << "Error in FieldFIELDMAP1::ReadFile(): Could not open file '" << fileName << "'" << G4endl;
+        exit(1);
+    }
+
+    std::string line;
+    G4bool hasHeader = false;
+    size_t numRead = 0;
+    size_t numNodes = 0;
+    while (std::getline(inFile, line)) {
+        if (line.empty() or line[0] == '#') continue;
+        std::istringstream lineStream(line);
+
+        if (not hasHeader) {
+            std::string dimString;
+            lineStream >> dimString;
+            if      (dimString == "1D") nDim = 1;
+            else if (dimString == "2D") nDim = 2;
+            else if (dimString == "3D") nDim = 3;
+            else {
+                G4cerr << "Error in FieldFIELDMAP1::ReadFile(): Expected '1D', '2D' or '3D' in header, "
+                       << "got '" << dimString << "'" << G4endl;
+                exit(1);
+            }
+            for (G4int d = 0; d < nDim; d++) {
+                lineStream >> nPts[d] >> uMin[d] >> uMax[d];
+                if (lineStream.fail() or nPts[d] < 2 or uMax[d] <= uMin[d]) {
+                    G4cerr << "Error in FieldFIELDMAP1::ReadFile(): Invalid grid in header '" << line << "'" << G4endl;
+                    exit(1);
+                }
+                uMin[d] *= mm;
+                uMax[d] *= mm;
+                invDU[d] = (nPts[d]-1)/(uMax[d]-uMin[d]);
+            }
+            if (nDim < 3 and uMin[0] < 0.0) {
+                G4cerr << "Error in FieldFIELDMAP1::ReadFile(): rmin must be >= 0" << G4endl;
+                exit(1);
+            }
+            stride[0] = 1;
+            stride[1] = nPts[0];
+            stride[2] = nPts[0]*nPts[1];
+            numNodes = size_t(nPts[0])*nPts[1]*nPts[2];
+            fieldData.resize(3*numNodes);
+            hasHeader = true;
+            continue;
+        }
+
+        if (numRead >= numNodes) {
+            G4cerr << "Error in FieldFIELDMAP1::ReadFile(): Too many data lines in '" << fileName << "'" << G4endl;
+            exit(1);
+        }
+        G4double B0, B1, B2;
+        lineStream >> B0 >> B1 >> B2;
+        if (lineStream.fail()) {
+            G4cerr << "Error in FieldFIELDMAP1::ReadFile(): Could not parse line '" << line << "'" << G4endl;
+            exit(1);
+        }
+        fieldData[3*numRead+0] = B0*tesla;
+        fieldData[3*numRead+1] = B1*tesla;
+        fieldData[3*numRead+2] = B2*tesla;
+        numRead++;
+    }
+
+    if (not hasHeader or numRead != numNodes) {
+        G4cerr << "Error in FieldFIELDMAP1::ReadFile(): Expected " << numNodes << " data lines in '"
+               << fileName << "', got " << numRead << G4endl;
+        exit(1);
+    }
+
+    G4cout << "Read field map '" << fileName << "': " << nDim << "D, "
+           << nPts[0] << " x " << nPts[1] << " x " << nPts[2] << " points" << G4endl;
+}
+
+G4double FieldFIELDMAP1::GetMinSpacing() const {
+    G4double minSpacing = DBL_MAX;
+    for (G4int d = 0; d < nDim; d++) {
+        minSpacing = std::min(minSpacing, 1.0/invDU[d]);
+    }
+    return minSpacing;
+}
+
+void FieldFIELDMAP1::GetTransverseHalfExtent(G4double& halfX, G4double& halfY) const {
+    if (nDim < 3) {
+        // Radial grid
+        halfX = uMax[0];
+        halfY = uMax[0];
+    }
+    else {
+        halfX = std::max(fabs(uMin[0]), fabs(uMax[0]));
+        halfY = std::max(fabs(uMin[1]), fabs(uMax[1]));
+    }
+}
+
+template <int NDIM>
+G4bool FieldFIELDMAP1::Interpolate(const G4double u[3], G4double B[3]) const {
+    // Find the cell and the fractional position inside it
+    G4int    cell = 0;
+    G4double f[3];
+    for (int d = 0; d < NDIM; d++) {
+        const G4double t = (u[d] - uMin[d]) * invDU[d];
+        if (not (t >= 0.0 and t <= nPts[d]-1)) return false; // Also catches NaN
+        const G4int i = std::min(G4int(t), nPts[d]-2);
+        f[d]  = t - i;
+        cell += i*stride[d];
+    }
+
+    // Copy the corner values into a small contiguous block, unless it is already there
+    if (cell != lastCell) {
+        for (int c = 0; c < (1<<NDIM); c++) {
+            G4int node = cell;
+            for (int d = 0; d < NDIM; d++) {
+                node += ((c>>d)&1)*stride[d];
+            }
+            cellData[3*c+0] = fieldData[3*node+0];
+            cellData[3*c+1] = fieldData[3*node+1];
+            cellData[3*c+2] = fieldData[3*node+2];
+        }
+        lastCell = cell;
+    }
+
+    // Multilinear interpolation, without branches
+    B[0] = B[1] = B[2] = 0.0;
+    for (int c = 0; c < (1<<NDIM); c++) {
+        G4double w = 1.0;
+        for (int d = 0; d < NDIM; d++) {
+            const G4double bit = (c>>d)&1;
+            w *= (1.0-f[d]) + bit*(2.0*f[d]-1.0);
+        }
+        B[0] += w*cellData[3*c+0];
+        B[1] += w*cellData[3*c+1];
+        B[2] += w*cellData[3*c+2];
+    }
+    return true;
+}
+
+void FieldFIELDMAP1::GetFieldValue(const G4double point[4], G4double field[6]) const {
+    const G4ThreeVector local = GlobalToLocalPoint(point);
+
+    field[0] = 0.0;
+    field[1] = 0.0;
+    field[2] = 0.0;
+
+    if (nDim == 3) {
+        const G4double u[3] = {local.x(), local.y(), local.z()};
+        if (not Interpolate<3>(u, field)) return;
+    }
+    else {
+        // Cylindrical map; convert (Br,Btheta,Bz) to (Bx,By,Bz)
+        const G4double r = sqrt(local.x()*local.x() + local.y()*local.y());
+        const G4double u[3] = {r, local.z(), 0.0};
+        G4double Bcyl[3];
+        G4bool inside = (nDim == 1) ? Interpolate<1>(u, Bcyl) : Interpolate<2>(u, Bcyl);
+        if (not inside) return;
+
+        const G4double invR = (r > 0.0) ? 1.0/r : 0.0;
+        const G4double cosT = local.x()*invR;
+        const G4double sinT = local.y()*invR;
+        field[0] = Bcyl[0]*cosT - Bcyl[1]*sinT;
+        field[1] = Bcyl[0]*sinT + Bcyl[1]*cosT;
+        field[2] = Bcyl[2];
+    }
+
+    LocalToGlobalAxis(field);
+}
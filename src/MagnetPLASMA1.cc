@@ -16,6 +16,7 @@
  */
 
 #include "MagnetClasses.hh"
+#include "PlasmaLensFastOptics.hh"
 
 #include "G4Box.hh"
 #include "G4Tubs.hh"
@@ -28,6 +29,7 @@
 #include "G4ChordFinder.hh"
 #include "G4ClassicalRK4.hh"
 #include "G4Mag_UsualEqRhs.hh"
+#include "G4Region.hh"
 
 #include "G4PhysicalConstants.hh"
 
@@ -56,9 +58,18 @@ MagnetPLASMA1::MagnetPLASMA1(G4double zPos_in, G4bool doRelPos_in, G4double leng
         else if (it.first == "height") {
             cryWidth = ParseDouble(it.second, "crystal height") * mm;
         }
+        else if (it.first == "fastOptics") {
+            fastOptics = ParseBool(it.second, "fastOptics");
+        }
+        else if (it.first == "booleanHole") {
+            booleanHole = ParseBool(it.second, "booleanHole");
+        }
         else if (it.first == "xOffset" || it.first == "yOffset" || it.first == "xRot" || it.first == "yRot") {
             ParseOffsetRot(it.first, it.second);
         }
+        else if (IsFieldParameter(it.first)) {
+            ParseFieldParameter(it.first, it.second);
+        }
         else {
             G4cerr << "MagnetPLASMA1 did not understand key=value pair '"
                    << it.first << "'='" << it.second << "'." << G4endl;
@@ -77,11 +88,23 @@ MagnetPLASMA1::MagnetPLASMA1(G4double zPos_in, G4bool doRelPos_in, G4double leng
         plasmaTotalCurrent = ( (gradient*tesla/meter) * twopi*capRadius*capRadius / mu0 ) / ampere;
     }
 
+    if (not (fieldVolume == "main" or fieldVolume == "crystal" or fieldVolume == "capillary")) {
+        G4cerr << "Error in MagnetPLASMA1: fieldVolume must be 'main', 'crystal' or 'capillary', "
+               << "got '" << fieldVolume << "'." << G4endl;
+        exit(1);
+    }
+    if (fieldVolume == "capillary" and fieldMargin > 0.0) {
+        G4cerr << "Error in MagnetPLASMA1: fieldMargin cannot be used with fieldVolume=capillary." << G4endl;
+        exit(1);
+    }
+
     PrintCommonParameters();
     G4cout << "\t plasmaTotalcurrent      = " << plasmaTotalCurrent << " [A]"   << G4endl;
     G4cout << "\t capRadius               = " << capRadius/mm       << " [mm]"  << G4endl;
     G4cout << "\t cryWidth                = " << cryWidth/mm        << " [mm]"  << G4endl;
     G4cout << "\t cryHeight               = " << cryHeight/mm       << " [mm]"  << G4endl;
+    G4cout << "\t fastOptics              = " << (fastOptics?"true":"false") << G4endl;
+    G4cout << "\t booleanHole             = " << (booleanHole?"true":"false") << G4endl;
 
 
 }
@@ -95,41 +118,9 @@ void MagnetPLASMA1::Construct() {
 
     this->mainLV = MakeNewMainLV("main");
 
-    /*
-    G4Material* vacuumMaterial = G4Material::GetMaterial("G4_Galactic");
-    if (not vacuumMaterial) {
-        G4cerr << "Internal error -- material G4_Galactic not found in MagnetPLASMA1::Construct()!" << G4endl;
-        exit(1);
-    }
-
-    //Field box
-    // TODO: Not really neccessary, use the mainLV directly
-    // (unless the goal is to make it smaller and contain the gas...)
-    G4VSolid* fieldBox            = new G4Box(magnetName+"_fieldBoxS",
-                                              detCon->getWorldSizeX()/2.0,
-                                              detCon->getWorldSizeX()/2.0,
-                                              length/2.0);
-    G4Material* fieldBoxMaterial  = vacuumMaterial; // TODO
-    G4LogicalVolume* fieldBoxLV   = new G4LogicalVolume(fieldBox,
-                                                        fieldBoxMaterial,
-                                                        magnetName+"_fieldBoxLV");
-    G4VPhysicalVolume* fieldBoxPV = new G4PVPlacement(NULL,
-                                                      G4ThreeVector(0.0,0.0,0.0),
-                                                      fieldBoxLV,
-                                                      magnetName + "_fieldBoxPV",
-                                                      this->mainLV,
-                                                      false,
-                                                      0,
-                                                      true); */
     field = new FieldPLASMA1(plasmaTotalCurrent, capRadius,
                              G4ThreeVector(xOffset, yOffset, getZ0()),mainLV);
-    G4FieldManager* fieldMgr = new G4FieldManager(field);
-    G4Mag_UsualEqRhs* fieldEquation = new G4Mag_UsualEqRhs(field);
-    G4MagIntegratorStepper* fieldStepper = new G4ClassicalRK4(fieldEquation);
-    G4ChordFinder* fieldChordFinder = new G4ChordFinder(field, capRadius/4.0, fieldStepper);
-    fieldMgr->SetChordFinder(fieldChordFinder);
-    //fieldBoxLV->SetFieldManager(fieldMgr,true);
-    mainLV->SetFieldManager(fieldMgr,true);
+    G4FieldManager* fieldMgr = MakeFieldManager(capRadius/4.0);
 
     if (cryWidth > mainLV_w || cryHeight > mainLV_h) {
         G4cerr << "Error in MagnetPLASMA1::Construct():" << G4endl
@@ -144,17 +135,29 @@ void MagnetPLASMA1::Construct() {
         exit(1);
     }
 
+    // The volume with the field; the crystal is placed inside it.
+    // For fieldVolume == "capillary", the field is attached to the capillary below.
+    G4LogicalVolume* crystalMotherLV = mainLV;
+    if (fieldVolume == "main") {
+        AttachFieldManager(mainLV, fieldMgr);
+    }
+    else if (fieldVolume == "crystal") {
+        crystalMotherLV = MakeFieldBoxLV(cryWidth, cryHeight, fieldMgr);
+    }
+
     //TODO: Insert here a "gas box" that is exactly the same size as the crystal
     // and made of gas material, but has no hole, OR is exactly the size of the hole.
 
     // The crystal
-    G4VSolid* crystalBox      = new G4Box(magnetName+"_crystalBoxS",
+    G4VSolid* crystalSolid    = new G4Box(magnetName+"_crystalBoxS",
                                           cryWidth/2.0, cryHeight/2.0, length/2.0);
-    G4VSolid* crystalCylinder = new G4Tubs(magnetName+"_crystalCylinderS",
-                                           0.0, capRadius, length,
-                                           0.0, 360.0*deg);
-    G4VSolid* crystalSolid    = new G4SubtractionSolid(magnetName+"_crystalS",
-                                                       crystalBox, crystalCylinder);
+    if (booleanHole) {
+        G4VSolid* crystalCylinder = new G4Tubs(magnetName+"_crystalCylinderS",
+                                               0.0, capRadius, length,
+                                               0.0, 360.0*deg);
+        crystalSolid              = new G4SubtractionSolid(magnetName+"_crystalS",
+                                                           crystalSolid, crystalCylinder);
+    }
 
     G4Material* sapphireMaterial = G4Material::GetMaterial("Sapphire");
     if (not sapphireMaterial) {
@@ -167,15 +170,45 @@ void MagnetPLASMA1::Construct() {
                                                        G4ThreeVector(0.0,0.0,0.0),
                                                        crystalLV,
                                                        magnetName + "_crystalPV",
-                                                       mainLV,
+                                                       crystalMotherLV,
                                                        false,
                                                        0,
                                                        true);
 
+    // The capillary
+    G4LogicalVolume* capillaryLV = NULL;
+    if (not booleanHole) {
+        capillaryLV = MakeHoleLV(crystalLV, capRadius, "capillary");
+    }
+    else if (fieldVolume == "capillary") {
+        // Fills the hole in the crystal solid
+        capillaryLV = MakeHoleLV(mainLV, capRadius, "capillary");
+    }
+    if (fieldVolume == "capillary") {
+        // Only the hole; particles in the crystal see no field
+        AttachFieldManager(capillaryLV, fieldMgr);
+    }
+
     ConstructDetectorLV();
     BuildMainPV_transform();
 }
 
+void MagnetPLASMA1::PostInitialize() {
+    MagnetBase::PostInitialize();
+
+    if (fastOptics) {
+        G4Region* region = mainLV->GetRegion();
+        if (region == NULL or region->GetName() != magnetName + "_region") {
+            G4cerr << "Error in MagnetPLASMA1::PostInitialize():" << G4endl
+                   << " fastOptics needs the region '" << magnetName + "_region" << "'"<< G4endl;
+            exit(1);
+        }
+        PlasmaLensFastOpticsModel* fastOpticsModel =
+            new PlasmaLensFastOpticsModel(magnetName + "_fastOptics", region,
+                                          static_cast<FieldPLASMA1*>(field), length);
+        fastOpticsModel->Print();
+    }
+}
 
 /** FIELD PATTERN CLASS **/
 
@@ -184,37 +217,24 @@ FieldPLASMA1::FieldPLASMA1(G4double current_in, G4double radius_in,
     FieldBase(centerPoint_in, fieldLV_in), plasmaTotalCurrent(current_in), capRadius(radius_in) {
     //Gradient is always stored as [T/m]. Current stored as [A]. Distances stored in G4 units.
     gradient = ( mu0*(plasmaTotalCurrent*ampere) / (twopi*capRadius*capRadius) ) / (tesla/meter);
+
+    capRadius2    = capRadius*capRadius;
+    gradient_G4   = gradient*tesla/meter;
+    currentFactor = mu0*(plasmaTotalCurrent*ampere) / twopi;
 }
 
 void FieldPLASMA1::GetFieldValue(const G4double point[4], G4double field[6]) const {
+    // Azimuthal field B = Btheta(r)/r * (-y, x), avoiding all trigonometry:
+    //  inside the capillary:  Btheta/r = gradient
+    //  outside the capillary: Btheta/r = mu0*I/(2*pi*r^2)
+    const G4ThreeVector local = GlobalToLocalPoint(point);
 
-    G4ThreeVector global(point[0],point[1],point[2]);
-    G4ThreeVector local = fGlobalToLocal.TransformPoint(global);
-
-    //G4cout << "GetFieldValue, global = " << global << " local = " << local << G4endl;
-
-    G4ThreeVector B(0.0,0.0,0.0);
-
-    G4double r = sqrt(local[0]*local[0] + local[1]*local[1]); // Position in [G4 units],
-                                                              // centered on the magnet center
+    const G4double r2 = local.x()*local.x() + local.y()*local.y();
+    const G4double BthetaOverR = (r2 < capRadius2) ? gradient_G4 : currentFactor/r2;
 
-    G4double Btheta;
-    if (r < capRadius) { //Inside the capillary
-        Btheta = gradient*(r/meter) * tesla; //Field strength in [G4 units]; convert r to [m]
-    }
-    else {               //Outside the capillary
-        // Current stored as A
-        Btheta = mu0*(plasmaTotalCurrent*ampere) / (twopi*r); //Field strength in [G4 units]
-    }
+    field[0] = -local.y()*BthetaOverR;
+    field[1] =  local.x()*BthetaOverR;
+    field[2] = 0.0;
 
-    G4double theta = atan2(local[1],local[0]);
-    B[0] = -sin(theta)*Btheta;
-    B[1] =  cos(theta)*Btheta;
-    B[2] = 0.0;
-
-    B = fGlobalToLocal.Inverse().TransformAxis(B);
-    field[0] = B[0];
-    field[1] = B[1];
-    field[2] = B[2];
+    LocalToGlobalAxis(field);
 }
-
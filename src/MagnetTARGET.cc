@@ -35,6 +35,9 @@ MagnetTARGET::MagnetTARGET(G4double zPos_in, G4bool doRelPos_in, G4double length
         else if (it.first == "height") {
             height = ParseDouble(it.second, "target height") * mm;
         }
+        else if (it.first == "absorb") {
+            absorb = ParseBool(it.second, "absorb");
+        }
         else if (it.first == "material") {
             targetMaterialName = it.second;
         }
@@ -58,6 +61,7 @@ MagnetTARGET::MagnetTARGET(G4double zPos_in, G4bool doRelPos_in, G4double length
     G4cout << "\t targetMaterialName      = " << targetMaterialName <<             G4endl;
     G4cout << "\t width                   = " << width/mm           << " [mm]"  << G4endl;
     G4cout << "\t height                  = " << height/mm          << " [mm]"  << G4endl;
+    G4cout << "\t absorb                  = " << (absorb?"true":"false") << G4endl;
 
 }
 
@@ -105,6 +109,10 @@ void MagnetTARGET::Construct() {
                                                       0,
                                                       true);
 
+    if (absorb) {
+        MakeAbsorberRegion(targetLV);
+    }
+
     ConstructDetectorLV();
     BuildMainPV_transform();
 }
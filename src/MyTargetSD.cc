@@ -16,6 +16,7 @@
  */
 
 #include "MyTargetSD.hh"
+#include "TrackingAction.hh"
 #include "G4HCofThisEvent.hh"
 #include "G4SDManager.hh"
 #include "G4Step.hh"
@@ -24,6 +25,7 @@
 #include "G4RunManager.hh"
 
 #include <iostream>
+#include <cmath>
 
 //using namespace std;
 
@@ -50,6 +52,7 @@ void MyTargetSD::Initialize(G4HCofThisEvent* hitsCollectionOfThisEvent) {
         fHitsCollectionID_edep = G4SDManager::GetSDMpointer()->GetCollectionID(fHitsCollection_edep);
     }
     hitsCollectionOfThisEvent->AddHitsCollection(fHitsCollectionID_edep, fHitsCollection_edep);
+    edepSums.clear();
 
     //Exit positions
     fHitsCollection_exitpos = new MyTrackerHitsCollection(SensitiveDetectorName, collectionName[1]);
@@ -63,17 +66,43 @@ void MyTargetSD::Initialize(G4HCofThisEvent* hitsCollectionOfThisEvent) {
 G4bool MyTargetSD::ProcessHits(G4Step* aStep, G4TouchableHistory*) {
 
     //Always do the energy deposit
-    MyEdepHit* aHit_edep = new MyEdepHit(aStep->GetTotalEnergyDeposit(),
-                                         aStep->GetNonIonizingEnergyDeposit(),
-                                         aStep->GetPreStepPoint()->GetPosition(),
-                                         aStep->GetPostStepPoint()->GetPosition());
-    fHitsCollection_edep->insert(aHit_edep);
+    const G4int primaryIdx = PrimaryTrackInformation::GetPrimaryIdx(aStep->GetTrack());
+    if (accumulateEdep) {
+        while (G4int(edepSums.size()) <= primaryIdx) {
+            MyEdepHit* edepSum = new MyEdepHit();
+            edepSum->SetPrimaryIdx(edepSums.size());
+            fHitsCollection_edep->insert(edepSum);
+            edepSums.push_back(edepSum);
+        }
+        MyEdepHit* edepSum = edepSums[primaryIdx];
+        const G4double weight = aStep->GetPreStepPoint()->GetWeight();
+        edepSum->SetDepositedEnergy(edepSum->GetDepositedEnergy() +
+                                    aStep->GetTotalEnergyDeposit()*weight);
+        edepSum->SetDepositedEnergy_NIEL(edepSum->GetDepositedEnergy_NIEL() +
+                                         aStep->GetNonIonizingEnergyDeposit()*weight);
+    }
+    else {
+        MyEdepHit* aHit_edep = new MyEdepHit(aStep->GetTotalEnergyDeposit(),
+                                             aStep->GetNonIonizingEnergyDeposit(),
+                                             aStep->GetPreStepPoint()->GetPosition(),
+                                             aStep->GetPostStepPoint()->GetPosition());
+        aHit_edep->SetWeight(aStep->GetPreStepPoint()->GetWeight());
+        aHit_edep->SetPrimaryIdx(primaryIdx);
+        fHitsCollection_edep->insert(aHit_edep);
+    }
 
     //Only use outgoing tracks
     if (aStep->GetPostStepPoint()->GetStepStatus()==fGeomBoundary) {
+        const G4ThreeVector& hitPos = aStep->GetPostStepPoint()->GetPosition();
+        if (hasExitFace) {
+            // Check in the local frame, so that rotated objects work
+            const G4Point3D localPos = globalToLocal * G4Point3D(hitPos);
+            if (std::abs(localPos.z() - exitZ) > 1e-7) {
+                return true;
+            }
+        }
         G4double energy = aStep->GetPostStepPoint()->GetKineticEnergy();
         const G4ThreeVector momentum = aStep->GetPostStepPoint()->GetMomentum();
-        const G4ThreeVector& hitPos = aStep->GetPostStepPoint()->GetPosition();
 
         G4Track* theTrack = aStep->GetTrack();
         G4ParticleDefinition* particleType = theTrack->GetDefinition();
@@ -82,6 +111,8 @@ G4bool MyTargetSD::ProcessHits(G4Step* aStep, G4TouchableHistory*) {
 
         MyTrackerHit* aHit = new MyTrackerHit(hitPos, momentum, energy, particleID, particleCharge);
         aHit->SetType(particleType->GetParticleSubType());
+        aHit->SetWeight(aStep->GetPostStepPoint()->GetWeight());
+        aHit->SetPrimaryIdx(primaryIdx);
         fHitsCollection_exitpos->insert(aHit);
     }
 
@@ -16,6 +16,7 @@
  */
 
 #include "MyTrackerSD.hh"
+#include "TrackingAction.hh"
 #include "G4HCofThisEvent.hh"
 #include "G4SDManager.hh"
 #include "G4Step.hh"
@@ -57,7 +58,12 @@ void MyTrackerSD::Initialize(G4HCofThisEvent* hitsCollectionOfThisEvent) {
 G4bool MyTrackerSD::ProcessHits(G4Step* aStep, G4TouchableHistory*) {
   //Only use incoming tracks
   if (aStep->GetPreStepPoint()->GetStepStatus()!=fGeomBoundary) {
-    G4cout << "MyTrackerSD::ProcessHits(): SKIP!" << G4endl;
+    if (not forwardOnly) {
+      G4cout << "MyTrackerSD::ProcessHits(): SKIP!" << G4endl;
+    }
+    return false;
+  }
+  if (forwardOnly and aStep->GetPreStepPoint()->GetMomentumDirection().z() <= 0.0) {
     return false;
   }
 
@@ -72,6 +78,8 @@ G4bool MyTrackerSD::ProcessHits(G4Step* aStep, G4TouchableHistory*) {
 
   MyTrackerHit* aHit = new MyTrackerHit(hitPos, momentum, energy, particleID, particleCharge);
   aHit->SetType(particleType->GetParticleSubType());
+  aHit->SetWeight(aStep->GetPreStepPoint()->GetWeight());
+  aHit->SetPrimaryIdx(PrimaryTrackInformation::GetPrimaryIdx(aStep->GetTrack()));
   fHitsCollection->insert(aHit);
 
   return true;
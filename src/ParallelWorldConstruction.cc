@@ -17,8 +17,11 @@
 
 #include "ParallelWorldConstruction.hh"
 #include "MagnetClasses.hh"
+#include "MyTrackerSD.hh"
 
 #include "G4PVPlacement.hh"
+#include "G4Box.hh"
+#include "G4SDManager.hh"
 
 ParallelWorldConstruction::ParallelWorldConstruction(G4String worldName, DetectorConstruction* mainGeometryConstruction_in)  :
     G4VUserParallelWorld(worldName), mainGeometryConstruction(mainGeometryConstruction_in) {
@@ -33,7 +36,10 @@ void ParallelWorldConstruction::Construct() {
     G4VPhysicalVolume* ghostWorld        = GetWorld();
     G4LogicalVolume*   ghostWorldLogical = ghostWorld->GetLogicalVolume();
 
+    // Unless the magnets are scored in the mass world
     for (auto magnet : mainGeometryConstruction->magnets) {
+        if (mainGeometryConstruction->GetMassWorldScoring()) break;
+
         //Pretty much a copy of what goes on in DetectorConstruction::Construct()
         G4VPhysicalVolume* magnetDetectorPV   =
             new G4PVPlacement(magnet->GetMainPV_transform(),
@@ -46,11 +52,43 @@ void ParallelWorldConstruction::Construct() {
         magnetDetectorPVs.push_back(magnetDetectorPV);
 
     }
+
+    // Scoring planes inside the target; in the parallel world they don't change the target material.
+    const G4double planeThickness = mainGeometryConstruction->getDetectorThickness();
+    for (size_t i = 0; i < mainGeometryConstruction->GetTargetPlanes().size(); i++) {
+        const G4String planeName = DetectorConstruction::GetTargetPlaneName(i);
+
+        G4Box* planeS = new G4Box(planeName+"S",
+                                  mainGeometryConstruction->getTargetSizeX()/2.0,
+                                  mainGeometryConstruction->getTargetSizeY()/2.0,
+                                  planeThickness/2.0);
+        // The material is ignored in a parallel world
+        G4LogicalVolume* planeLV = new G4LogicalVolume(planeS, NULL, planeName+"LV");
+        new G4PVPlacement(NULL,
+                          G4ThreeVector(0.0,0.0,mainGeometryConstruction->GetTargetPlaneZ(i)),
+                          planeLV,
+                          planeName+"PV",
+                          ghostWorldLogical,
+                          false,
+                          0,
+                          true);
+        targetPlaneLVs.push_back(planeLV);
+    }
 }
 
 void ParallelWorldConstruction::ConstructSD() {
 
-    for (auto magnet : mainGeometryConstruction->magnets) {
-        magnet->AddSD();
+    if (not mainGeometryConstruction->GetMassWorldScoring()) {
+        for (auto magnet : mainGeometryConstruction->magnets) {
+            magnet->AddSD();
+        }
+    }
+
+    G4SDManager* SDman = G4SDManager::GetSDMpointer();
+    for (size_t i = 0; i < targetPlaneLVs.size(); i++) {
+        MyTrackerSD* planeSD = new MyTrackerSD(DetectorConstruction::GetTargetPlaneName(i));
+        planeSD->SetForwardOnly(true);
+        SDman->AddNewDetector(planeSD);
+        targetPlaneLVs[i]->SetSensitiveDetector(planeSD);
     }
 }
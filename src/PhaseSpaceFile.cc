@@ -0,0 +1,262 @@
+/*
+ * This file is part of MiniScatter.
+ *
+ *  MiniScatter is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  MiniScatter is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with MiniScatter.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "PhaseSpaceFile.hh"
+
+#include <cstring>
+#include <algorithm>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+//--------------------------------------------------------------------------------
+
+static const char phaseSpaceMagic[8] = "MSPHSP1";
+
+PhaseSpaceFileWriter::PhaseSpaceFileWriter(G4String fileName_in) :
+    fileName(fileName_in) {
+    outFile.open(fileName.data(), std::ios::out | std::ios::binary | std::ios::trunc);
+    if (not outFile.is_open()) {
+        G4cerr << "Error in PhaseSpaceFileWriter: Could not open file '" << fileName << "' for writing." << G4endl;
+        exit(1);
+    }
+
+    std::memcpy(header.magic, phaseSpaceMagic, sizeof(header.magic));
+    header.numEvents       = 0;
+    header.numRecordEvents = 0;
+    header.numRecords      = 0;
+    // Placeholder, filled in by Close()
+    outFile.write(reinterpret_cast<const char*>(&header), sizeof(header));
+}
+
+PhaseSpaceFileWriter::~PhaseSpaceFileWriter() {
+    if (outFile.is_open()) {
+        outFile.close();
+    }
+}
+
+void PhaseSpaceFileWriter::Write(const phaseSpaceRecord& record) {
+    if (record.eventID != lastEventID) {
+        header.numRecordEvents++;
+        lastEventID = record.eventID;
+    }
+    header.numRecords++;
+    outFile.write(reinterpret_cast<const char*>(&record), sizeof(record));
+}
+
+void PhaseSpaceFileWriter::Close(uint64_t numEvents) {
+    header.numEvents = numEvents;
+    outFile.seekp(0);
+    outFile.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    outFile.close();
+    if (outFile.fail()) {
+        G4cerr << "Error in PhaseSpaceFileWriter: Writing to file '" << fileName << "' failed." << G4endl;
+        exit(1);
+    }
+
+    G4cout << "Wrote phase space file '" << fileName << "': "
+           << header.numRecords << " particles from "
+           << header.numRecordEvents << " / " << header.numEvents << " events." << G4endl;
+}
+
+//--------------------------------------------------------------------------------
+
+PhaseSpaceFileReader::PhaseSpaceFileReader(G4String fileName_in) :
+    fileName(fileName_in) {
+    inFile.open(fileName.data(), std::ios::in | std::ios::binary);
+    if (not inFile.is_open()) {
+        G4cerr << "Error in PhaseSpaceFileReader: Could not open file '" << fileName << "' for reading." << G4endl;
+        exit(1);
+    }
+
+    inFile.read(reinterpret_cast<char*>(&header), sizeof(header));
+    if (inFile.gcount() != sizeof(header) or
+        std::memcmp(header.magic, phaseSpaceMagic, sizeof(header.magic)) != 0) {
+        G4cerr << "Error in PhaseSpaceFileReader: File '" << fileName << "' is not a phase space file." << G4endl;
+        exit(1);
+    }
+    if (header.numRecords == 0) {
+        G4cerr << "Error in PhaseSpaceFileReader: File '" << fileName << "' contains no particles." << G4endl;
+        exit(1);
+    }
+
+    if (not ReadRecord(nextRecord)) {
+        G4cerr << "Error in PhaseSpaceFileReader: File '" << fileName << "' is truncated." << G4endl;
+        exit(1);
+    }
+}
+
+PhaseSpaceFileReader::~PhaseSpaceFileReader() {
+    if (inFile.is_open()) {
+        inFile.close();
+    }
+}
+
+G4bool PhaseSpaceFileReader::ReadRecord(phaseSpaceRecord& record) {
+    inFile.read(reinterpret_cast<char*>(&record), sizeof(record));
+    return inFile.gcount() == sizeof(record);
+}
+
+void PhaseSpaceFileReader::Rewind() {
+    inFile.clear();
+    inFile.seekg(sizeof(header));
+    if (not ReadRecord(nextRecord)) {
+        G4cerr << "Error in PhaseSpaceFileReader: Could not rewind file '" << fileName << "'." << G4endl;
+        exit(1);
+    }
+    numRewinds++;
+    G4cout << "Warning in PhaseSpaceFileReader: Reached the end of file '" << fileName << "', "
+           << "restarting from the beginning (pass " << numRewinds+1 << ")." << G4endl;
+}
+
+void PhaseSpaceFileReader::ReadEvent(std::vector<phaseSpaceRecord>& records) {
+    records.clear();
+    records.push_back(nextRecord);
+
+    phaseSpaceRecord record;
+    while (ReadRecord(record)) {
+        if (record.eventID != records.front().eventID) {
+            nextRecord = record;
+            return;
+        }
+        records.push_back(record);
+    }
+
+    // End of file; the current event is complete
+    Rewind();
+}
+
+void PhaseSpaceFileReader::Print() {
+    G4cout << "Initialized PhaseSpaceFileReader, parameters:" << G4endl;
+    G4cout << "\t fileName                = " << fileName << G4endl;
+    G4cout << "\t numEvents               = " << header.numEvents << G4endl;
+    G4cout << "\t numRecordEvents         = " << header.numRecordEvents << G4endl;
+    G4cout << "\t numRecords              = " << header.numRecords << G4endl;
+    G4cout << "Each event in this run corresponds to "
+           << double(header.numEvents)/double(header.numRecordEvents)
+           << " primaries of the target stage." << G4endl;
+}
+
+//--------------------------------------------------------------------------------
+
+static const char beamFileMagic[8] = "MSBEAM1";
+
+BeamFileReader::BeamFileReader(G4String fileName_in, G4bool resample_in) :
+    fileName(fileName_in), resample(resample_in) {
+    inFile.open(fileName.data(), std::ios::in | std::ios::binary);
+    if (not inFile.is_open()) {
+        G4cerr << "Error in BeamFileReader: Could not open file '" << fileName << "' for reading." << G4endl;
+        exit(1);
+    }
+
+    inFile.read(reinterpret_cast<char*>(&header), sizeof(header));
+    if (inFile.gcount() != sizeof(header) or
+        std::memcmp(header.magic, beamFileMagic, sizeof(header.magic)) != 0) {
+        G4cerr << "Error in BeamFileReader: File '" << fileName << "' is not a beam file." << G4endl;
+        exit(1);
+    }
+    if (header.numRecords == 0) {
+        G4cerr << "Error in BeamFileReader: File '" << fileName << "' contains no particles." << G4endl;
+        exit(1);
+    }
+
+    inFile.seekg(0, std::ios::end);
+    const uint64_t fileSize = inFile.tellg();
+    if (fileSize < sizeof(header) + header.numRecords*sizeof(beamFileRecord)) {
+        G4cerr << "Error in BeamFileReader: File '" << fileName << "' is truncated; expected "
+               << header.numRecords << " particles." << G4endl;
+        exit(1);
+    }
+
+    if (resample) {
+        // Random access; let the OS page in the parts of the file that are used
+        inFile.close();
+        int fd = open(fileName.data(), O_RDONLY);
+        if (fd < 0) {
+            G4cerr << "Error in BeamFileReader: Could not open file '" << fileName << "' for mapping." << G4endl;
+            exit(1);
+        }
+        mapSize = fileSize;
+        mapAddr = mmap(NULL, mapSize, PROT_READ, MAP_SHARED, fd, 0);
+        close(fd);
+        if (mapAddr == MAP_FAILED) {
+            G4cerr << "Error in BeamFileReader: Could not map file '" << fileName << "'." << G4endl;
+            exit(1);
+        }
+        madvise(mapAddr, mapSize, MADV_RANDOM);
+        mapRecords = reinterpret_cast<const beamFileRecord*>(static_cast<const char*>(mapAddr) + sizeof(header));
+    }
+    else {
+        inFile.seekg(sizeof(header));
+        chunk.reserve(chunkSize);
+        ReadChunk();
+    }
+}
+
+BeamFileReader::~BeamFileReader() {
+    if (inFile.is_open()) {
+        inFile.close();
+    }
+    if (mapAddr != NULL) {
+        munmap(mapAddr, mapSize);
+    }
+}
+
+void BeamFileReader::ReadChunk() {
+    // Never read past the last record, in case the file has trailing data
+    const uint64_t recordPos = (uint64_t(inFile.tellg()) - sizeof(header)) / sizeof(beamFileRecord);
+    size_t numRead = std::min(uint64_t(chunkSize), header.numRecords - recordPos);
+    if (numRead == 0) {
+        inFile.clear();
+        inFile.seekg(sizeof(header));
+        numRewinds++;
+        G4cout << "Warning in BeamFileReader: Reached the end of file '" << fileName << "', "
+               << "restarting from the beginning (pass " << numRewinds+1 << ")." << G4endl;
+        numRead = std::min(uint64_t(chunkSize), header.numRecords);
+    }
+
+    chunk.resize(numRead);
+    inFile.read(reinterpret_cast<char*>(chunk.data()), numRead*sizeof(beamFileRecord));
+    if (inFile.gcount() != std::streamsize(numRead*sizeof(beamFileRecord))) {
+        G4cerr << "Error in BeamFileReader: Reading from file '" << fileName << "' failed." << G4endl;
+        exit(1);
+    }
+    chunkPos = 0;
+}
+
+const beamFileRecord& BeamFileReader::ReadNext() {
+    if (chunkPos == chunk.size()) {
+        ReadChunk();
+    }
+    return chunk[chunkPos++];
+}
+
+const beamFileRecord& BeamFileReader::ReadRandom(G4double u) {
+    const uint64_t idx = std::min(uint64_t(u*header.numRecords), header.numRecords-1);
+    return mapRecords[idx];
+}
+
+void BeamFileReader::Print() {
+    G4cout << "Initialized BeamFileReader, parameters:" << G4endl;
+    G4cout << "\t fileName                = " << fileName << G4endl;
+    G4cout << "\t numRecords              = " << header.numRecords << G4endl;
+    G4cout << "\t resample                = " << (resample?"true":"false") << G4endl;
+}
+
+//--------------------------------------------------------------------------------
@@ -0,0 +1,137 @@
+/*
+ * This file is part of MiniScatter.
+ *
+ *  MiniScatter is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  MiniScatter is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with MiniScatter.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "PlasmaLensFastOptics.hh"
+#include "PlasmaLensStepper.hh"
+#include "MagnetClasses.hh"
+
+#include "G4FastTrack.hh"
+#include "G4FastStep.hh"
+#include "G4Track.hh"
+#include "G4DynamicParticle.hh"
+#include "G4ParticleDefinition.hh"
+#include "G4GeometryTolerance.hh"
+#include "G4SystemOfUnits.hh"
+#include "G4PhysicalConstants.hh"
+
+#include <cmath>
+#include <algorithm>
+
+//--------------------------------------------------------------------------------
+
+PlasmaLensFastOpticsModel::PlasmaLensFastOpticsModel(G4String modelName, G4Region* envelope,
+                                                     const FieldPLASMA1* field_in, G4double length_in) :
+    G4VFastSimulationModel(modelName, envelope),
+    field(field_in),
+    length(length_in) {
+}
+
+//--------------------------------------------------------------------------------
+
+void PlasmaLensFastOpticsModel::Print() {
+    G4cout << "Initialized PlasmaLensFastOpticsModel '" << GetName() << "', parameters:" << G4endl;
+    G4cout << "\t length                  = " << length/mm << " [mm]" << G4endl;
+    G4cout << "\t capRadius               = " << field->GetCapRadius()/mm << " [mm]" << G4endl;
+    G4cout << "\t gradient                = " << field->GetGradientG4()/(tesla/meter) << " [T/m]" << G4endl;
+}
+
+//--------------------------------------------------------------------------------
+
+G4bool PlasmaLensFastOpticsModel::IsApplicable(const G4ParticleDefinition& particle) {
+    return particle.GetPDGCharge() != 0.0;
+}
+
+G4bool PlasmaLensFastOpticsModel::ComputeExit(const G4FastTrack& fastTrack,
+                                              G4ThreeVector& exitPos, G4ThreeVector& exitDir,
+                                              G4double& pathLength) {
+    // Only tracks that enter through the front face, inside the capillary
+    const G4ThreeVector& pos0 = fastTrack.GetPrimaryTrackLocalPosition();
+    const G4ThreeVector& u0   = fastTrack.GetPrimaryTrackLocalDirection();
+    if (u0.z() <= 0.0) return false;
+    if (fabs(pos0.z() + length/2.0) > G4GeometryTolerance::GetInstance()->GetSurfaceTolerance()) {
+        return false;
+    }
+    const G4double capRadius2 = field->GetCapRadius()*field->GetCapRadius();
+    const G4double r02 = pos0.perp2();
+    if (r02 >= capRadius2) return false;
+
+    const G4Track* track = fastTrack.GetPrimaryTrack();
+    const G4double pMag = track->GetMomentum().mag();
+    if (pMag <= 0.0) return false;
+    // Same as G4Mag_EqRhs::FCof()*gradient/|p|; the charge is in units of eplus
+    const G4double kappa = track->GetDynamicParticle()->GetCharge()*eplus*c_light * field->GetGradientG4()/pMag;
+
+    // Predictor: uz constant
+    G4ThreeVector posP, uP;
+    PlasmaLensStepper::Propagate(pos0, u0, kappa*u0.z(), u0.z(), length/u0.z(), posP, uP);
+
+    // Corrector: uz averaged over the lens, using the invariant uz - kappa*r^2/2
+    const G4double uzMid = u0.z() + 0.25*kappa*(posP.perp2() - r02);
+    if (uzMid <= 0.0) return false;
+    const G4double K = kappa*uzMid;
+    pathLength = length/uzMid;
+    PlasmaLensStepper::Propagate(pos0, u0, K, uzMid, pathLength, exitPos, exitDir);
+
+    // Largest radius along the lens.
+    // When focusing, r^2 = P + Q*cos(2*phi) + R*sin(2*phi) with phi = sqrt(K)*s;
+    // otherwise r^2 is convex in s and the maximum is at one of the ends.
+    G4double r2max = std::max(r02, exitPos.perp2());
+    if (K*pathLength*pathLength > 1e-12) {
+        const G4double w = sqrt(K);
+        const G4double a = r02;
+        const G4double b = pos0.x()*u0.x() + pos0.y()*u0.y();
+        const G4double c = u0.x()*u0.x() + u0.y()*u0.y();
+        const G4double P = 0.5*(a + c/K);
+        const G4double Q = 0.5*(a - c/K);
+        const G4double R = b/w;
+        G4double phiMax = 0.5*atan2(R,Q);
+        if (phiMax < 0.0) phiMax += pi;
+        if (phiMax < w*pathLength) {
+            r2max = P + sqrt(Q*Q + R*R);
+        }
+    }
+    if (r2max >= capRadius2) return false;
+
+    exitPos.setZ(length/2.0);
+    exitDir.setZ(u0.z() + 0.5*kappa*(exitPos.perp2() - r02));
+    exitDir = exitDir.unit();
+
+    return true;
+}
+
+G4bool PlasmaLensFastOpticsModel::ModelTrigger(const G4FastTrack& fastTrack) {
+    G4ThreeVector exitPos;
+    G4ThreeVector exitDir;
+    G4double pathLength;
+    return ComputeExit(fastTrack, exitPos, exitDir, pathLength);
+}
+
+void PlasmaLensFastOpticsModel::DoIt(const G4FastTrack& fastTrack, G4FastStep& fastStep) {
+    G4ThreeVector exitPos;
+    G4ThreeVector exitDir;
+    G4double pathLength;
+    ComputeExit(fastTrack, exitPos, exitDir, pathLength);
+
+    const G4Track* track = fastTrack.GetPrimaryTrack();
+
+    fastStep.ProposePrimaryTrackFinalPosition(exitPos);
+    fastStep.ProposePrimaryTrackFinalMomentumDirection(exitDir);
+    fastStep.ProposePrimaryTrackPathLength(pathLength);
+    fastStep.ProposePrimaryTrackFinalTime(track->GetGlobalTime() + pathLength/(track->GetVelocity()));
+}
+
+//--------------------------------------------------------------------------------
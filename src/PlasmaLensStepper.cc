@@ -0,0 +1,131 @@
+/*
+ * This file is part of MiniScatter.
+ *
+ *  MiniScatter is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  MiniScatter is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with MiniScatter.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "PlasmaLensStepper.hh"
+#include "MagnetClasses.hh"
+
+#include "G4Mag_EqRhs.hh"
+#include "G4ClassicalRK4.hh"
+#include "G4LineSection.hh"
+
+#include <cmath>
+
+//--------------------------------------------------------------------------------
+
+PlasmaLensStepper::PlasmaLensStepper(G4Mag_EqRhs* equation_in, const FieldPLASMA1* field_in) :
+    G4MagIntegratorStepper(equation_in, 6),
+    equation(equation_in),
+    field(field_in) {
+    fallbackStepper = new G4ClassicalRK4(equation);
+}
+
+PlasmaLensStepper::~PlasmaLensStepper() {
+    delete fallbackStepper;
+}
+
+//--------------------------------------------------------------------------------
+
+void PlasmaLensStepper::Propagate(const G4ThreeVector& pos0, const G4ThreeVector& u0, G4double K, G4double uz,
+                                  G4double h, G4ThreeVector& pos1, G4ThreeVector& u1) {
+    // Transfer matrix elements C, S and their derivatives
+    G4double C, S, dC;
+    const G4double phi2 = K*h*h;
+    if (phi2 > 1e-12) {
+        const G4double w = sqrt(K);
+        C  = cos(w*h);
+        S  = sin(w*h)/w;
+        dC = -w*sin(w*h);
+    }
+    else if (phi2 < -1e-12) {
+        const G4double w = sqrt(-K);
+        C  = cosh(w*h);
+        S  = sinh(w*h)/w;
+        dC = w*sinh(w*h);
+    }
+    else {
+        // Drift-like; expansion to first order in K
+        C  = 1.0 - 0.5*phi2;
+        S  = h*(1.0 - phi2/6.0);
+        dC = -K*h;
+    }
+
+    pos1.set(C*pos0.x() + S*u0.x(), C*pos0.y() + S*u0.y(), pos0.z() + uz*h);
+    u1.set(dC*pos0.x() + C*u0.x(), dC*pos0.y() + C*u0.y(), uz);
+}
+
+void PlasmaLensStepper::Stepper(const G4double yIn[], const G4double dydx[], G4double h,
+                                G4double yOut[], G4double yErr[]) {
+    const G4ThreeVector momentum(yIn[3], yIn[4], yIn[5]);
+    const G4double pMag = momentum.mag();
+    const G4ThreeVector pos0 = field->PointToLocal(G4ThreeVector(yIn[0], yIn[1], yIn[2]));
+    const G4double capRadius = field->GetCapRadius();
+
+    if (pMag > 0.0 and pos0.perp() < capRadius) {
+        const G4ThreeVector u0 = field->AxisToLocal(momentum/pMag);
+        const G4double kappa = equation->FCof()*field->GetGradientG4()/pMag;
+        const G4double r02   = pos0.perp2();
+
+        // Predictor: uz constant
+        G4ThreeVector posP, uP;
+        Propagate(pos0, u0, kappa*u0.z(), u0.z(), h, posP, uP);
+
+        // Corrector: uz averaged over the step, using the invariant
+        const G4double uzMid = u0.z() + 0.25*kappa*(posP.perp2() - r02);
+        G4ThreeVector posC, uC;
+        Propagate(pos0, u0, kappa*uzMid, uzMid, h, posC, uC);
+
+        if (posP.perp() < capRadius and posC.perp() < capRadius) {
+            uC.setZ(u0.z() + 0.5*kappa*(posC.perp2() - r02));
+            uC = uC.unit();
+
+            const G4ThreeVector posOut = field->PointToGlobal(posC);
+            const G4ThreeVector momOut = field->AxisToGlobal(uC)*pMag;
+            const G4ThreeVector posErr = field->AxisToGlobal(posC - posP);
+            const G4ThreeVector momErr = field->AxisToGlobal(uC - uP)*pMag;
+            for (int i = 0; i < 3; i++) {
+                yOut[i]   = posOut[i];
+                yOut[i+3] = momOut[i];
+                yErr[i]   = posErr[i];
+                yErr[i+3] = momErr[i];
+            }
+
+            // Remember the arc for DistChord()
+            G4ThreeVector uMid;
+            Propagate(pos0, u0, kappa*uzMid, uzMid, 0.5*h, chordMid, uMid);
+            chordStart = pos0;
+            chordEnd   = posC;
+            lastStepFallback = false;
+            return;
+        }
+    }
+
+    // Outside the linear region
+    fallbackStepper->Stepper(yIn, dydx, h, yOut, yErr);
+    lastStepFallback = true;
+}
+
+G4double PlasmaLensStepper::DistChord() const {
+    if (lastStepFallback) {
+        return fallbackStepper->DistChord();
+    }
+    if (chordStart == chordEnd) {
+        return (chordMid - chordStart).mag();
+    }
+    return G4LineSection::Distline(chordMid, chordStart, chordEnd);
+}
+
+//--------------------------------------------------------------------------------
@@ -19,18 +19,20 @@
 #include "DetectorConstruction.hh"
 #include "G4Event.hh"
 #include "G4ParticleGun.hh"
+#include "G4PrimaryParticle.hh"
+#include "G4PrimaryVertex.hh"
 #include "G4ParticleTable.hh"
 #include "G4IonTable.hh"
 #include "Randomize.hh"
 #include "G4UnitsTable.hh"
 #include "G4SystemOfUnits.hh"
+#include "G4PhysicalConstants.hh"
 #include "G4String.hh"
 
 #include <iostream>
 #include <cmath>
 #include <string>
 
-#include "TRandom1.h"
 
 // -----------------------------------------------------------------------------------------
 
@@ -41,10 +43,16 @@ PrimaryGeneratorAction::PrimaryGeneratorAction(DetectorConstruction* DC,
                                                G4double beam_zpos_in,
                                                G4bool   doBacktrack_in,
                                                G4String covarianceString_in,
+                                               G4String covarMatrixString_in,
                                                G4double Rcut_in,
                                                G4int rngSeed_in,
                                                G4double beam_energy_min_in,
-                                               G4double beam_energy_max_in  ) :
+                                               G4double beam_energy_max_in,
+                                               G4String phaseSpaceIn_in,
+                                               G4String beamFileIn_in,
+                                               std::vector<G4String> &beamHistDefinitions,
+                                               G4int primariesPerEvent_in,
+                                               G4int numPrimariesTotal_in ) :
     Detector(DC),
     beam_energy(beam_energy_in),
     beam_type(beam_type_in),
@@ -52,10 +60,15 @@ PrimaryGeneratorAction::PrimaryGeneratorAction(DetectorConstruction* DC,
     beam_zpos(beam_zpos_in),
     doBacktrack(doBacktrack_in),
     covarianceString(covarianceString_in),
+    covarMatrixString(covarMatrixString_in),
     Rcut(Rcut_in),
     rngSeed(rngSeed_in),
     beam_energy_min(beam_energy_min_in),
-    beam_energy_max(beam_energy_max_in) {
+    beam_energy_max(beam_energy_max_in),
+    phaseSpaceIn(phaseSpaceIn_in),
+    beamFileIn(beamFileIn_in),
+    primariesPerEvent(primariesPerEvent_in),
+    numPrimariesTotal(numPrimariesTotal_in) {
 
     G4int n_particle = 1;
     particleGun  = new G4ParticleGun(n_particle);
@@ -83,10 +96,87 @@ PrimaryGeneratorAction::PrimaryGeneratorAction(DetectorConstruction* DC,
         }
     }
 
+    if (covarianceString != "" and covarMatrixString != "") {
+        G4cerr << "Error in PrimaryGeneratorAction: "
+               << "The covariance can be given either by Twiss parameters or as a full matrix, not both." << G4endl;
+        exit(1);
+    }
+
+    if (phaseSpaceIn != "") {
+        if (Detector->GetHasTarget()) {
+            G4cerr << "Error in PrimaryGeneratorAction: Reading a phase space file "
+                   << "requires running without a target (-t 0), "
+                   << "since the particles already crossed it." << G4endl;
+            exit(1);
+        }
+        phaseSpaceReader = new PhaseSpaceFileReader(phaseSpaceIn);
+        phaseSpaceReader->Print();
+    }
+
+    if (beamFileIn != "") {
+        if (phaseSpaceIn != "" or covarianceString != "" or covarMatrixString != "" or Rcut != 0.0 or
+            (beam_energy_min >= 0.0 and beam_energy_max > 0.0)) {
+            G4cerr << "Error in PrimaryGeneratorAction: A beam file can not be combined with "
+                   << "a phase space file, covariance matrix, Rcut, or flat energy distribution." << G4endl;
+            exit(1);
+        }
+        G4String beamFileName = beamFileIn;
+        G4bool   resample     = false;
+        const G4String resampleFlag = ",resample";
+        if (beamFileName.length() > resampleFlag.length() and
+            beamFileName.compare(beamFileName.length()-resampleFlag.length(), resampleFlag.length(), resampleFlag) == 0) {
+            beamFileName = beamFileName(0, beamFileName.length()-resampleFlag.length());
+            resample = true;
+        }
+        beamFileReader = new BeamFileReader(beamFileName, resample);
+        beamFileReader->Print();
+    }
+
+    if (primariesPerEvent < 1) {
+        G4cerr << "Error in PrimaryGeneratorAction: Expected primariesPerEvent >= 1, got "
+               << primariesPerEvent << G4endl;
+        exit(1);
+    }
+    if (primariesPerEvent > 1 and phaseSpaceIn != "") {
+        G4cerr << "Error in PrimaryGeneratorAction: Several primaries per event can not be combined with "
+               << "a phase space file, where each event already holds the particles from one primary." << G4endl;
+        exit(1);
+    }
+
+    G4bool histCoords[4] = {false, false, false, false};
+    for (auto beamHistDefinition : beamHistDefinitions) {
+        if (phaseSpaceIn != "" or beamFileIn != "" or Rcut != 0.0) {
+            G4cerr << "Error in PrimaryGeneratorAction: Beam histograms can not be combined with "
+                   << "a phase space file, beam file, or Rcut." << G4endl;
+            exit(1);
+        }
+        HistogramSampler* beamHist = new HistogramSampler(beamHistDefinition);
+        if (histCoords[beamHist->GetCoordA()] or histCoords[beamHist->GetCoordB()]) {
+            G4cerr << "Error in PrimaryGeneratorAction: The beam histogram '" << beamHistDefinition << "' "
+                   << "covers a coordinate which is already given by another beam histogram." << G4endl;
+            exit(1);
+        }
+        histCoords[beamHist->GetCoordA()] = true;
+        histCoords[beamHist->GetCoordB()] = true;
+        beamHist->Print();
+        beamHists.push_back(beamHist);
+    }
 }
 
 PrimaryGeneratorAction::~PrimaryGeneratorAction() {
     delete particleGun;
+    if (phaseSpaceReader != NULL) {
+        delete phaseSpaceReader;
+    }
+    if (beamFileReader != NULL) {
+        delete beamFileReader;
+    }
+    for (auto beamHist : beamHists) {
+        delete beamHist;
+    }
+    if (sampler != NULL) {
+        delete sampler;
+    }
 }
 
 
@@ -178,24 +268,75 @@ void PrimaryGeneratorAction::setupCovariance() {
     G4cout << "Covariance matrix (Y) [m^2, m * rad, rad^2]:" << G4endl;
     covarY.Print();
 
-    // Get the cholesky decomposition
-    TDecompChol covarX_Utmp(covarX,1e-9);
-    covarX_Utmp.Decompose();
-    G4cout << "Decomposed upper-tridiagonal matrix for Y (to be transposed):" << G4endl;
-    covarX_Utmp.Print();
-    covarX_L.ResizeTo(covarX);
-    covarX_L = covarX_Utmp.GetU();
-    // Get the lower-tridiagonal that is needed for the generation
-    covarX_L.Transpose(covarX_L);
-    //covarX_L.Print();
-
-    TDecompChol covarY_Utmp(covarY,1e-9);
-    covarY_Utmp.Decompose();
-    G4cout << "Decomposed upper-tridiagonal matrix for Y (to be transposed):" << G4endl;
-    covarY_Utmp.Print();
-    covarY_L.ResizeTo(covarY);
-    covarY_L = covarY_Utmp.GetU();
-    covarY_L.Transpose(covarY_L);
+    // The sampler does the cholesky decomposition
+    TMatrixD covar4D(4,4);
+    covar4D.SetSub(0,0,covarX);
+    covar4D.SetSub(2,2,covarY);
+    sampler->SetCovariance(covar4D);
+
+    G4cout << G4endl;
+}
+
+void PrimaryGeneratorAction::setupCovarianceMatrix() {
+    // Parse the upper triangle of a 4x4 (10 numbers) or 6x6 (21 numbers) covariance matrix,
+    // coordinates (x[m], x'[rad], y[m], y'[rad], (z[m], dE/E))
+
+    G4cout << G4endl;
+    G4cout << "Initializing full covariance matrix..." << G4endl;
+
+    std::vector<G4double> elements;
+    str_size startPos = 0;
+    while (startPos < covarMatrixString.length()) {
+        str_size endPos = covarMatrixString.index(",",startPos);
+        if (endPos == std::string::npos) {
+            endPos = covarMatrixString.length();
+        }
+        try {
+            elements.push_back(std::stod(std::string(covarMatrixString(startPos,endPos-startPos))));
+        }
+        catch (const std::invalid_argument& ia) {
+            G4cerr << "Invalid float in covariance matrix '" << covarMatrixString << "'" << G4endl;
+            exit(1);
+        }
+        startPos = endPos+1;
+    }
+
+    G4int dim = 0;
+    if (elements.size() == 10) {
+        dim = 4;
+    }
+    else if (elements.size() == 21) {
+        dim = 6;
+    }
+    else {
+        G4cerr << "Error in PrimaryGeneratorAction::setupCovarianceMatrix():" << G4endl
+               << " Expected 10 (4D) or 21 (6D) elements, got " << elements.size() << G4endl;
+        exit(1);
+    }
+    if (dim == 6 and beam_energy_min >= 0.0 and beam_energy_max > 0.0) {
+        G4cerr << "Error in PrimaryGeneratorAction::setupCovarianceMatrix():" << G4endl
+               << " A 6D covariance matrix includes the energy spread, "
+               << "and can not be combined with a flat energy distribution." << G4endl;
+        exit(1);
+    }
+
+    TMatrixD covar(dim,dim);
+    size_t idx = 0;
+    for (G4int i = 0; i < dim; i++) {
+        for (G4int j = i; j < dim; j++) {
+            covar[i][j] = elements[idx];
+            covar[j][i] = elements[idx];
+            idx++;
+        }
+    }
+
+    G4cout << "Covariance matrix [m, rad" << (dim==6 ? ", m, 1" : "") << "]:" << G4endl;
+    covar.Print();
+
+    G4double gamma_rel = beam_energy*MeV/particle->GetPDGMass();
+    beta_rel_0 = sqrt(gamma_rel*gamma_rel - 1.0) / gamma_rel;
+
+    sampler->SetCovariance(covar);
 
     G4cout << G4endl;
 }
@@ -260,52 +401,68 @@ void PrimaryGeneratorAction::GeneratePrimaries(G4Event* anEvent) {
         G4cout << "Distance to target   = " << (-beam_zpos - Detector->getTargetThickness()/2.0)/mm << "[mm]" << G4endl;
         G4cout << G4endl;
 
+        if (covarianceString != "" or covarMatrixString != "" or
+            Rcut != 0.0 or (beam_energy_min >= 0.0 and beam_energy_max > 0.0) or
+            (beamFileReader != NULL and beamFileReader->GetResample()) or not beamHists.empty()) {
+            sampler = new BeamSampler(rngSeed);
+        }
         if (covarianceString != "") {
             hasCovariance = true;
             setupCovariance();
         }
-        if (covarianceString != "" or Rcut != 0.0 or (beam_energy_min >= 0.0 and beam_energy_max > 0.0)) {
-            RNG = new TRandom1((UInt_t) rngSeed);
+        else if (covarMatrixString != "") {
+            hasCovariance = true;
+            setupCovarianceMatrix();
+        }
+        if (hasCovariance and Rcut != 0.0) {
+            // Sample directly inside the cut, which is centered on x=y=0 (not on the beam offset)
+            sampler->SetRadialCut(Rcut*mm/m, beam_offset*mm/m, 0.0);
+        }
+    }
+
+    generatedPrimaries.clear();
+    if (phaseSpaceReader != NULL) {
+        GeneratePhaseSpacePrimaries(anEvent);
+        generatedPrimaries.push_back({x,xp,y,yp,E,weight});
+        return;
+    }
+
+    // The last event of the run only gets the remaining primaries
+    G4int numPrimaries = primariesPerEvent;
+    const G4int numPrimariesLeft = numPrimariesTotal - anEvent->GetEventID()*primariesPerEvent;
+    if (numPrimariesTotal > 0 and numPrimariesLeft > 0 and numPrimariesLeft < primariesPerEvent) {
+        numPrimaries = numPrimariesLeft;
+    }
+    for (G4int i = 0; i < numPrimaries; i++) {
+        if (beamFileReader != NULL) {
+            GenerateBeamFilePrimary(anEvent);
+        }
+        else {
+            GenerateBeamPrimary(anEvent);
         }
+        generatedPrimaries.push_back({x,xp,y,yp,E,weight});
     }
+}
 
+void PrimaryGeneratorAction::GenerateBeamPrimary(G4Event* anEvent) {
+    // One particle from the generated beam distribution
+    G4double dz     = 0.0; // Longitudinal offset from the 6D covariance [G4 units]
+    G4double dE_rel = 0.0; // Relative energy offset from the 6D covariance
     if (hasCovariance) {
-        int loopCounter = 0;
-        while(true) {
-            G4double xn  = RNG->Gaus(0,1);
-            G4double xpn = RNG->Gaus(0,1);;
-            x  = (xn*covarX_L[0][0] + xpn*covarX_L[0][1])*m + beam_offset*mm;
-            xp = (xn*covarX_L[1][0] + xpn*covarX_L[1][1])*rad;
-
-            G4double yn  = RNG->Gaus(0,1);
-            G4double ypn = RNG->Gaus(0,1);
-            y  = (yn*covarY_L[0][0] + ypn*covarY_L[0][1])*m;
-            yp = (yn*covarY_L[1][0] + ypn*covarY_L[1][1])*rad;
-
-            if (Rcut == 0.0) break;
-            else {
-                G4double init_r = sqrt(x*x + y*y)/mm;
-                if (init_r <= Rcut) break;
-
-                // No hit; do the anti-hang check.
-                loopCounter++;
-                if (loopCounter == 10000) {
-                    G4cerr << "Warning in PrimaryGeneratorAction::GeneratePrimaries():" << G4endl
-                           << " Number of iterations for the Rcut = " << Rcut/mm << " [mm]"
-                           << " has reached 10k." << G4endl;
-                }
-                else if (loopCounter > 1000000) {
-                    G4cerr << "Error in PrimaryGeneratorAction::GeneratePrimaries():" << G4endl
-                           << " Number of iterations for the Rcut = " << Rcut/mm << " [mm]"
-                           << " has reached 1M. Aborting." << G4endl;
-                    exit(1);
-                }
-            }
+        // With Rcut, the sampler only returns particles with sqrt(x^2+y^2) <= Rcut
+        const G4double* sample = sampler->NextGaussian();
+        x  = sample[0]*m + beam_offset*mm;
+        xp = sample[1]*rad;
+        y  = sample[2]*m;
+        yp = sample[3]*rad;
+        if (sampler->GetDim() == 6) {
+            dz     = sample[4]*m;
+            dE_rel = sample[5];
         }
     }
     else if (Rcut != 0.0) {
-        G4double r = RNG->Uniform();
-        G4double t = RNG->Uniform(2*M_PI);
+        G4double r = sampler->Uniform();
+        G4double t = sampler->Uniform()*2*M_PI;
         x = sqrt(r)*cos(t)*Rcut*mm;
         y = sqrt(r)*sin(t)*Rcut*mm;
 
@@ -319,6 +476,16 @@ void PrimaryGeneratorAction::GeneratePrimaries(G4Event* anEvent) {
         yp = 0.0;
     }
 
+    for (auto beamHist : beamHists) {
+        G4double a, b;
+        beamHist->Sample(sampler->Uniform(), sampler->Uniform(), sampler->Uniform(), sampler->Uniform(), a, b);
+        // Units of the histogram axes: [mm] for positions, [rad] for angles
+        G4double* coords[4]  = {&x, &xp, &y, &yp};
+        const G4double units[4] = {mm, rad, mm, rad};
+        *coords[beamHist->GetCoordA()] = a*units[beamHist->GetCoordA()];
+        *coords[beamHist->GetCoordB()] = b*units[beamHist->GetCoordB()];
+    }
+
     if (doBacktrack) {
         //Bactrack from 0.0 to beam_zpos (<0.0)
         x -= (xp/rad)*(0.0 - beam_zpos);
@@ -330,13 +497,89 @@ void PrimaryGeneratorAction::GeneratePrimaries(G4Event* anEvent) {
     //Technically not completely accurate but close enough for now
     particleGun->SetParticleMomentumDirection(G4ThreeVector(xp,yp,1));
 
+    // A particle ahead of the reference particle (dz > 0) starts earlier
+    particleGun->SetParticleTime(-dz/(beta_rel_0*c_light));
+
     if (beam_energy_min >= 0.0 and beam_energy_max > 0.0) {
-        E = beam_energy_min+RNG->Uniform()*(beam_energy_max-beam_energy_min);
+        E = beam_energy_min+sampler->Uniform()*(beam_energy_max-beam_energy_min);
         E *= MeV;
     }
     else {
-        E = beam_energy*MeV;
+        E = beam_energy*MeV*(1.0+dE_rel);
     }
     particleGun->SetParticleEnergy(E);
     particleGun->GeneratePrimaryVertex(anEvent);
 }
+
+void PrimaryGeneratorAction::GeneratePhaseSpacePrimaries(G4Event* anEvent) {
+    // All the particles that exited the target in one event of the target stage
+    phaseSpaceReader->ReadEvent(phaseSpaceEvent);
+
+    G4ParticleTable* particleTable = G4ParticleTable::GetParticleTable();
+    G4IonTable* ionTable = G4IonTable::GetIonTable();
+
+    for (auto& record : phaseSpaceEvent) {
+        G4ParticleDefinition* recordParticle = particleTable->FindParticle(record.PDG);
+        if (recordParticle == NULL) {
+            recordParticle = ionTable->GetIon(record.PDG);
+        }
+        if (recordParticle == NULL) {
+            G4cerr << "Error in PrimaryGeneratorAction::GeneratePhaseSpacePrimaries():" << G4endl
+                   << " Particle with PDG = " << record.PDG << " not found" << G4endl;
+            exit(1);
+        }
+
+        G4PrimaryVertex* vertex = new G4PrimaryVertex(G4ThreeVector(record.x*mm, record.y*mm, record.z*mm), 0.0);
+        G4PrimaryParticle* primary = new G4PrimaryParticle(recordParticle);
+        primary->SetKineticEnergy(record.E*MeV);
+        primary->SetMomentumDirection(G4ThreeVector(record.px, record.py, record.pz).unit());
+        primary->SetWeight(record.weight);
+        vertex->SetPrimary(primary);
+        anEvent->AddPrimaryVertex(vertex);
+    }
+
+    // The first particle is normally the (scattered) beam particle
+    const phaseSpaceRecord& first = phaseSpaceEvent.front();
+    x  = first.x*mm;
+    y  = first.y*mm;
+    xp = (first.px/first.pz)*rad;
+    yp = (first.py/first.pz)*rad;
+    E  = first.E*MeV;
+}
+
+void PrimaryGeneratorAction::GenerateBeamFilePrimary(G4Event* anEvent) {
+    // One particle from the beam file, injected at beam_zpos like a generated beam
+    const beamFileRecord& record = beamFileReader->GetResample() ?
+        beamFileReader->ReadRandom(sampler->Uniform()) : beamFileReader->ReadNext();
+
+    G4ParticleDefinition* recordParticle = G4ParticleTable::GetParticleTable()->FindParticle(record.PDG);
+    if (recordParticle == NULL) {
+        recordParticle = G4IonTable::GetIonTable()->GetIon(record.PDG);
+    }
+    if (recordParticle == NULL) {
+        G4cerr << "Error in PrimaryGeneratorAction::GenerateBeamFilePrimary():" << G4endl
+               << " Particle with PDG = " << record.PDG << " not found" << G4endl;
+        exit(1);
+    }
+
+    x  = record.x*mm;
+    xp = record.xp*rad;
+    y  = record.y*mm;
+    yp = record.yp*rad;
+    E  = record.E*MeV;
+    weight = record.weight;
+
+    if (doBacktrack) {
+        //Bactrack from 0.0 to beam_zpos (<0.0)
+        x -= (xp/rad)*(0.0 - beam_zpos);
+        y -= (yp/rad)*(0.0 - beam_zpos);
+    }
+
+    G4PrimaryVertex* vertex = new G4PrimaryVertex(G4ThreeVector(x,y,beam_zpos), 0.0);
+    G4PrimaryParticle* primary = new G4PrimaryParticle(recordParticle);
+    primary->SetKineticEnergy(E);
+    primary->SetMomentumDirection(G4ThreeVector(xp/rad,yp/rad,1).unit());
+    primary->SetWeight(weight);
+    vertex->SetPrimary(primary);
+    anEvent->AddPrimaryVertex(vertex);
+}
@@ -0,0 +1,236 @@
+/*
+ * This file is part of MiniScatter.
+ *
+ *  MiniScatter is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  MiniScatter is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with MiniScatter.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "RegionDefinition.hh"
+
+#include "DetectorConstruction.hh"
+#include "MagnetClasses.hh"
+
+#include "G4Region.hh"
+#include "G4RegionStore.hh"
+#include "G4ProductionCuts.hh"
+#include "G4ProductionCutsTable.hh"
+#include "G4UserLimits.hh"
+#include "G4EmParameters.hh"
+#include "G4VModularPhysicsList.hh"
+#include "G4SystemOfUnits.hh"
+
+#include <map>
+#include <string>
+
+//--------------------------------------------------------------------------------
+
+RegionDefinition::RegionDefinition(G4String inputString) {
+    //Split by ':'
+    std::vector<G4String> argList;
+    str_size startPos = 0;
+    str_size endPos = 0;
+    do {
+        endPos   = inputString.index(":",startPos);
+        argList.push_back(inputString(startPos,endPos-startPos));
+        startPos = endPos+1;
+    } while (endPos != std::string::npos);
+
+    regionName = argList[0];
+    if (regionName == "") {
+        G4cerr << "Error when parsing region input string '" << inputString << "'" << G4endl;
+        G4cerr << "Expected at least a name, as in 'name(:key=val:key=val...)'." << G4endl;
+        exit(1);
+    }
+
+    for (size_t i = 1; i < argList.size(); i++) {
+        str_size eqPos = argList[i].index("=",0);
+        if (eqPos == std::string::npos) {
+            G4cerr << "Error when parsing key=val pair '" << argList[i] << "', no '=' found!" << G4endl;
+            exit(1);
+        }
+        G4String k = argList[i](0,eqPos);
+        G4String v = argList[i](eqPos+1,std::string::npos);
+
+        if (k == "cut" or k == "maxStep") {
+            G4double val = 0.0;
+            try {
+                val = std::stod(std::string(v)) * mm;
+            }
+            catch (const std::invalid_argument& ia) {
+                G4cerr << "Invalid argument when reading region " << k << G4endl
+                       << "Got: '" << v << "'" << G4endl
+                       << "Expected a floating point number! (exponential notation is accepted)" << G4endl;
+                exit(1);
+            }
+            if (val <= 0.0) {
+                G4cerr << "Error in RegionDefinition: " << k << " must be > 0" << G4endl;
+                exit(1);
+            }
+            if (k == "cut") {
+                cut = val;
+            }
+            else {
+                maxStep = val;
+            }
+        }
+        else if (k == "em") {
+            // Names understood by G4EmModelActivator
+            if (not (v == "G4EmStandard"      or v == "G4EmStandard_opt1" or
+                     v == "G4EmStandard_opt2" or v == "G4EmStandard_opt3" or
+                     v == "G4EmStandard_opt4" or v == "G4EmStandardGS"    or
+                     v == "G4EmStandardSS"    or v == "G4EmStandardWVI"   or
+                     v == "G4EmLivermore"     or v == "G4EmPenelope") ) {
+                G4cerr << "Error in RegionDefinition: Unknown em option '" << v << "'" << G4endl;
+                exit(1);
+            }
+            emPhysics = v;
+        }
+        else if (k == "inactivate") {
+            // Comma-separated list of process names
+            str_size pStart = 0;
+            str_size pEnd   = 0;
+            do {
+                pEnd = v.index(",",pStart);
+                G4String procName = v(pStart,pEnd-pStart);
+                if (procName == "Transportation" or procName == "CoupledTransportation") {
+                    G4cerr << "Error in RegionDefinition: Cannot inactivate '" << procName << "'" << G4endl;
+                    exit(1);
+                }
+                if (procName != "") {
+                    inactivate.push_back(procName);
+                }
+                pStart = pEnd+1;
+            } while (pEnd != std::string::npos);
+        }
+        else {
+            G4cerr << "Error in RegionDefinition: Unknown key '" << k << "' "
+                   << "(value = '" << v << "')" << G4endl;
+            exit(1);
+        }
+    }
+
+    if (regionName == "world" and emPhysics != "") {
+        G4cerr << "Error in RegionDefinition: The em option cannot be set for the world region, "
+               << "use -p to choose the physics list instead." << G4endl;
+        exit(1);
+    }
+}
+
+//--------------------------------------------------------------------------------
+
+G4String RegionDefinition::GetG4RegionName() const {
+    if (regionName == "world") {
+        return "DefaultRegionForTheWorld";
+    }
+    return regionName + "_region";
+}
+
+G4Region* RegionDefinition::GetRegion() const {
+    if (theRegion == NULL) {
+        G4cerr << "Error in RegionDefinition::GetRegion(): Region '" << regionName
+               << "' has not been constructed!" << G4endl;
+        exit(1);
+    }
+    return theRegion;
+}
+
+//--------------------------------------------------------------------------------
+
+void RegionDefinition::ConfigurePhysics(G4VModularPhysicsList* physlist) {
+    if (regionName == "world") {
+        if (cut > 0.0) {
+            // Regions without their own cuts share the default ones
+            physlist->SetDefaultCutValue(cut);
+        }
+    }
+    if (emPhysics != "") {
+        G4EmParameters::Instance()->AddPhysics(GetG4RegionName(), emPhysics);
+    }
+}
+
+//--------------------------------------------------------------------------------
+
+void RegionDefinition::Construct(DetectorConstruction* detCon) {
+    if (regionName == "world") {
+        theRegion = G4RegionStore::GetInstance()->GetRegion("DefaultRegionForTheWorld");
+    }
+    else {
+        G4LogicalVolume* rootLV = NULL;
+        if (regionName == "target") {
+            if (not detCon->GetHasTarget()) {
+                G4cerr << "Error in RegionDefinition::Construct(): "
+                       << "Region 'target' requested, but there is no target." << G4endl;
+                exit(1);
+            }
+            rootLV = detCon->getTargetLV();
+        }
+        else {
+            for (auto mag : detCon->magnets) {
+                if (mag->magnetName == regionName) {
+                    rootLV = mag->GetMainLV();
+                    break;
+                }
+            }
+        }
+        if (rootLV == NULL) {
+            G4cerr << "Error in RegionDefinition::Construct(): Unknown region '" << regionName << "'; "
+                   << "expected 'world', 'target', or the name of an object (e.g. 'magnet_1')." << G4endl;
+            exit(1);
+        }
+        if (G4RegionStore::GetInstance()->GetRegion(GetG4RegionName(),false) != NULL) {
+            G4cerr << "Error in RegionDefinition::Construct(): Region '" << regionName
+                   << "' defined twice." << G4endl;
+            exit(1);
+        }
+
+        theRegion = new G4Region(GetG4RegionName());
+        theRegion->AddRootLogicalVolume(rootLV);
+
+        if (cut > 0.0) {
+            G4ProductionCuts* cuts = new G4ProductionCuts();
+            cuts->SetProductionCut(cut);
+            theRegion->SetProductionCuts(cuts);
+        }
+        else {
+            // Shared with the world, so that it follows SetDefaultCutValue()
+            theRegion->SetProductionCuts(G4ProductionCutsTable::GetProductionCutsTable()->GetDefaultProductionCuts());
+        }
+    }
+
+    if (maxStep > 0.0) {
+        theRegion->SetUserLimits(new G4UserLimits(maxStep));
+    }
+
+    Print();
+}
+
+//--------------------------------------------------------------------------------
+
+void RegionDefinition::Print() {
+    G4cout << "Initialized a region, parameters:" << G4endl;
+    G4cout << "\t regionName              = " << regionName << " ('" << GetG4RegionName() << "')" << G4endl;
+    G4cout << "\t cut                     = ";
+    if (cut > 0.0) G4cout << cut/mm << " [mm]" << G4endl;
+    else           G4cout << "default"         << G4endl;
+    G4cout << "\t em                      = " << (emPhysics == "" ? "default" : emPhysics) << G4endl;
+    G4cout << "\t maxStep                 = ";
+    if (maxStep > 0.0) G4cout << maxStep/mm << " [mm]" << G4endl;
+    else               G4cout << "none"                << G4endl;
+    G4cout << "\t inactivate              = ";
+    for (auto p : inactivate) {
+        G4cout << p << " ";
+    }
+    G4cout << G4endl;
+}
+
+//--------------------------------------------------------------------------------
@@ -0,0 +1,149 @@
+/*
+ * This file is part of MiniScatter.
+ *
+ *  MiniScatter is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  MiniScatter is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with MiniScatter.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "RegionPhysics.hh"
+#include "RegionDefinition.hh"
+
+#include "G4Region.hh"
+#include "G4ProcessManager.hh"
+#include "G4ProcessVector.hh"
+#include "G4ParticleDefinition.hh"
+#include "G4Track.hh"
+
+#include <map>
+
+//--------------------------------------------------------------------------------
+
+RegionInactivatedProcess::RegionInactivatedProcess(G4VProcess* process_in,
+                                                   std::vector<const G4Region*> &inactiveRegions_in) :
+    G4WrapperProcess(process_in->GetProcessName(), process_in->GetProcessType()),
+    inactiveRegions(inactiveRegions_in) {
+    RegisterProcess(process_in);
+    SetProcessSubType(process_in->GetProcessSubType());
+}
+
+void RegionInactivatedProcess::StartTracking(G4Track* track) {
+    // The process instance is shared by all tracks of the particle type,
+    // so the state belongs to the track currently being tracked.
+    lastStepInactive = false;
+    G4WrapperProcess::StartTracking(track);
+}
+
+G4double RegionInactivatedProcess::PostStepGetPhysicalInteractionLength(const G4Track& track,
+                                                                        G4double previousStepSize,
+                                                                        G4ForceCondition* condition) {
+    if (IsInactive(track)) {
+        if (not lastStepInactive) {
+            // Entering the region: Charge the last step taken with the process active
+            // to the number of interaction lengths left, before it is frozen.
+            pRegProcess->PostStepGetPhysicalInteractionLength(track, previousStepSize, condition);
+            lastStepInactive = true;
+        }
+        *condition = NotForced;
+        return DBL_MAX;
+    }
+    if (lastStepInactive) {
+        // Leaving the region: The last step was taken with the process switched off.
+        previousStepSize = 0.0;
+        lastStepInactive = false;
+    }
+    return pRegProcess->PostStepGetPhysicalInteractionLength(track, previousStepSize, condition);
+}
+
+G4double RegionInactivatedProcess::AlongStepGetPhysicalInteractionLength(const G4Track& track,
+                                                                         G4double previousStepSize,
+                                                                         G4double currentMinimumStep,
+                                                                         G4double& proposedSafety,
+                                                                         G4GPILSelection* selection) {
+    if (IsInactive(track)) {
+        *selection = NotCandidateForSelection;
+        return DBL_MAX;
+    }
+    return pRegProcess->AlongStepGetPhysicalInteractionLength(track, previousStepSize, currentMinimumStep,
+                                                              proposedSafety, selection);
+}
+
+G4VParticleChange* RegionInactivatedProcess::AlongStepDoIt(const G4Track& track, const G4Step& step) {
+    if (IsInactive(track)) {
+        aParticleChange.Initialize(track);
+        return &aParticleChange;
+    }
+    return pRegProcess->AlongStepDoIt(track, step);
+}
+
+//--------------------------------------------------------------------------------
+
+RegionPhysics::RegionPhysics(std::vector<RegionDefinition*> &regions_in) :
+    G4VPhysicsConstructor("RegionPhysics"),
+    regions(regions_in) { }
+
+void RegionPhysics::ConstructProcess() {
+    // The geometry is constructed before the physics, so the G4Regions exist at this point.
+    // Collect the regions where each process should be switched off.
+    std::map<G4String, std::vector<const G4Region*> > inactiveRegions;
+    for (auto reg : regions) {
+        for (auto procName : reg->GetInactivate()) {
+            inactiveRegions[procName].push_back(reg->GetRegion());
+        }
+    }
+    if (inactiveRegions.empty()) {
+        return;
+    }
+
+    std::map<G4String, G4int> numWrapped;
+    auto myParticleIterator = GetParticleIterator();
+    myParticleIterator->reset();
+    while( (*myParticleIterator)() ) {
+        G4ParticleDefinition* particle = myParticleIterator->value();
+        G4ProcessManager* pmanager = particle->GetProcessManager();
+        if (pmanager == NULL) continue;
+
+        // Copy the list, since it is modified in the loop
+        std::vector<G4VProcess*> processes;
+        G4ProcessVector* pvec = pmanager->GetProcessList();
+        for (G4int i = 0; i < pvec->size(); i++) {
+            processes.push_back((*pvec)[i]);
+        }
+
+        for (auto proc : processes) {
+            auto it = inactiveRegions.find(proc->GetProcessName());
+            if (it == inactiveRegions.end()) continue;
+            if (proc->GetProcessType() == fTransportation or proc->GetProcessType() == fParallel) continue;
+
+            G4int ordAtRest    = pmanager->GetProcessOrdering(proc, idxAtRest);
+            G4int ordAlongStep = pmanager->GetProcessOrdering(proc, idxAlongStep);
+            G4int ordPostStep  = pmanager->GetProcessOrdering(proc, idxPostStep);
+
+            pmanager->RemoveProcess(proc);
+            pmanager->AddProcess(new RegionInactivatedProcess(proc, it->second),
+                                 ordAtRest, ordAlongStep, ordPostStep);
+            numWrapped[it->first] += 1;
+        }
+    }
+
+    G4cout << "RegionPhysics: Inactivated processes:" << G4endl;
+    for (auto it : inactiveRegions) {
+        G4cout << "\t " << it.first << ": wrapped for " << numWrapped[it.first] << " particle types" << G4endl;
+        if (numWrapped[it.first] == 0) {
+            G4cerr << "Error in RegionPhysics::ConstructProcess(): Process '" << it.first
+                   << "' not found for any particle." << G4endl;
+            exit(1);
+        }
+    }
+}
+
+//--------------------------------------------------------------------------------
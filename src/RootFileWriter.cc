@@ -26,6 +26,7 @@
 
 #include "MyEdepHit.hh"
 #include "MyTrackerHit.hh"
+#include "MyTargetSD.hh"
 
 #include "G4SDManager.hh"
 
@@ -35,11 +36,14 @@
 #include "DetectorConstruction.hh"
 #include "MagnetClasses.hh"
 #include "PrimaryGeneratorAction.hh"
+#include "PhaseSpaceFile.hh"
 
 #include "G4SystemOfUnits.hh"
 
 #include <iostream>
 #include <iomanip>
+#include <cfloat>
+#include <algorithm>
 #ifdef MINISCATTER_CXXFILESYSTEM_OK
 #include <experimental/filesystem> //Mainstreamed from C++17,
                                    // but G4 doesn't like C++17.
@@ -105,16 +109,61 @@ void RootFileWriter::initializeRootFile(){
         if (detCon->GetHasTarget()) {
             targetExit = new TTree("TargetExit","TargetExit tree");
             targetExit->Branch("TargetExitBranch", &targetExitBuffer,
-                               "x/D:y:z:px:py:pz:E:PDG/I:charge:eventID");
+                               "x/D:y:z:px:py:pz:E:weight:PDG/I:charge:eventID");
         }
 
         trackerHits = new TTree("TrackerHits","TrackerHits tree");
         trackerHits->Branch("TrackerHitsBranch", &trackerHitsBuffer,
-                            "x/D:y:z:px:py:pz:E:PDG/I:charge:eventID");
+                            "x/D:y:z:px:py:pz:E:weight:PDG/I:charge:eventID");
 
         magnetEdeps = new TTree("magnetEdeps", "Magnet Edeps tree");
     }
 
+    // Drift projections from the exit of the most downstream target/object
+    driftBuffer.Clear();
+    driftTypeNames.clear();
+    if (not driftProjections.empty()) {
+        driftSourceMagIdx = -1;
+        driftSourceZ      = detCon->GetHasTarget() ? detCon->getTargetThickness()/2.0 : -DBL_MAX;
+        for (size_t magIdx = 0; magIdx < detCon->magnets.size(); magIdx++) {
+            MagnetBase* mag = detCon->magnets[magIdx];
+            if (mag->getZ0() + mag->GetLength()/2.0 > driftSourceZ) {
+                driftSourceMagIdx = magIdx;
+                driftSourceZ      = mag->getZ0() + mag->GetLength()/2.0;
+            }
+        }
+        for (auto zProj : driftProjections) {
+            if (zProj*mm < driftSourceZ) {
+                G4cerr << "Error: Drift projection to z = " << zProj << " [mm] is upstream of the "
+                       << (driftSourceMagIdx < 0 ? G4String("target") : detCon->magnets[driftSourceMagIdx]->magnetName)
+                       << " exit at z = " << driftSourceZ/mm << " [mm]." << G4endl;
+                exit(1);
+            }
+        }
+    }
+
+    // Events aborted by the event budget
+    eventBudgetAborted      = false;
+    eventBudgetKilledEnergy = 0.0;
+    numBudgetAbortedEvents  = 0;
+    if (eventBudget) {
+        budget_killed_energy = new TH1D("budget_killed_energy",
+                                        "Kinetic energy of the tracks killed by the event budget, per aborted event",
+                                        engNbins,0,beamEnergy);
+        budget_killed_energy->GetXaxis()->SetTitle("Killed kinetic energy/event [MeV]");
+    }
+
+    // Phase space file for running the downstream geometry separately
+    if (phaseSpaceOut != "") {
+        if (not detCon->GetHasTarget()) {
+            G4cerr << "Error: Writing a phase space file requires a target." << G4endl;
+            exit(1);
+        }
+        phaseSpaceWriter = new PhaseSpaceFileWriter(phaseSpaceOut);
+        phaseSpaceExitZ  = detCon->getTargetThickness()/2.0;
+        phaseSpaceAngle  = detCon->getTargetRotated() ? detCon->getTargetAngle() : 0.0;
+    }
+
     // Target energy deposition
     if (detCon->GetHasTarget()) {
         targetEdep = new TH1D("targetEdep","targetEdep",engNbins,0,beamEnergy);
@@ -151,6 +200,13 @@ void RootFileWriter::initializeRootFile(){
             target_edep_rdens = NULL;
         }
 
+        // Without the density maps, only the total energy deposit per event is needed
+        MyTargetSD* targetSD =
+            dynamic_cast<MyTargetSD*>(G4SDManager::GetSDMpointer()->FindSensitiveDetector("target", false));
+        if (targetSD != NULL) {
+            targetSD->SetAccumulateEdep(target_edep_dens == NULL);
+        }
+
         // Target tracking info
         target_exit_energy[11]  = new TH1D("target_exit_energy_PDG11",
                                         "Particle energy when exiting target (electrons)",
@@ -198,6 +254,17 @@ void RootFileWriter::initializeRootFile(){
                                                 "Exit angle from target (charged, energy > Ecut, r < Rcut)",
                                                 5001, -90, 90);
 
+        if (fastSimValidation) {
+            fastsim_validate_exitangle = new TH1D("fastsim_validate_exit_angle",
+                                                  "Exit angle from target (fast simulation model prediction)",
+                                                  5001, -90, 90);
+            fastsim_validate_exitangle->GetXaxis()->SetTitle("Angle [deg]");
+            fastsim_validate_energy    = new TH1D("fastsim_validate_exit_energy",
+                                                  "Particle energy when exiting target (fast simulation model prediction)",
+                                                  engNbins,0,beamEnergy);
+            fastsim_validate_energy->GetXaxis()->SetTitle("Energy [MeV]");
+        }
+
         // Target exit phasespace histograms
         target_exit_phasespaceX        = new TH2D("target_exit_x",
                                                 "Target exit phase space (x)",
@@ -228,84 +295,6 @@ void RootFileWriter::initializeRootFile(){
         target_exit_phasespaceY_cutoff->GetYaxis()->SetTitle("Angle dy/dz [rad]");
     }
 
-    // Tracker histograms
-    tracker_numParticles = new TH1D("numParticles","numParticles",1001,-0.5,1000.5);
-    tracker_numParticles->GetXaxis()->SetTitle("Number of particles / event");
-
-    tracker_energy       = new TH1D("energy","Energy of all particles hitting the tracker",10000,0,beamEnergy);
-    tracker_energy->GetXaxis()->SetTitle("Energy per particle [MeV]");
-
-    tracker_type_energy[11]  = new TH1D("tracker_energy_PDG11",
-                                      "Particle energy when hitting tracker (electrons)",
-                                      engNbins,0,beamEnergy);
-    tracker_type_energy[-11] = new TH1D("tracker_energy_PDG-11",
-                                      "Particle energy when hitting tracker (positrons)",
-                                      engNbins,0,beamEnergy);
-    tracker_type_energy[22]  = new TH1D("tracker_energy_PDG22",
-                                      "Particle energy when hitting tracker (photons)",
-                                      engNbins,0,beamEnergy);
-    tracker_type_energy[2212]= new TH1D("tracker_energy_PDG2212",
-                                      "Particle energy when hitting tracker (protons)",
-                                      engNbins,0,beamEnergy);
-    tracker_type_energy[0]   = new TH1D("tracker_energy_PDGother",
-                                      "Particle energy when hitting tracker (other)",
-                                      engNbins,0,beamEnergy);
-    for (auto it : tracker_type_energy) {
-        it.second->GetXaxis()->SetTitle("Energy [MeV]");
-    }
-
-    tracker_type_cutoff_energy[11]  = new TH1D("tracker_cutoff_energy_PDG11",
-                                              "Particle energy when hitting tracker (electrons) (r < Rcut)",
-                                              engNbins,0,beamEnergy);
-    tracker_type_cutoff_energy[-11] = new TH1D("tracker_cutoff_energy_PDG-11",
-                                              "Particle energy when hitting tracker (positrons) (r < Rcut)",
-                                              engNbins,0,beamEnergy);
-    tracker_type_cutoff_energy[22]  = new TH1D("tracker_cutoff_energy_PDG22",
-                                              "Particle energy when hitting tracker (photons) (r < Rcut)",
-                                              engNbins,0,beamEnergy);
-    tracker_type_cutoff_energy[2212]= new TH1D("tracker_cutoff_energy_PDG2212",
-                                              "Particle energy when hitting tracker (protons) (r < Rcut)",
-                                              engNbins,0,beamEnergy);
-    tracker_type_cutoff_energy[0]   = new TH1D("tracker_cutoff_energy_PDGother",
-                                              "Particle energy when hitting tracker (other) (r < Rcut)",
-                                              engNbins,0,beamEnergy);
-    for (auto it : tracker_type_cutoff_energy) {
-        it.second->GetXaxis()->SetTitle("Energy [MeV]");
-    }
-
-    tracker_hitPos        = new TH2D("trackerHitpos", "Tracker Hit position",
-               1000,-detCon->getDetectorSizeX()/2.0/mm,detCon->getDetectorSizeX()/2.0/mm,
-               1000,-detCon->getDetectorSizeY()/2.0/mm,detCon->getDetectorSizeY()/2.0/mm);
-    tracker_hitPos_cutoff = new TH2D("trackerHitpos_cutoff", "Tracker Hit position (charged, energy > Ecut)",
-               1000,-position_cutoffR, position_cutoffR,
-               1000,-position_cutoffR, position_cutoffR);
-
-    tracker_phasespaceX   =
-        new TH2D("tracker_x",
-                 "Tracker phase space (x)",
-                 1000, -phasespacehist_posLim/mm,phasespacehist_posLim/mm,
-                 1000, -phasespacehist_angLim/rad,phasespacehist_angLim/rad);
-    //tracker_phasespaceX->Sumw2();
-    tracker_phasespaceY   =
-        new TH2D("tracker_y",
-                 "Tracker phase space (y)",
-                 1000, -phasespacehist_posLim/mm,phasespacehist_posLim/mm,
-                 1000, -phasespacehist_angLim/rad,phasespacehist_angLim/rad);
-    //tracker_phasespaceY->Sumw2();
-
-    tracker_phasespaceX_cutoff   =
-        new TH2D("tracker_cutoff_x",
-                 "Tracker phase space (x) (charged, energy > Ecut, r < Rcut)",
-                 1000, -phasespacehist_posLim/mm,phasespacehist_posLim/mm,
-                 1000, -phasespacehist_angLim/rad,phasespacehist_angLim/rad);
-    //tracker_phasespaceX_cutoff->Sumw2();
-    tracker_phasespaceY_cutoff   =
-        new TH2D("tracker_cutoff_y",
-                 "Tracker phase space (y) (charged, energy > Ecut, r < Rcut)",
-                 1000, -phasespacehist_posLim/mm,phasespacehist_posLim/mm,
-                 1000, -phasespacehist_angLim/rad,phasespacehist_angLim/rad);
-    //tracker_phasespaceY_cutoff->Sumw2();
-
     init_phasespaceX   =
         new TH2D("init_x",
                  "Initial phase space (x)",
@@ -371,73 +360,54 @@ void RootFileWriter::initializeRootFile(){
         }
     }
 
-    // Tracker R position
-    tracker_Rpos[11]  = new TH1D("tracker_rpos_PDG11",
-                                 "tracker rpos (electrons)",
-                                 1000,0,minR);
-    tracker_Rpos[-11] = new TH1D("tracker_rpos_PDG-11",
-                                 "tracker rpos (positrons)",
-                                 1000,0,minR);
-    tracker_Rpos[22]  = new TH1D("tracker_rpos_PDG22",
-                                 "tracker rpos (photons)",
-                                 1000,0,minR);
-    tracker_Rpos[2212]= new TH1D("tracker_rpos_PDG2212",
-                                 "tracker rpos (protons)",
-                                 1000,0,minR);
-    tracker_Rpos[0]   = new TH1D("tracker_rpos_PDGother",
-                                 "tracker rpos (other)",
-                                 1000,0,minR);
-    for (auto hist : tracker_Rpos) {
-        hist.second->GetXaxis()->SetTitle("R [mm]");
+    // Tracker histograms
+    BookPlaneHistograms(trackerHists, "tracker", minR);
+    // The tracker histograms predate the scoring planes, and keep their original names
+    trackerHists.numParticles->SetNameTitle("numParticles", "numParticles");
+    trackerHists.energy->SetNameTitle("energy", "Energy of all particles hitting the tracker");
+    trackerHists.hitPos->SetNameTitle("trackerHitpos", "Tracker Hit position");
+    trackerHists.hitPos_cutoff->SetNameTitle("trackerHitpos_cutoff", "Tracker Hit position (charged, energy > Ecut)");
+    trackerHists.phasespaceX->SetTitle("Tracker phase space (x)");
+    trackerHists.phasespaceY->SetTitle("Tracker phase space (y)");
+    trackerHists.phasespaceX_cutoff->SetTitle("Tracker phase space (x) (charged, energy > Ecut, r < Rcut)");
+    trackerHists.phasespaceY_cutoff->SetTitle("Tracker phase space (y) (charged, energy > Ecut, r < Rcut)");
+
+    // Target depth plane histograms, same as for the tracker plus the angle
+    targetPlaneHists.clear();
+    for (size_t planeIdx = 0; planeIdx < detCon->GetTargetPlanes().size(); planeIdx++) {
+        targetPlaneHists.push_back(planeHistograms());
+        BookPlaneHistograms(targetPlaneHists.back(), DetectorConstruction::GetTargetPlaneName(planeIdx), minR, true);
     }
-    tracker_Rpos_cutoff[11]  = new TH1D("tracker_rpos_cutoff_PDG11",
-                                        "tracker rpos (electrons, energy > E_cut)",
-                                        1000,0,minR);
-    tracker_Rpos_cutoff[-11] = new TH1D("tracker_rpos_cutoff_PDG-11",
-                                        "tracker rpos (positrons, energy > E_cut)",
-                                        1000,0,minR);
-    tracker_Rpos_cutoff[22]  = new TH1D("tracker_rpos_cutoff_PDG22",
-                                        "tracker rpos (photons, energy > E_cut)",
-                                        1000,0,minR);
-    tracker_Rpos_cutoff[2212]= new TH1D("tracker_rpos_cutoff_PDG2212",
-                                        "tracker rpos (protons, energy > E_cut)",
-                                        1000,0,minR);
-    tracker_Rpos_cutoff[0]   = new TH1D("tracker_rpos_cutoff_PDGother",
-                                        "tracker rpos (other, energy > E_cut)",
-                                        1000,0,minR);
-    for (auto hist : tracker_Rpos_cutoff) {
-        hist.second->GetXaxis()->SetTitle("R [mm]");
+
+    // Scoring plane histograms, same as for the tracker
+    planeHists.clear();
+    for (size_t planeIdx = 0; planeIdx < detCon->GetScoringPlanes().size(); planeIdx++) {
+        planeHists.push_back(planeHistograms());
+        BookPlaneHistograms(planeHists.back(), DetectorConstruction::GetScoringPlaneName(planeIdx), minR);
     }
 
-    //For counting the types of particles hitting the detectors (for magnets it is defined elsewhere)
-    if (detCon->GetHasTarget()){
-        typeCounter["tracker"]       = particleTypesCounter();
-        typeCounter["tracker_cutoff"] = particleTypesCounter();
+    // Drift projection histograms, same as for the tracker
+    driftHists.clear();
+    driftLost.clear();
+    for (size_t projIdx = 0; projIdx < driftProjections.size(); projIdx++) {
+        driftHists.push_back(planeHistograms());
+        BookPlaneHistograms(driftHists.back(), "projection_" + std::to_string(projIdx+1), minR);
+        driftLost.push_back(0.0);
     }
+
+    //For counting the types of particles hitting the detectors
+    // (for the tracker and scoring planes it is done when booking, for magnets it is defined elsewhere)
     typeCounter["target"]        = particleTypesCounter();
     typeCounter["target_cutoff"] = particleTypesCounter();
 
-    //Compute means and RMS of where they hit
-    tracker_particleHit_x  = 0.0;
-    tracker_particleHit_xx = 0.0;
-    tracker_particleHit_y  = 0.0;
-    tracker_particleHit_yy = 0.0;
-
-    //Compute means and RMS of where they hit (above cutoff particles only)
-    tracker_particleHit_x_cutoff  = 0.0;
-    tracker_particleHit_xx_cutoff = 0.0;
-    tracker_particleHit_y_cutoff  = 0.0;
-    tracker_particleHit_yy_cutoff = 0.0;
-    numParticles_cutoff = 0;
-
     //Compute RMS of target exit angle
     if (detCon->GetHasTarget()) {
         target_exitangle              = 0.0;
         target_exitangle2             = 0.0;
-        target_exitangle_numparticles = 0;
+        target_exitangle_numparticles = 0.0;
         target_exitangle_cutoff              = 0.0;
         target_exitangle2_cutoff             = 0.0;
-        target_exitangle_cutoff_numparticles = 0;
+        target_exitangle_cutoff_numparticles = 0.0;
     }
 
     // Magnet histograms
@@ -587,7 +557,18 @@ void RootFileWriter::doEvent(const G4Event* event){
     DetectorConstruction*   detCon = (DetectorConstruction*)run->GetUserDetectorConstruction();
     PrimaryGeneratorAction* genAct = (PrimaryGeneratorAction*)run->GetUserPrimaryGeneratorAction();
 
-    eventCounter++;
+    // With several primaries per event, the per-event quantities are filled once per primary,
+    // and the primaries get the eventIDs firstEventID, firstEventID+1, ...
+    const G4int numPrimaries = genAct->generatedPrimaries.size();
+    const G4int firstEventID = eventCounter + 1;
+    eventCounter += numPrimaries;
+
+    if (eventBudgetAborted) {
+        budget_killed_energy->Fill(eventBudgetKilledEnergy/MeV);
+        numBudgetAbortedEvents++;
+        eventBudgetAborted      = false;
+        eventBudgetKilledEnergy = 0.0;
+    }
 
     G4HCofThisEvent* HCE=event->GetHCofThisEvent();
     G4SDManager* SDman = G4SDManager::GetSDMpointer();
@@ -600,15 +581,17 @@ void RootFileWriter::doEvent(const G4Event* event){
             targetEdepHitsCollection = (MyEdepHitsCollection*) (HCE->GetHC(myTargetEdep_CollID));
             if (targetEdepHitsCollection != NULL) {
                 G4int nEntries = targetEdepHitsCollection->entries();
-                G4double edep      = 0.0; // G4 units, normalized before Fill()
-                G4double edep_NIEL = 0.0; // G4 units, normalized before Fill()
-                G4double edep_IEL  = 0.0; // G4 units, normalized before Fill()
+                std::vector<G4double> edep     (numPrimaries, 0.0); // G4 units, normalized before Fill()
+                std::vector<G4double> edep_NIEL(numPrimaries, 0.0); // G4 units, normalized before Fill()
+                std::vector<G4double> edep_IEL (numPrimaries, 0.0); // G4 units, normalized before Fill()
                 for (G4int i = 0; i < nEntries; i++){
                     MyEdepHit* edepHit = (*targetEdepHitsCollection)[i];
+                    const G4double weight = edepHit->GetWeight();
+                    const G4int primaryIdx = edepHit->GetPrimaryIdx();
 
-                    edep      += edepHit->GetDepositedEnergy();
-                    edep_NIEL += edepHit->GetDepositedEnergy_NIEL();
-                    edep_IEL  += edepHit->GetDepositedEnergy() - edepHit->GetDepositedEnergy_NIEL();
+                    edep[primaryIdx]      += edepHit->GetDepositedEnergy() * weight;
+                    edep_NIEL[primaryIdx] += edepHit->GetDepositedEnergy_NIEL() * weight;
+                    edep_IEL[primaryIdx]  += (edepHit->GetDepositedEnergy() - edepHit->GetDepositedEnergy_NIEL()) * weight;
 
                     //Randomly spread the energy deposits over the step
                     if (target_edep_dens != NULL) {
@@ -621,17 +604,19 @@ void RootFileWriter::doEvent(const G4Event* event){
                             target_edep_dens->Fill(posSample.x()/mm,
                                                 posSample.y()/mm,
                                                 sample_z/mm,
-                                                edepHit->GetDepositedEnergy()/numSamples/MeV);
+                                                edepHit->GetDepositedEnergy()/numSamples/MeV * weight);
 
                             G4double sample_r = sqrt(posSample.x()*posSample.x() + posSample.y()*posSample.y());
-                            target_edep_rdens->Fill(sample_z/mm, sample_r/mm, edepHit->GetDepositedEnergy()/numSamples/MeV);
+                            target_edep_rdens->Fill(sample_z/mm, sample_r/mm, edepHit->GetDepositedEnergy()/numSamples/MeV * weight);
                         }
                     }
                 }
 
-                targetEdep->Fill(edep/MeV);
-                targetEdep_NIEL->Fill(edep_NIEL/keV);
-                targetEdep_IEL->Fill(edep_IEL/MeV);
+                for (G4int primaryIdx = 0; primaryIdx < numPrimaries; primaryIdx++) {
+                    targetEdep->Fill(edep[primaryIdx]/MeV);
+                    targetEdep_NIEL->Fill(edep_NIEL[primaryIdx]/keV);
+                    targetEdep_IEL->Fill(edep_IEL[primaryIdx]/MeV);
+                }
             }
             else {
                 G4cout << "targetEdepHitsCollection was NULL!"<<G4endl;
@@ -647,6 +632,7 @@ void RootFileWriter::doEvent(const G4Event* event){
             targetExitposHitsCollection = (MyTrackerHitsCollection*) (HCE->GetHC(myTargetExitpos_CollID));
             if (targetExitposHitsCollection != NULL) {
                 G4int nEntries = targetExitposHitsCollection->entries();
+                std::vector<phaseSpaceRecord> phaseSpaceRecords;
 
                 for (G4int i = 0; i < nEntries; i++) {
                     //Get the data from the event
@@ -658,68 +644,70 @@ void RootFileWriter::doEvent(const G4Event* event){
                     const G4double       hitR        = sqrt(hitPos.x()*hitPos.x() + hitPos.y()*hitPos.y());
                     const G4int          PDG         = (*targetExitposHitsCollection)[i]->GetPDG();
                     const G4String&      type        = (*targetExitposHitsCollection)[i]->GetType();
+                    const G4double       weight      = (*targetExitposHitsCollection)[i]->GetWeight();
+                    const G4int          primaryIdx  = (*targetExitposHitsCollection)[i]->GetPrimaryIdx();
 
                     //Particle type counting
-                    FillParticleTypes(typeCounter["target"], PDG, type);
+                    FillParticleTypes(typeCounter["target"], PDG, type, weight);
                     if (energy/MeV > beamEnergy*beamEnergy_cutoff and hitR/mm < position_cutoffR) {
-                        FillParticleTypes(typeCounter["target_cutoff"], PDG, type);
+                        FillParticleTypes(typeCounter["target_cutoff"], PDG, type, weight);
                     }
 
                     //Exit angle
-                    target_exitangle_hist->Fill(exitangle);
+                    target_exitangle_hist->Fill(exitangle, weight);
                     if (charge != 0 and energy/MeV > beamEnergy*beamEnergy_cutoff and hitR/mm < position_cutoffR) {
-                        target_exitangle_hist_cutoff->Fill(exitangle);
+                        target_exitangle_hist_cutoff->Fill(exitangle, weight);
                     }
 
-                    target_exitangle              += exitangle;
-                    target_exitangle2             += exitangle*exitangle;
-                    target_exitangle_numparticles += 1;
+                    target_exitangle              += exitangle*weight;
+                    target_exitangle2             += exitangle*exitangle*weight;
+                    target_exitangle_numparticles += weight;
 
                     if (charge != 0 and energy/MeV > beamEnergy*beamEnergy_cutoff  and hitR/mm < position_cutoffR) {
-                        target_exitangle_cutoff              += exitangle;
-                        target_exitangle2_cutoff             += exitangle*exitangle;
-                        target_exitangle_cutoff_numparticles += 1;
+                        target_exitangle_cutoff              += exitangle*weight;
+                        target_exitangle2_cutoff             += exitangle*exitangle*weight;
+                        target_exitangle_cutoff_numparticles += weight;
                     }
 
                     //Phase space
-                    target_exit_phasespaceX->Fill(hitPos.x()/mm, momentum.x()/momentum.z());
-                    target_exit_phasespaceY->Fill(hitPos.y()/mm, momentum.y()/momentum.z());
+                    target_exit_phasespaceX->Fill(hitPos.x()/mm, momentum.x()/momentum.z(), weight);
+                    target_exit_phasespaceY->Fill(hitPos.y()/mm, momentum.y()/momentum.z(), weight);
 
                     if (charge != 0 and energy/MeV > beamEnergy*beamEnergy_cutoff and hitR/mm < position_cutoffR) {
-                        target_exit_phasespaceX_cutoff->Fill(hitPos.x()/mm, momentum.x()/momentum.z());
-                        target_exit_phasespaceY_cutoff->Fill(hitPos.y()/mm, momentum.y()/momentum.z());
+                        target_exit_phasespaceX_cutoff->Fill(hitPos.x()/mm, momentum.x()/momentum.z(), weight);
+                        target_exit_phasespaceY_cutoff->Fill(hitPos.y()/mm, momentum.y()/momentum.z(), weight);
                     }
 
                     //Energy
                     if (target_exit_energy.find(PDG) != target_exit_energy.end()) {
-                        target_exit_energy[PDG]->Fill(energy/MeV);
+                        target_exit_energy[PDG]->Fill(energy/MeV, weight);
                     }
                     else {
-                        target_exit_energy[0]->Fill(energy/MeV);
+                        target_exit_energy[0]->Fill(energy/MeV, weight);
                     }
 
                     if (hitR/mm < position_cutoffR and energy/MeV > beamEnergy*beamEnergy_cutoff) {
                         if (target_exit_cutoff_energy.find(PDG) != target_exit_cutoff_energy.end()) {
-                            target_exit_cutoff_energy[PDG]->Fill(energy/MeV);
+                            target_exit_cutoff_energy[PDG]->Fill(energy/MeV, weight);
                         }
                         else {
-                            target_exit_cutoff_energy[0]->Fill(energy/MeV);
+                            target_exit_cutoff_energy[0]->Fill(energy/MeV, weight);
                         }
                     }
 
                     //R position
                     if (target_exit_Rpos.find(PDG) != target_exit_Rpos.end()) {
-                        target_exit_Rpos[PDG]->Fill(hitR/mm);
+                        target_exit_Rpos[PDG]->Fill(hitR/mm, weight);
                     }
                     else {
-                        target_exit_Rpos[0]->Fill(hitR/mm);
+                        target_exit_Rpos[0]->Fill(hitR/mm, weight);
                     }
                     if (energy/MeV > beamEnergy*beamEnergy_cutoff) {
                         if (target_exit_Rpos_cutoff.find(PDG) != target_exit_Rpos_cutoff.end()) {
-                            target_exit_Rpos_cutoff[PDG]->Fill(hitR/mm);
+                            target_exit_Rpos_cutoff[PDG]->Fill(hitR/mm, weight);
                         }
                         else {
-                            target_exit_Rpos_cutoff[0]->Fill(hitR/mm);
+                            target_exit_Rpos_cutoff[0]->Fill(hitR/mm, weight);
                         }
                     }
 
@@ -735,13 +723,51 @@ void RootFileWriter::doEvent(const G4Event* event){
 
                         targetExitBuffer.E = energy / MeV;
 
+                        targetExitBuffer.weight = weight;
+
                         targetExitBuffer.PDG = PDG;
                         targetExitBuffer.charge = charge;
 
-                        targetExitBuffer.eventID = eventCounter;
+                        targetExitBuffer.eventID = firstEventID + primaryIdx;
 
                         targetExit->Fill();
                     }
+
+                    if (not driftProjections.empty() and driftSourceMagIdx < 0 and momentum.z() > 0.0) {
+                        driftBuffer.Add(hitPos.x()/mm, hitPos.y()/mm, hitPos.z()/mm,
+                                        momentum.x()/momentum.z(), momentum.y()/momentum.z(),
+                                        energy/MeV, weight, PDG, charge, primaryIdx);
+                        driftTypeNames[PDG] = type;
+                    }
+
+                    // Skip the particles leaving through the sides or the upstream face of the target
+                    if (phaseSpaceWriter != NULL and
+                        G4ThreeVector(momentum).rotateY(-phaseSpaceAngle).z() > 0.0 and
+                        std::abs(G4ThreeVector(hitPos).rotateY(-phaseSpaceAngle).z() - phaseSpaceExitZ) < 1e-7) {
+                        phaseSpaceRecord record;
+                        record.x  = hitPos.x()/mm;
+                        record.y  = hitPos.y()/mm;
+                        record.z  = hitPos.z()/mm;
+                        record.px = momentum.x()/MeV;
+                        record.py = momentum.y()/MeV;
+                        record.pz = momentum.z()/MeV;
+                        record.E  = energy/MeV;
+                        record.weight  = weight;
+                        record.PDG     = PDG;
+                        record.eventID = firstEventID + primaryIdx;
+                        phaseSpaceRecords.push_back(record);
+                    }
+                }
+
+                if (phaseSpaceWriter != NULL) {
+                    // The file is sorted by eventID, while the primaries of an event are tracked in any order
+                    std::stable_sort(phaseSpaceRecords.begin(), phaseSpaceRecords.end(),
+                                     [](const phaseSpaceRecord& a, const phaseSpaceRecord& b) {
+                                         return a.eventID < b.eventID;
+                                     });
+                    for (auto& record : phaseSpaceRecords) {
+                        phaseSpaceWriter->Write(record);
+                    }
                 }
 
             }
@@ -754,96 +780,31 @@ void RootFileWriter::doEvent(const G4Event* event){
         }
     }
 
+    //**Data from the target depth planes, which use a TrackerSD**
+    for (auto& ph : targetPlaneHists) {
+        DoPlaneEvent(ph, HCE, numPrimaries);
+    }
+
     //**Data from detectorTrackerSD**
-    G4int myTrackerSD_CollID = SDman->GetCollectionID("TrackerCollection");
+    G4int myTrackerSD_CollID = SDman->GetCollectionID("tracker/TrackerCollection");
     if (myTrackerSD_CollID>=0) {
         MyTrackerHitsCollection* trackerHitsCollection = NULL;
         trackerHitsCollection = (MyTrackerHitsCollection*) (HCE->GetHC(myTrackerSD_CollID));
         if (trackerHitsCollection != NULL) {
             G4int nEntries = trackerHitsCollection->entries();
+            std::vector<G4double> numParticles_weighted(numPrimaries, 0.0);
 
             for (G4int i = 0; i < nEntries; i++) {
-                //Get the data from the event
-                const G4double  energy = (*trackerHitsCollection)[i]->GetTrackEnergy();
-                const G4int     PDG    = (*trackerHitsCollection)[i]->GetPDG();
-                const G4int     charge = (*trackerHitsCollection)[i]->GetCharge();
-                const G4String& type   = (*trackerHitsCollection)[i]->GetType();
-                const G4ThreeVector& hitPos   = (*trackerHitsCollection)[i]->GetPosition();
-                const G4ThreeVector& momentum = (*trackerHitsCollection)[i]->GetMomentum();
-                const G4double       hitR     = sqrt(hitPos.x()*hitPos.x() + hitPos.y()*hitPos.y());
-
-                //Overall histograms
-                tracker_energy->Fill(energy/MeV);
-
-                if (tracker_type_energy.find(PDG) != tracker_type_energy.end()) {
-                    tracker_type_energy[PDG]->Fill(energy/MeV);
-                }
-                else {
-                    tracker_type_energy[0]->Fill(energy/MeV);
-                }
-
-                if (hitR/mm < position_cutoffR) {
-                    if (tracker_type_cutoff_energy.find(PDG) != tracker_type_cutoff_energy.end()) {
-                        tracker_type_cutoff_energy[PDG]->Fill(energy/MeV);
-                    }
-                    else {
-                        tracker_type_cutoff_energy[0]->Fill(energy/MeV);
-                    }
-                }
-
-                //Hit position
-                tracker_hitPos->Fill(hitPos.x()/mm, hitPos.y()/mm);
-                if (charge != 0 and energy/MeV > beamEnergy*beamEnergy_cutoff and hitR/mm < position_cutoffR) {
-                    tracker_hitPos_cutoff->Fill(hitPos.x()/mm, hitPos.y()/mm);
-                }
+                const MyTrackerHit* hit = (*trackerHitsCollection)[i];
+                numParticles_weighted[hit->GetPrimaryIdx()] += hit->GetWeight();
 
-                //Phase space
-                tracker_phasespaceX->Fill(hitPos.x()/mm, momentum.x()/momentum.z());
-                tracker_phasespaceY->Fill(hitPos.y()/mm, momentum.y()/momentum.z());
-
-                if (charge != 0 and energy/MeV > beamEnergy*beamEnergy_cutoff and hitR/mm < position_cutoffR) {
-                    tracker_phasespaceX_cutoff->Fill(hitPos.x()/mm, momentum.x()/momentum.z());
-                    tracker_phasespaceY_cutoff->Fill(hitPos.y()/mm, momentum.y()/momentum.z());
-                }
-
-                //Particle type counting
-                FillParticleTypes(typeCounter["tracker"], PDG, type);
-                if (energy/MeV > beamEnergy*beamEnergy_cutoff and hitR/mm < position_cutoffR) {
-                    FillParticleTypes(typeCounter["tracker_cutoff"], PDG, type);
-                }
-
-                //Hit positions
-                tracker_particleHit_x  +=  hitPos.x()/mm;
-                tracker_particleHit_xx += (hitPos.x()/mm)*(hitPos.x()/mm);
-                tracker_particleHit_y  +=  hitPos.y()/mm;
-                tracker_particleHit_yy += (hitPos.y()/mm)*(hitPos.y()/mm);
-
-                if (charge != 0 and energy/MeV > beamEnergy*beamEnergy_cutoff) {
-                    tracker_particleHit_x_cutoff  +=  hitPos.x()/mm;
-                    tracker_particleHit_xx_cutoff += (hitPos.x()/mm)*(hitPos.x()/mm);
-                    tracker_particleHit_y_cutoff  +=  hitPos.y()/mm;
-                    tracker_particleHit_yy_cutoff += (hitPos.y()/mm)*(hitPos.y()/mm);
-                    numParticles_cutoff += 1;
-                }
-
-                //R position
-                if (tracker_Rpos.find(PDG) != tracker_Rpos.end()) {
-                    tracker_Rpos[PDG]->Fill(hitR/mm);
-                }
-                else {
-                    tracker_Rpos[0]->Fill(hitR/mm);
-                }
-                if (energy/MeV > beamEnergy*beamEnergy_cutoff) {
-                    if (tracker_Rpos_cutoff.find(PDG) != tracker_Rpos_cutoff.end()) {
-                        tracker_Rpos_cutoff[PDG]->Fill(hitR/mm);
-                    }
-                    else {
-                        tracker_Rpos_cutoff[0]->Fill(hitR/mm);
-                    }
-                }
+                FillPlaneHistograms(trackerHists, hit);
 
                 //Fill the TTree
                 if (not miniFile) {
+                    const G4ThreeVector& hitPos   = hit->GetPosition();
+                    const G4ThreeVector& momentum = hit->GetMomentum();
+
                     trackerHitsBuffer.x = hitPos.x()/mm;
                     trackerHitsBuffer.y = hitPos.x()/mm;
                     trackerHitsBuffer.z = hitPos.z()/mm;
@@ -852,18 +813,22 @@ void RootFileWriter::doEvent(const G4Event* event){
                     trackerHitsBuffer.py = momentum.y()/MeV;
                     trackerHitsBuffer.pz = momentum.z()/MeV;
 
-                    trackerHitsBuffer.E = energy / MeV;
+                    trackerHitsBuffer.E = hit->GetTrackEnergy() / MeV;
 
-                    trackerHitsBuffer.PDG = PDG;
-                    trackerHitsBuffer.charge = charge;
+                    trackerHitsBuffer.weight = hit->GetWeight();
 
-                    trackerHitsBuffer.eventID = eventCounter;
+                    trackerHitsBuffer.PDG = hit->GetPDG();
+                    trackerHitsBuffer.charge = hit->GetCharge();
+
+                    trackerHitsBuffer.eventID = firstEventID + hit->GetPrimaryIdx();
 
                     trackerHits->Fill();
                 }
             }
 
-            tracker_numParticles->Fill(nEntries);
+            for (auto numParticles : numParticles_weighted) {
+                trackerHists.numParticles->Fill(numParticles);
+            }
         }
         else{
             G4cout << "trackerHitsCollection was NULL!"<<G4endl;
@@ -873,13 +838,22 @@ void RootFileWriter::doEvent(const G4Event* event){
         G4cout << "myTrackerSD_CollID was " << myTrackerSD_CollID << "<0!"<<G4endl;
     }
 
+    //**Data from the scoring planes, which use a TrackerSD**
+    for (auto& ph : planeHists) {
+        DoPlaneEvent(ph, HCE, numPrimaries);
+    }
+
     // Initial particle distribution
-    init_phasespaceX->Fill(genAct->x/mm,genAct->xp/rad);
-    init_phasespaceY->Fill(genAct->y/mm,genAct->yp/rad);
-    init_phasespaceXY->Fill(genAct->x/mm,genAct->y/mm);
-    init_E->Fill(genAct->E/MeV);
+    for (auto& primary : genAct->generatedPrimaries) {
+        init_phasespaceX->Fill(primary.x/mm,primary.xp/rad,primary.weight);
+        init_phasespaceY->Fill(primary.y/mm,primary.yp/rad,primary.weight);
+        init_phasespaceXY->Fill(primary.x/mm,primary.y/mm,primary.weight);
+        init_E->Fill(primary.E/MeV,primary.weight);
+    }
 
     //**Data from Magnets, which use a TargetSD**
+    const size_t numMagnets = detCon->magnets.size();
+    std::vector<G4double> magnetEdeps_primary(numMagnets*numPrimaries, 0.0); // [MeV], index primaryIdx*numMagnets+magIdx
     size_t magIdx = -1;
     for (auto mag : detCon->magnets) {
         const G4String magName = mag->magnetName;
@@ -892,14 +866,13 @@ void RootFileWriter::doEvent(const G4Event* event){
             magnetEdepHitsCollection = (MyEdepHitsCollection*) (HCE->GetHC(myMagnetEdep_CollID));
             if (magnetEdepHitsCollection != NULL) {
                 G4int nEntries = magnetEdepHitsCollection->entries();
-                G4double edep      = 0.0;
                 for (G4int i = 0; i < nEntries; i++){
-                    edep      += (*magnetEdepHitsCollection)[i]->GetDepositedEnergy();
+                    magnetEdeps_primary[(*magnetEdepHitsCollection)[i]->GetPrimaryIdx()*numMagnets + magIdx] +=
+                        (*magnetEdepHitsCollection)[i]->GetDepositedEnergy() *
+                        (*magnetEdepHitsCollection)[i]->GetWeight() / MeV;
                 }
-                magnet_edep[magIdx]->Fill(edep/MeV);
-
-                if (not miniFile){
-                    magnetEdepsBuffer[magIdx] = edep/MeV;
+                for (G4int primaryIdx = 0; primaryIdx < numPrimaries; primaryIdx++) {
+                    magnet_edep[magIdx]->Fill(magnetEdeps_primary[primaryIdx*numMagnets + magIdx]);
                 }
             }
             else {
@@ -929,70 +902,74 @@ void RootFileWriter::doEvent(const G4Event* event){
                     const G4double       hitR        = sqrt(hitPos.x()*hitPos.x() + hitPos.y()*hitPos.y());
                     const G4int          PDG         = (*magnetExitposHitsCollection)[i]->GetPDG();
                     const G4String&      type        = (*magnetExitposHitsCollection)[i]->GetType();
+                    const G4double       weight      = (*magnetExitposHitsCollection)[i]->GetWeight();
 
-                    if ( abs( hitPos.z() -
-                              (detCon->magnets[magIdx]->GetLength()/2.0 +
-                               detCon->magnets[magIdx]->getZ0()          )
-                              ) < 1e-7 ) {
-                        // We are on the downstream exit face.
-                        // Note: Coordinates in global coordinates.
-
-                        //Particle type counting
-                        FillParticleTypes(typeCounter[magName], PDG, type);
-                        if (energy/MeV > beamEnergy*beamEnergy_cutoff and hitR/mm < position_cutoffR) {
-                            FillParticleTypes(typeCounter[magName + "_cutoff"], PDG, type);
-                        }
+                    // Only the crossings of the downstream exit face are recorded by the SD.
+                    // Note: Coordinates in global coordinates.
 
-                        //Phase space
-                        magnet_exit_phasespaceX[magIdx]->
-                            Fill(hitPos.x()/mm, momentum.x()/momentum.z());
-                        magnet_exit_phasespaceY[magIdx]->
-                            Fill(hitPos.y()/mm, momentum.y()/momentum.z());
-
-                        if ( charge != 0 and
-                             energy/MeV > beamEnergy*beamEnergy_cutoff and
-                             hitR/mm < position_cutoffR
-                             ) {
-                            magnet_exit_phasespaceX_cutoff[magIdx]->
-                                Fill(hitPos.x()/mm, momentum.x()/momentum.z());
-                            magnet_exit_phasespaceY_cutoff[magIdx]->
-                                Fill(hitPos.y()/mm, momentum.y()/momentum.z());
-                        }
+                    if (G4int(magIdx) == driftSourceMagIdx and not driftProjections.empty() and momentum.z() > 0.0) {
+                        driftBuffer.Add(hitPos.x()/mm, hitPos.y()/mm, hitPos.z()/mm,
+                                        momentum.x()/momentum.z(), momentum.y()/momentum.z(),
+                                        energy/MeV, weight, PDG, charge,
+                                        (*magnetExitposHitsCollection)[i]->GetPrimaryIdx());
+                        driftTypeNames[PDG] = type;
+                    }
+
+                    //Particle type counting
+                    FillParticleTypes(typeCounter[magName], PDG, type, weight);
+                    if (energy/MeV > beamEnergy*beamEnergy_cutoff and hitR/mm < position_cutoffR) {
+                        FillParticleTypes(typeCounter[magName + "_cutoff"], PDG, type, weight);
+                    }
+
+                    //Phase space
+                    magnet_exit_phasespaceX[magIdx]->
+                        Fill(hitPos.x()/mm, momentum.x()/momentum.z(), weight);
+                    magnet_exit_phasespaceY[magIdx]->
+                        Fill(hitPos.y()/mm, momentum.y()/momentum.z(), weight);
+
+                    if ( charge != 0 and
+                         energy/MeV > beamEnergy*beamEnergy_cutoff and
+                         hitR/mm < position_cutoffR
+                         ) {
+                        magnet_exit_phasespaceX_cutoff[magIdx]->
+                            Fill(hitPos.x()/mm, momentum.x()/momentum.z(), weight);
+                        magnet_exit_phasespaceY_cutoff[magIdx]->
+                            Fill(hitPos.y()/mm, momentum.y()/momentum.z(), weight);
+                    }
 
-                        //R position
-                        if (magnet_exit_Rpos[magIdx].find(PDG) != magnet_exit_Rpos[magIdx].end()) {
-                            magnet_exit_Rpos[magIdx][PDG]->Fill(hitR/mm);
+                    //R position
+                    if (magnet_exit_Rpos[magIdx].find(PDG) != magnet_exit_Rpos[magIdx].end()) {
+                        magnet_exit_Rpos[magIdx][PDG]->Fill(hitR/mm, weight);
+                    }
+                    else {
+                        magnet_exit_Rpos[magIdx][0]->Fill(hitR/mm, weight);
+                    }
+                    if (energy/MeV > beamEnergy*beamEnergy_cutoff) {
+                        if (magnet_exit_Rpos_cutoff[magIdx].find(PDG) !=
+                            magnet_exit_Rpos_cutoff[magIdx].end()) {
+                            magnet_exit_Rpos_cutoff[magIdx][PDG]->Fill(hitR/mm, weight);
                         }
                         else {
-                            magnet_exit_Rpos[magIdx][0]->Fill(hitR/mm);
-                        }
-                        if (energy/MeV > beamEnergy*beamEnergy_cutoff) {
-                            if (magnet_exit_Rpos_cutoff[magIdx].find(PDG) !=
-                                magnet_exit_Rpos_cutoff[magIdx].end()) {
-                                magnet_exit_Rpos_cutoff[magIdx][PDG]->Fill(hitR/mm);
-                            }
-                            else {
-                                magnet_exit_Rpos_cutoff[magIdx][0]->Fill(hitR/mm);
-                            }
+                            magnet_exit_Rpos_cutoff[magIdx][0]->Fill(hitR/mm, weight);
                         }
+                    }
 
-                        //Energy
-                        if (magnet_exit_energy[magIdx].find(PDG) !=
-                            magnet_exit_energy[magIdx].end()) {
-                            magnet_exit_energy[magIdx][PDG]->Fill(energy/MeV);
+                    //Energy
+                    if (magnet_exit_energy[magIdx].find(PDG) !=
+                        magnet_exit_energy[magIdx].end()) {
+                        magnet_exit_energy[magIdx][PDG]->Fill(energy/MeV, weight);
+                    }
+                    else {
+                        magnet_exit_energy[magIdx][0]->Fill(energy/MeV, weight);
+                    }
+
+                    if (hitR/mm < position_cutoffR) {
+                        if (magnet_exit_cutoff_energy[magIdx].find(PDG) !=
+                            magnet_exit_cutoff_energy[magIdx].end()) {
+                            magnet_exit_cutoff_energy[magIdx][PDG]->Fill(energy/MeV, weight);
                         }
                         else {
-                            magnet_exit_energy[magIdx][0]->Fill(energy/MeV);
-                        }
-
-                        if (hitR/mm < position_cutoffR) {
-                            if (magnet_exit_cutoff_energy[magIdx].find(PDG) !=
-                                magnet_exit_cutoff_energy[magIdx].end()) {
-                                magnet_exit_cutoff_energy[magIdx][PDG]->Fill(energy/MeV);
-                            }
-                            else {
-                                magnet_exit_cutoff_energy[magIdx][0]->Fill(energy/MeV);
-                            }
+                            magnet_exit_cutoff_energy[magIdx][0]->Fill(energy/MeV, weight);
                         }
                     }
 
@@ -1009,6 +986,8 @@ void RootFileWriter::doEvent(const G4Event* event){
 
                         targetExitBuffer.E = energy / MeV;
 
+                        targetExitBuffer.weight = weight;
+
                         targetExitBuffer.PDG = PDG;
                         targetExitBuffer.charge = charge;
 
@@ -1028,8 +1007,16 @@ void RootFileWriter::doEvent(const G4Event* event){
         }
     } // END loop over magnets
     if (not miniFile) {
-        magnetEdeps->Fill(); // Outside loop over magnets
+        // Outside loop over magnets
+        for (G4int primaryIdx = 0; primaryIdx < numPrimaries; primaryIdx++) {
+            for (size_t i = 0; i < numMagnets; i++) {
+                magnetEdepsBuffer[i] = magnetEdeps_primary[primaryIdx*numMagnets + i];
+            }
+            magnetEdeps->Fill();
+        }
     }
+
+    DoDriftProjections(numPrimaries);
 }
 void RootFileWriter::finalizeRootFile() {
 
@@ -1037,20 +1024,29 @@ void RootFileWriter::finalizeRootFile() {
     G4RunManager*           run  = G4RunManager::GetRunManager();
     DetectorConstruction* detCon = (DetectorConstruction*)run->GetUserDetectorConstruction();
 
+    if (phaseSpaceWriter != NULL) {
+        phaseSpaceWriter->Close(eventCounter);
+        delete phaseSpaceWriter;
+        phaseSpaceWriter = NULL;
+    }
+
     //Print out the particle types on all detector planes
     for (auto it : typeCounter) {
         PrintParticleTypes(it.second, it.first);
     }
+    for (auto it : killedTrackTime) {
+        G4cout << "Wall-clock time spent on " << it.first << " tracks: " << it.second << " [s]" << G4endl;
+    }
 
     // ** Below cutoff **
 
     //Tracker average position and RMS
-    double xave  = tracker_particleHit_x / ((double)typeCounter["tracker"].numParticles);
-    double yave  = tracker_particleHit_y / ((double)typeCounter["tracker"].numParticles);
-    double xrms  = ( tracker_particleHit_xx - (tracker_particleHit_x*tracker_particleHit_x / ((double)typeCounter["tracker"].numParticles)) ) /
+    double xave  = trackerHists.particleHit_x / ((double)typeCounter["tracker"].numParticles);
+    double yave  = trackerHists.particleHit_y / ((double)typeCounter["tracker"].numParticles);
+    double xrms  = ( trackerHists.particleHit_xx - (trackerHists.particleHit_x*trackerHists.particleHit_x / ((double)typeCounter["tracker"].numParticles)) ) /
         (((double)typeCounter["tracker"].numParticles)-1.0);
     xrms = sqrt(xrms);
-    double yrms  = ( tracker_particleHit_yy - (tracker_particleHit_y*tracker_particleHit_y / ((double)typeCounter["tracker"].numParticles)) ) /
+    double yrms  = ( trackerHists.particleHit_yy - (trackerHists.particleHit_y*trackerHists.particleHit_y / ((double)typeCounter["tracker"].numParticles)) ) /
         (((double)typeCounter["tracker"].numParticles)-1.0);
     yrms = sqrt(yrms);
 
@@ -1081,15 +1077,16 @@ void RootFileWriter::finalizeRootFile() {
     // ** Above cutoff **
 
     // Average position and RMS
-    double xave_cutoff  = tracker_particleHit_x_cutoff / ((double)numParticles_cutoff);
-    double yave_cutoff  = tracker_particleHit_y_cutoff / ((double)numParticles_cutoff);
-    double xrms_cutoff  = ( tracker_particleHit_xx_cutoff -
-                            (tracker_particleHit_x_cutoff*tracker_particleHit_x_cutoff /
+    const G4double numParticles_cutoff = trackerHists.numParticles_cutoff;
+    double xave_cutoff  = trackerHists.particleHit_x_cutoff / ((double)numParticles_cutoff);
+    double yave_cutoff  = trackerHists.particleHit_y_cutoff / ((double)numParticles_cutoff);
+    double xrms_cutoff  = ( trackerHists.particleHit_xx_cutoff -
+                            (trackerHists.particleHit_x_cutoff*trackerHists.particleHit_x_cutoff /
                              ((double)numParticles_cutoff)) ) /
         (((double)numParticles_cutoff)-1.0);
     xrms_cutoff = sqrt(xrms_cutoff);
-    double yrms_cutoff  = ( tracker_particleHit_yy_cutoff -
-                            (tracker_particleHit_y_cutoff*tracker_particleHit_y_cutoff /
+    double yrms_cutoff  = ( trackerHists.particleHit_yy_cutoff -
+                            (trackerHists.particleHit_y_cutoff*trackerHists.particleHit_y_cutoff /
                              ((double)numParticles_cutoff)) ) /
         (((double)numParticles_cutoff)-1.0);
     yrms_cutoff = sqrt(yrms_cutoff);
@@ -1122,6 +1119,46 @@ void RootFileWriter::finalizeRootFile() {
         G4cout << G4endl;
     }
 
+    // Angles at the target depth planes
+    for (size_t planeIdx = 0; planeIdx < targetPlaneHists.size(); planeIdx++) {
+        const planeHistograms& ph = targetPlaneHists[planeIdx];
+        G4cout << ph.name
+               << " (depth = " << detCon->GetTargetPlanes()[planeIdx]/mm << " [mm]):" << G4endl
+               << "Angle average (x) = " << ph.angle->GetMean()
+               << " [deg], RMS = " << ph.angle->GetStdDev() << " [deg]" << G4endl
+               << "Above cutoff: Angle average (x) = " << ph.angle_cutoff->GetMean()
+               << " [deg], RMS = " << ph.angle_cutoff->GetStdDev() << " [deg]" << G4endl;
+        G4cout << G4endl;
+    }
+
+    // Same for the scoring planes
+    for (size_t planeIdx = 0; planeIdx < planeHists.size(); planeIdx++) {
+        const planeHistograms& ph = planeHists[planeIdx];
+        const G4double n        = typeCounter[ph.name].numParticles;
+        const G4double n_cutoff = ph.numParticles_cutoff;
+
+        double plane_xave = ph.particleHit_x / n;
+        double plane_yave = ph.particleHit_y / n;
+        double plane_xrms = sqrt( ( ph.particleHit_xx - ph.particleHit_x*ph.particleHit_x / n ) / (n-1.0) );
+        double plane_yrms = sqrt( ( ph.particleHit_yy - ph.particleHit_y*ph.particleHit_y / n ) / (n-1.0) );
+
+        double plane_xave_cutoff = ph.particleHit_x_cutoff / n_cutoff;
+        double plane_yave_cutoff = ph.particleHit_y_cutoff / n_cutoff;
+        double plane_xrms_cutoff = sqrt( ( ph.particleHit_xx_cutoff -
+                                           ph.particleHit_x_cutoff*ph.particleHit_x_cutoff / n_cutoff ) / (n_cutoff-1.0) );
+        double plane_yrms_cutoff = sqrt( ( ph.particleHit_yy_cutoff -
+                                           ph.particleHit_y_cutoff*ph.particleHit_y_cutoff / n_cutoff ) / (n_cutoff-1.0) );
+
+        G4cout << ph.name << " (z = " << detCon->GetScoringPlanes()[planeIdx]/mm << " [mm]), "
+               << "all particles (n=" << n << "):" << G4endl
+               << "Average x = " << plane_xave << " [mm], RMS = " << plane_xrms << " [mm]" << G4endl
+               << "Average y = " << plane_yave << " [mm], RMS = " << plane_yrms << " [mm]" << G4endl;
+        G4cout << ph.name << " above cutoff (n=" << n_cutoff << "):" << G4endl
+               << "Average x = " << plane_xave_cutoff << " [mm], RMS = " << plane_xrms_cutoff << " [mm]" << G4endl
+               << "Average y = " << plane_yave_cutoff << " [mm], RMS = " << plane_yrms_cutoff << " [mm]" << G4endl;
+        G4cout << G4endl;
+    }
+
     //General metadata
     // Ugly hack: Use a double to store an int,
     // since there are no streamable int arrays without making a dict.
@@ -1149,6 +1186,13 @@ void RootFileWriter::finalizeRootFile() {
     metadataVector.Write("metadata");
     G4cout << G4endl;
 
+    if (eventBudget) {
+        G4cout << "Events aborted by the event budget: " << numBudgetAbortedEvents
+               << ", see the histogram 'budget_killed_energy' for the energy lost." << G4endl << G4endl;
+        budget_killed_energy->Write();
+        delete budget_killed_energy; budget_killed_energy = NULL;
+    }
+
     //Compute Twiss parameters
     PrintTwissParameters(init_phasespaceX);
     PrintTwissParameters(init_phasespaceY);
@@ -1158,16 +1202,30 @@ void RootFileWriter::finalizeRootFile() {
         PrintTwissParameters(target_exit_phasespaceX_cutoff);
         PrintTwissParameters(target_exit_phasespaceY_cutoff);
     }
+    for (auto& ph : targetPlaneHists) {
+        PrintTwissParameters(ph.phasespaceX);
+        PrintTwissParameters(ph.phasespaceY);
+        PrintTwissParameters(ph.phasespaceX_cutoff);
+        PrintTwissParameters(ph.phasespaceY_cutoff);
+    }
     for (size_t magIdx = 0; magIdx < magnet_exit_phasespaceX.size(); magIdx++) {
         PrintTwissParameters(magnet_exit_phasespaceX[magIdx]);
         PrintTwissParameters(magnet_exit_phasespaceY[magIdx]);
         PrintTwissParameters(magnet_exit_phasespaceX_cutoff[magIdx]);
         PrintTwissParameters(magnet_exit_phasespaceY_cutoff[magIdx]);
     }
-    PrintTwissParameters(tracker_phasespaceX);
-    PrintTwissParameters(tracker_phasespaceY);
-    PrintTwissParameters(tracker_phasespaceX_cutoff);
-    PrintTwissParameters(tracker_phasespaceY_cutoff);
+    PrintTwissParameters(trackerHists.phasespaceX);
+    PrintTwissParameters(trackerHists.phasespaceY);
+    PrintTwissParameters(trackerHists.phasespaceX_cutoff);
+    PrintTwissParameters(trackerHists.phasespaceY_cutoff);
+    for (auto& ph : planeHists) {
+        PrintTwissParameters(ph.phasespaceX);
+        PrintTwissParameters(ph.phasespaceY);
+        PrintTwissParameters(ph.phasespaceX_cutoff);
+        PrintTwissParameters(ph.phasespaceY_cutoff);
+    }
+
+    WriteDriftProjections();
 
     if (not quickmode and detCon->GetHasTarget()) {
         // Compute the analytical multiple scattering angle distribution
@@ -1292,15 +1350,6 @@ void RootFileWriter::finalizeRootFile() {
             }
         }
 
-        tracker_hitPos->Write();
-        tracker_hitPos_cutoff->Write();
-
-        tracker_phasespaceX->Write();
-        tracker_phasespaceY->Write();
-
-        tracker_phasespaceX_cutoff->Write();
-        tracker_phasespaceY_cutoff->Write();
-
         for (auto it : magnet_exit_phasespaceX) {
             it->Write();
         }
@@ -1370,29 +1419,28 @@ void RootFileWriter::finalizeRootFile() {
             delete it.second;
         }
         target_exit_Rpos_cutoff.clear();
-    }
 
-    for (auto it : tracker_type_energy) {
-        it.second->Write();
-        delete it.second;
-    }
-    tracker_type_energy.clear();
-    for (auto it : tracker_type_cutoff_energy) {
-        it.second->Write();
-        delete it.second;
+        if (fastSimValidation) {
+            fastsim_validate_exitangle->Write();
+            fastsim_validate_energy->Write();
+            delete fastsim_validate_exitangle; fastsim_validate_exitangle = NULL;
+            delete fastsim_validate_energy;    fastsim_validate_energy    = NULL;
+        }
     }
-    tracker_type_cutoff_energy.clear();
 
-    for (auto it: tracker_Rpos) {
-        it.second->Write();
-        delete it.second;
+    WritePlaneHistograms(trackerHists);
+
+    // Write and clear the target depth plane hists
+    for (auto& ph : targetPlaneHists) {
+        WritePlaneHistograms(ph);
     }
-    tracker_Rpos.clear();
-    for (auto it: tracker_Rpos_cutoff) {
-        it.second->Write();
-        delete it.second;
+    targetPlaneHists.clear();
+
+    // Write and clear the scoring plane hists
+    for (auto& ph : planeHists) {
+        WritePlaneHistograms(ph);
     }
-    tracker_Rpos_cutoff.clear();
+    planeHists.clear();
 
     if (detCon->GetHasTarget()) {
         target_exitangle_hist->Write();
@@ -1479,12 +1527,6 @@ void RootFileWriter::finalizeRootFile() {
         delete target_exit_phasespaceY_cutoff; target_exit_phasespaceY_cutoff = NULL;
     }
 
-    delete tracker_phasespaceX; tracker_phasespaceX = NULL;
-    delete tracker_phasespaceY; tracker_phasespaceY = NULL;
-
-    delete tracker_phasespaceX_cutoff; tracker_phasespaceX_cutoff = NULL;
-    delete tracker_phasespaceY_cutoff; tracker_phasespaceY_cutoff = NULL;
-
     if (detCon->GetHasTarget()) {
         if (target_edep_dens != NULL) {
             delete target_edep_dens; target_edep_dens = NULL;
@@ -1496,11 +1538,6 @@ void RootFileWriter::finalizeRootFile() {
         delete target_exitangle_hist_cutoff; target_exitangle_hist_cutoff = NULL;
     }
 
-    delete tracker_numParticles; tracker_numParticles = NULL;
-    delete tracker_energy; tracker_energy = NULL;
-    delete tracker_hitPos; tracker_hitPos = NULL;
-    delete tracker_hitPos_cutoff; tracker_hitPos_cutoff = NULL;
-
     if(not miniFile) {
         delete trackerHits; trackerHits = NULL;
         if (detCon->GetHasTarget()) {
@@ -1567,6 +1604,415 @@ void RootFileWriter::PrintTwissParameters(TH2D* phaseSpaceHist) {
     twissVector.Write((G4String(phaseSpaceHist->GetName())+"_TWISS").c_str());
 }
 
+void RootFileWriter::DoDriftProjections(G4int numPrimaries) {
+    // Project the particles stored for this event in straight lines to each z, and fill the same histograms as for the tracker.
+    // Particles outside the tracker at the given z are counted as lost.
+    if (driftProjections.empty()) return;
+
+    G4RunManager*           run    = G4RunManager::GetRunManager();
+    DetectorConstruction*   detCon = (DetectorConstruction*)run->GetUserDetectorConstruction();
+
+    const G4double halfX = detCon->getDetectorSizeX()/2.0/mm;
+    const G4double halfY = detCon->getDetectorSizeY()/2.0/mm;
+
+    for (size_t projIdx = 0; projIdx < driftProjections.size(); projIdx++) {
+        const G4double   zProj = driftProjections[projIdx];
+        planeHistograms& ph    = driftHists[projIdx];
+
+        driftBuffer.Project(zProj, driftXProj, driftYProj);
+
+        std::vector<G4double> numParticles_weighted(numPrimaries, 0.0);
+        for (size_t i = 0; i < driftBuffer.size(); i++) {
+            const G4double x      = driftXProj[i];
+            const G4double y      = driftYProj[i];
+            const G4double weight = driftBuffer.weight[i];
+            if (fabs(x) > halfX or fabs(y) > halfY) {
+                driftLost[projIdx] += weight;
+                continue;
+            }
+
+            // Only the direction of the momentum is known, which is all that the histograms use
+            MyTrackerHit hit(G4ThreeVector(x*mm, y*mm, zProj*mm),
+                             G4ThreeVector(driftBuffer.xp[i], driftBuffer.yp[i], 1.0),
+                             driftBuffer.E[i]*MeV, driftBuffer.PDG[i], driftBuffer.charge[i]);
+            hit.SetType(driftTypeNames[driftBuffer.PDG[i]]);
+            hit.SetWeight(weight);
+            hit.SetPrimaryIdx(driftBuffer.primaryIdx[i]);
+
+            numParticles_weighted[hit.GetPrimaryIdx()] += weight;
+            FillPlaneHistograms(ph, &hit);
+        }
+
+        for (auto numParticles : numParticles_weighted) {
+            ph.numParticles->Fill(numParticles);
+        }
+    }
+
+    driftBuffer.Clear();
+}
+
+void RootFileWriter::WriteDriftProjections() {
+    if (driftProjections.empty()) return;
+
+    G4RunManager*           run    = G4RunManager::GetRunManager();
+    DetectorConstruction*   detCon = (DetectorConstruction*)run->GetUserDetectorConstruction();
+
+    G4cout << "Drift projections of the particles exiting the "
+           << (driftSourceMagIdx < 0 ? G4String("target") : detCon->magnets[driftSourceMagIdx]->magnetName)
+           << " at z = " << driftSourceZ/mm << " [mm]:" << G4endl << G4endl;
+
+    for (size_t projIdx = 0; projIdx < driftHists.size(); projIdx++) {
+        planeHistograms& ph = driftHists[projIdx];
+
+        const G4double n        = typeCounter[ph.name].numParticles;
+        const G4double n_cutoff = ph.numParticles_cutoff;
+        G4cout << ph.name << " (z = " << driftProjections[projIdx] << " [mm]), all particles (n=" << n << "):" << G4endl
+               << "Average x = " << ph.particleHit_x/n << " [mm], RMS = "
+               << sqrt((ph.particleHit_xx - ph.particleHit_x*ph.particleHit_x/n)/(n-1.0)) << " [mm]" << G4endl
+               << "Average y = " << ph.particleHit_y/n << " [mm], RMS = "
+               << sqrt((ph.particleHit_yy - ph.particleHit_y*ph.particleHit_y/n)/(n-1.0)) << " [mm]" << G4endl
+               << "Lost (outside the tracker) = " << driftLost[projIdx] << G4endl;
+        G4cout << ph.name << " above cutoff (n=" << n_cutoff << "):" << G4endl
+               << "Average x = " << ph.particleHit_x_cutoff/n_cutoff << " [mm], RMS = "
+               << sqrt((ph.particleHit_xx_cutoff - ph.particleHit_x_cutoff*ph.particleHit_x_cutoff/n_cutoff)/(n_cutoff-1.0))
+               << " [mm]" << G4endl
+               << "Average y = " << ph.particleHit_y_cutoff/n_cutoff << " [mm], RMS = "
+               << sqrt((ph.particleHit_yy_cutoff - ph.particleHit_y_cutoff*ph.particleHit_y_cutoff/n_cutoff)/(n_cutoff-1.0))
+               << " [mm]" << G4endl;
+
+        G4cout << G4endl;
+
+        PrintTwissParameters(ph.phasespaceX);
+        PrintTwissParameters(ph.phasespaceY);
+        PrintTwissParameters(ph.phasespaceX_cutoff);
+        PrintTwissParameters(ph.phasespaceY_cutoff);
+
+        WritePlaneHistograms(ph);
+    }
+    driftHists.clear();
+
+    // (Weighted) number of particles outside the tracker at each projection
+    TVectorD driftLostVector (driftLost.size());
+    for (size_t projIdx = 0; projIdx < driftLost.size(); projIdx++) {
+        driftLostVector[projIdx] = driftLost[projIdx];
+    }
+    driftLostVector.Write("projection_lost");
+}
+
+void RootFileWriter::BookPlaneHistograms(planeHistograms& ph, G4String name, G4double minR, G4bool targetPlane) {
+    G4RunManager*         run    = G4RunManager::GetRunManager();
+    DetectorConstruction* detCon = (DetectorConstruction*)run->GetUserDetectorConstruction();
+
+    ph = planeHistograms();
+    ph.name        = name;
+    ph.targetPlane = targetPlane;
+
+    // Particles cross the target depth planes, and these also cut on the energy for type_cutoff_energy
+    const G4String verb      = targetPlane ? "crossing " : "hitting ";
+    const G4String cutoffTxt = targetPlane ? " (r < Rcut, E > Ecut)" : " (r < Rcut)";
+
+    ph.numParticles = new TH1D((name+"_numParticles").c_str(),
+                               (name+" numParticles").c_str(),
+                               1001,-0.5,1000.5);
+    ph.numParticles->GetXaxis()->SetTitle("Number of particles / event");
+
+    ph.energy = new TH1D((name+"_energy").c_str(),
+                         ("Energy of all particles "+verb+name).c_str(),
+                         10000,0,beamEnergy);
+    ph.energy->GetXaxis()->SetTitle("Energy per particle [MeV]");
+
+    ph.type_energy[11]  = new TH1D((name+"_energy_PDG11").c_str(),
+                                   ("Particle energy when "+verb+name+" (electrons)").c_str(),
+                                   engNbins,0,beamEnergy);
+    ph.type_energy[-11] = new TH1D((name+"_energy_PDG-11").c_str(),
+                                   ("Particle energy when "+verb+name+" (positrons)").c_str(),
+                                   engNbins,0,beamEnergy);
+    ph.type_energy[22]  = new TH1D((name+"_energy_PDG22").c_str(),
+                                   ("Particle energy when "+verb+name+" (photons)").c_str(),
+                                   engNbins,0,beamEnergy);
+    ph.type_energy[2212]= new TH1D((name+"_energy_PDG2212").c_str(),
+                                   ("Particle energy when "+verb+name+" (protons)").c_str(),
+                                   engNbins,0,beamEnergy);
+    ph.type_energy[0]   = new TH1D((name+"_energy_PDGother").c_str(),
+                                   ("Particle energy when "+verb+name+" (other)").c_str(),
+                                   engNbins,0,beamEnergy);
+    for (auto it : ph.type_energy) {
+        it.second->GetXaxis()->SetTitle("Energy [MeV]");
+    }
+
+    ph.type_cutoff_energy[11]  = new TH1D((name+"_cutoff_energy_PDG11").c_str(),
+                                          ("Particle energy when "+verb+name+" (electrons)"+cutoffTxt).c_str(),
+                                          engNbins,0,beamEnergy);
+    ph.type_cutoff_energy[-11] = new TH1D((name+"_cutoff_energy_PDG-11").c_str(),
+                                          ("Particle energy when "+verb+name+" (positrons)"+cutoffTxt).c_str(),
+                                          engNbins,0,beamEnergy);
+    ph.type_cutoff_energy[22]  = new TH1D((name+"_cutoff_energy_PDG22").c_str(),
+                                          ("Particle energy when "+verb+name+" (photons)"+cutoffTxt).c_str(),
+                                          engNbins,0,beamEnergy);
+    ph.type_cutoff_energy[2212]= new TH1D((name+"_cutoff_energy_PDG2212").c_str(),
+                                          ("Particle energy when "+verb+name+" (protons)"+cutoffTxt).c_str(),
+                                          engNbins,0,beamEnergy);
+    ph.type_cutoff_energy[0]   = new TH1D((name+"_cutoff_energy_PDGother").c_str(),
+                                          ("Particle energy when "+verb+name+" (other)"+cutoffTxt).c_str(),
+                                          engNbins,0,beamEnergy);
+    for (auto it : ph.type_cutoff_energy) {
+        it.second->GetXaxis()->SetTitle("Energy [MeV]");
+    }
+
+    ph.hitPos        = new TH2D((name+"_hitpos").c_str(), (name+" hit position").c_str(),
+                                1000,-detCon->getDetectorSizeX()/2.0/mm,detCon->getDetectorSizeX()/2.0/mm,
+                                1000,-detCon->getDetectorSizeY()/2.0/mm,detCon->getDetectorSizeY()/2.0/mm);
+    ph.hitPos_cutoff = new TH2D((name+"_hitpos_cutoff").c_str(),
+                                (name+" hit position (charged, energy > Ecut)").c_str(),
+                                1000,-position_cutoffR, position_cutoffR,
+                                1000,-position_cutoffR, position_cutoffR);
+
+    ph.phasespaceX        = new TH2D((name+"_x").c_str(),
+                                     (name+" phase space (x)").c_str(),
+                                     1000, -phasespacehist_posLim/mm,phasespacehist_posLim/mm,
+                                     1000, -phasespacehist_angLim/rad,phasespacehist_angLim/rad);
+    ph.phasespaceY        = new TH2D((name+"_y").c_str(),
+                                     (name+" phase space (y)").c_str(),
+                                     1000, -phasespacehist_posLim/mm,phasespacehist_posLim/mm,
+                                     1000, -phasespacehist_angLim/rad,phasespacehist_angLim/rad);
+    ph.phasespaceX_cutoff = new TH2D((name+"_cutoff_x").c_str(),
+                                     (name+" phase space (x) (charged, energy > Ecut, r < Rcut)").c_str(),
+                                     1000, -phasespacehist_posLim/mm,phasespacehist_posLim/mm,
+                                     1000, -phasespacehist_angLim/rad,phasespacehist_angLim/rad);
+    ph.phasespaceY_cutoff = new TH2D((name+"_cutoff_y").c_str(),
+                                     (name+" phase space (y) (charged, energy > Ecut, r < Rcut)").c_str(),
+                                     1000, -phasespacehist_posLim/mm,phasespacehist_posLim/mm,
+                                     1000, -phasespacehist_angLim/rad,phasespacehist_angLim/rad);
+    ph.phasespaceX->GetXaxis()->SetTitle("Position x [mm]");
+    ph.phasespaceX->GetYaxis()->SetTitle("Angle dx/dz [rad]");
+    ph.phasespaceY->GetXaxis()->SetTitle("Position y [mm]");
+    ph.phasespaceY->GetYaxis()->SetTitle("Angle dy/dz [rad]");
+    ph.phasespaceX_cutoff->GetXaxis()->SetTitle("Position x [mm]");
+    ph.phasespaceX_cutoff->GetYaxis()->SetTitle("Angle dx/dz [rad]");
+    ph.phasespaceY_cutoff->GetXaxis()->SetTitle("Position y [mm]");
+    ph.phasespaceY_cutoff->GetYaxis()->SetTitle("Angle dy/dz [rad]");
+
+    if (targetPlane) {
+        ph.angle        = new TH1D((name+"_angle").c_str(),
+                                   ("Angle when crossing "+name).c_str(),
+                                   5001, -90, 90);
+        ph.angle_cutoff = new TH1D((name+"_angle_cutoff").c_str(),
+                                   ("Angle when crossing "+name+" (charged, energy > Ecut, r < Rcut)").c_str(),
+                                   5001, -90, 90);
+    }
+
+    ph.Rpos[11]  = new TH1D((name+"_rpos_PDG11").c_str(),
+                            (name+" rpos (electrons)").c_str(),
+                            1000,0,minR);
+    ph.Rpos[-11] = new TH1D((name+"_rpos_PDG-11").c_str(),
+                            (name+" rpos (positrons)").c_str(),
+                            1000,0,minR);
+    ph.Rpos[22]  = new TH1D((name+"_rpos_PDG22").c_str(),
+                            (name+" rpos (photons)").c_str(),
+                            1000,0,minR);
+    ph.Rpos[2212]= new TH1D((name+"_rpos_PDG2212").c_str(),
+                            (name+" rpos (protons)").c_str(),
+                            1000,0,minR);
+    ph.Rpos[0]   = new TH1D((name+"_rpos_PDGother").c_str(),
+                            (name+" rpos (other)").c_str(),
+                            1000,0,minR);
+    for (auto hist : ph.Rpos) {
+        hist.second->GetXaxis()->SetTitle("R [mm]");
+    }
+    ph.Rpos_cutoff[11]  = new TH1D((name+"_rpos_cutoff_PDG11").c_str(),
+                                   (name+" rpos (electrons, energy > E_cut)").c_str(),
+                                   1000,0,minR);
+    ph.Rpos_cutoff[-11] = new TH1D((name+"_rpos_cutoff_PDG-11").c_str(),
+                                   (name+" rpos (positrons, energy > E_cut)").c_str(),
+                                   1000,0,minR);
+    ph.Rpos_cutoff[22]  = new TH1D((name+"_rpos_cutoff_PDG22").c_str(),
+                                   (name+" rpos (photons, energy > E_cut)").c_str(),
+                                   1000,0,minR);
+    ph.Rpos_cutoff[2212]= new TH1D((name+"_rpos_cutoff_PDG2212").c_str(),
+                                   (name+" rpos (protons, energy > E_cut)").c_str(),
+                                   1000,0,minR);
+    ph.Rpos_cutoff[0]   = new TH1D((name+"_rpos_cutoff_PDGother").c_str(),
+                                   (name+" rpos (other, energy > E_cut)").c_str(),
+                                   1000,0,minR);
+    for (auto hist : ph.Rpos_cutoff) {
+        hist.second->GetXaxis()->SetTitle("R [mm]");
+    }
+
+    typeCounter[name]             = particleTypesCounter();
+    typeCounter[name + "_cutoff"] = particleTypesCounter();
+}
+
+void RootFileWriter::FillPlaneHistograms(planeHistograms& ph, const MyTrackerHit* hit) {
+    const G4double       energy   = hit->GetTrackEnergy();
+    const G4int          PDG      = hit->GetPDG();
+    const G4int          charge   = hit->GetCharge();
+    const G4String&      type     = hit->GetType();
+    const G4ThreeVector& hitPos   = hit->GetPosition();
+    const G4ThreeVector& momentum = hit->GetMomentum();
+    const G4double       hitR     = sqrt(hitPos.x()*hitPos.x() + hitPos.y()*hitPos.y());
+    const G4double       weight   = hit->GetWeight();
+
+    //Overall histograms
+    ph.energy->Fill(energy/MeV, weight);
+
+    if (ph.type_energy.find(PDG) != ph.type_energy.end()) {
+        ph.type_energy[PDG]->Fill(energy/MeV, weight);
+    }
+    else {
+        ph.type_energy[0]->Fill(energy/MeV, weight);
+    }
+
+    if (hitR/mm < position_cutoffR and (energy/MeV > beamEnergy*beamEnergy_cutoff or not ph.targetPlane)) {
+        if (ph.type_cutoff_energy.find(PDG) != ph.type_cutoff_energy.end()) {
+            ph.type_cutoff_energy[PDG]->Fill(energy/MeV, weight);
+        }
+        else {
+            ph.type_cutoff_energy[0]->Fill(energy/MeV, weight);
+        }
+    }
+
+    //Angle
+    if (ph.targetPlane) {
+        const G4double angle = atan(momentum.x()/momentum.z())/deg;
+        ph.angle->Fill(angle, weight);
+        if (charge != 0 and energy/MeV > beamEnergy*beamEnergy_cutoff and hitR/mm < position_cutoffR) {
+            ph.angle_cutoff->Fill(angle, weight);
+        }
+    }
+
+    //Hit position
+    ph.hitPos->Fill(hitPos.x()/mm, hitPos.y()/mm, weight);
+    if (charge != 0 and energy/MeV > beamEnergy*beamEnergy_cutoff and hitR/mm < position_cutoffR) {
+        ph.hitPos_cutoff->Fill(hitPos.x()/mm, hitPos.y()/mm, weight);
+    }
+
+    //Phase space
+    ph.phasespaceX->Fill(hitPos.x()/mm, momentum.x()/momentum.z(), weight);
+    ph.phasespaceY->Fill(hitPos.y()/mm, momentum.y()/momentum.z(), weight);
+
+    if (charge != 0 and energy/MeV > beamEnergy*beamEnergy_cutoff and hitR/mm < position_cutoffR) {
+        ph.phasespaceX_cutoff->Fill(hitPos.x()/mm, momentum.x()/momentum.z(), weight);
+        ph.phasespaceY_cutoff->Fill(hitPos.y()/mm, momentum.y()/momentum.z(), weight);
+    }
+
+    //Particle type counting
+    FillParticleTypes(typeCounter[ph.name], PDG, type, weight);
+    if (energy/MeV > beamEnergy*beamEnergy_cutoff and hitR/mm < position_cutoffR) {
+        FillParticleTypes(typeCounter[ph.name + "_cutoff"], PDG, type, weight);
+    }
+
+    //Hit positions
+    ph.particleHit_x  +=  hitPos.x()/mm * weight;
+    ph.particleHit_xx += (hitPos.x()/mm)*(hitPos.x()/mm) * weight;
+    ph.particleHit_y  +=  hitPos.y()/mm * weight;
+    ph.particleHit_yy += (hitPos.y()/mm)*(hitPos.y()/mm) * weight;
+
+    if (charge != 0 and energy/MeV > beamEnergy*beamEnergy_cutoff) {
+        ph.particleHit_x_cutoff  +=  hitPos.x()/mm * weight;
+        ph.particleHit_xx_cutoff += (hitPos.x()/mm)*(hitPos.x()/mm) * weight;
+        ph.particleHit_y_cutoff  +=  hitPos.y()/mm * weight;
+        ph.particleHit_yy_cutoff += (hitPos.y()/mm)*(hitPos.y()/mm) * weight;
+        ph.numParticles_cutoff   += weight;
+    }
+
+    //R position
+    if (ph.Rpos.find(PDG) != ph.Rpos.end()) {
+        ph.Rpos[PDG]->Fill(hitR/mm, weight);
+    }
+    else {
+        ph.Rpos[0]->Fill(hitR/mm, weight);
+    }
+    if (energy/MeV > beamEnergy*beamEnergy_cutoff) {
+        if (ph.Rpos_cutoff.find(PDG) != ph.Rpos_cutoff.end()) {
+            ph.Rpos_cutoff[PDG]->Fill(hitR/mm, weight);
+        }
+        else {
+            ph.Rpos_cutoff[0]->Fill(hitR/mm, weight);
+        }
+    }
+}
+
+void RootFileWriter::DoPlaneEvent(planeHistograms& ph, G4HCofThisEvent* HCE, G4int numPrimaries) {
+    G4SDManager* SDman = G4SDManager::GetSDMpointer();
+
+    G4int myPlaneSD_CollID = SDman->GetCollectionID(ph.name+"/TrackerCollection");
+    if (myPlaneSD_CollID < 0) {
+        G4cout << "myPlaneSD_CollID was " << myPlaneSD_CollID << " < 0 for '" << ph.name << "'!" << G4endl;
+        return;
+    }
+    MyTrackerHitsCollection* planeHitsCollection = (MyTrackerHitsCollection*) (HCE->GetHC(myPlaneSD_CollID));
+    if (planeHitsCollection == NULL) {
+        G4cout << "planeHitsCollection was NULL for '" << ph.name << "'!" << G4endl;
+        return;
+    }
+
+    G4int nEntries = planeHitsCollection->entries();
+    std::vector<G4double> numParticles_weighted(numPrimaries, 0.0);
+
+    for (G4int i = 0; i < nEntries; i++) {
+        const MyTrackerHit* hit = (*planeHitsCollection)[i];
+        numParticles_weighted[hit->GetPrimaryIdx()] += hit->GetWeight();
+
+        FillPlaneHistograms(ph, hit);
+    }
+
+    for (auto numParticles : numParticles_weighted) {
+        ph.numParticles->Fill(numParticles);
+    }
+}
+
+void RootFileWriter::WritePlaneHistograms(planeHistograms& ph) {
+    ph.numParticles->Write();
+    ph.energy->Write();
+    delete ph.numParticles; ph.numParticles = NULL;
+    delete ph.energy;       ph.energy       = NULL;
+
+    for (auto it : ph.type_energy) {
+        it.second->Write();
+        delete it.second;
+    }
+    ph.type_energy.clear();
+    for (auto it : ph.type_cutoff_energy) {
+        it.second->Write();
+        delete it.second;
+    }
+    ph.type_cutoff_energy.clear();
+
+    for (auto it : ph.Rpos) {
+        it.second->Write();
+        delete it.second;
+    }
+    ph.Rpos.clear();
+    for (auto it : ph.Rpos_cutoff) {
+        it.second->Write();
+        delete it.second;
+    }
+    ph.Rpos_cutoff.clear();
+
+    if (ph.targetPlane) {
+        ph.angle->Write();
+        ph.angle_cutoff->Write();
+        delete ph.angle;        ph.angle        = NULL;
+        delete ph.angle_cutoff; ph.angle_cutoff = NULL;
+    }
+
+    if (not quickmode) {
+        //Write the 2D histograms to the ROOT file (slow)
+        ph.hitPos->Write();
+        ph.hitPos_cutoff->Write();
+        ph.phasespaceX->Write();
+        ph.phasespaceY->Write();
+        ph.phasespaceX_cutoff->Write();
+        ph.phasespaceY_cutoff->Write();
+    }
+    delete ph.hitPos;             ph.hitPos             = NULL;
+    delete ph.hitPos_cutoff;      ph.hitPos_cutoff      = NULL;
+    delete ph.phasespaceX;        ph.phasespaceX        = NULL;
+    delete ph.phasespaceY;        ph.phasespaceY        = NULL;
+    delete ph.phasespaceX_cutoff; ph.phasespaceX_cutoff = NULL;
+    delete ph.phasespaceY_cutoff; ph.phasespaceY_cutoff = NULL;
+}
+
 void RootFileWriter::PrintParticleTypes(particleTypesCounter& pt, G4String name) {
     //Print out the particle types hitting the tracker
     G4cout << endl;
@@ -1580,7 +2026,7 @@ void RootFileWriter::PrintParticleTypes(particleTypesCounter& pt, G4String name)
     TVectorD particleTypes_numpart(pt.particleTypes.size());
 
     size_t particleTypes_i = 0;
-    for(std::map<G4int,G4int>::iterator it = pt.particleTypes.begin(); it != pt.particleTypes.end(); it++){
+    for(std::map<G4int,G4double>::iterator it = pt.particleTypes.begin(); it != pt.particleTypes.end(); it++){
         G4cout << std::setw(15) << it->first << " = "
                << std::setw(15) << pt.particleNames[it->first] << ": "
                << std::setw(15) << it->second << " = ";// << G4endl;
@@ -1592,7 +2038,7 @@ void RootFileWriter::PrintParticleTypes(particleTypesCounter& pt, G4String name)
         // Unfortunately, there is no TObject array type for ints (?!?),
         // and I don't want  to depend on a ROOT dictionary file.
         particleTypes_PDG     [particleTypes_i] = int(it->first);
-        particleTypes_numpart [particleTypes_i] = int(it->second);
+        particleTypes_numpart [particleTypes_i] = it->second;
 
         particleTypes_i++;
     }
@@ -1601,13 +2047,13 @@ void RootFileWriter::PrintParticleTypes(particleTypesCounter& pt, G4String name)
 
 }
 
-void RootFileWriter::FillParticleTypes(particleTypesCounter& pt, G4int PDG, G4String type) {
+void RootFileWriter::FillParticleTypes(particleTypesCounter& pt, G4int PDG, G4String type, G4double weight) {
     if (pt.particleTypes.count(PDG) == 0) {
-        pt.particleTypes[PDG] = 0;
+        pt.particleTypes[PDG] = 0.0;
         pt.particleNames[PDG] = type;
     }
-    pt.particleTypes[PDG] += 1;
-    pt.numParticles       += 1;
+    pt.particleTypes[PDG] += weight;
+    pt.numParticles       += weight;
 }
 
 void RootFileWriter::setEngNbins(G4int edepNbins_in) {
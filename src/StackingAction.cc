@@ -0,0 +1,73 @@
+/*
+ * This file is part of MiniScatter.
+ *
+ *  MiniScatter is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  MiniScatter is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with MiniScatter.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "StackingAction.hh"
+
+#include "RootFileWriter.hh"
+#include "DetectorConstruction.hh"
+
+#include "G4Track.hh"
+#include "G4SystemOfUnits.hh"
+
+//--------------------------------------------------------------------------------
+
+StackingAction::StackingAction(DetectorConstruction* detCon_in,
+                               std::set<G4int> &noStack_in,
+                               std::map<G4int,G4double> &killEnergy_in) :
+    detCon(detCon_in),
+    noStack(noStack_in),
+    killEnergy(killEnergy_in) {
+
+    G4cout << "Initialized StackingAction, parameters:" << G4endl;
+    G4cout << "\t noStack (PDG)           = ";
+    for (auto PDG : noStack) {
+        G4cout << PDG << " ";
+    }
+    G4cout << G4endl;
+}
+
+//--------------------------------------------------------------------------------
+
+G4ClassificationOfNewTrack StackingAction::ClassifyNewTrack(const G4Track* aTrack) {
+    const G4int PDG = aTrack->GetDefinition()->GetPDGEncoding();
+
+    G4String killReason = "";
+    if (aTrack->GetParentID() != 0 and noStack.count(PDG) != 0) {
+        // Never kill the primaries
+        killReason = "killed_noStack";
+    }
+    else if (aTrack->GetParentID() != 0 and not killEnergy.empty()) {
+        // Never kill the primaries
+        auto it = killEnergy.find(PDG);
+        // Tracks created inside the target or the magnets are kept,
+        // so that their energy is deposited where it is scored.
+        if (it != killEnergy.end() and aTrack->GetKineticEnergy() < it->second and
+            not detCon->IsInScoringVolume(aTrack->GetTouchable())) {
+            killReason = "killed_energy";
+        }
+    }
+
+    if (killReason != "") {
+        RootFileWriter::GetInstance()->CountKilledTrack(killReason, PDG,
+                                                        aTrack->GetDefinition()->GetParticleSubType(),
+                                                        aTrack->GetWeight());
+        return fKill;
+    }
+    return fUrgent;
+}
+
+//--------------------------------------------------------------------------------
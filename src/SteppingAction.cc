@@ -0,0 +1,227 @@
+/*
+ * This file is part of MiniScatter.
+ *
+ *  MiniScatter is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  MiniScatter is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with MiniScatter.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "SteppingAction.hh"
+
+#include "DetectorConstruction.hh"
+#include "MagnetClasses.hh"
+#include "RootFileWriter.hh"
+
+#include "G4Step.hh"
+#include "G4Track.hh"
+#include "G4VProcess.hh"
+#include "G4Transportation.hh"
+#include "G4CoupledTransportation.hh"
+#include "G4ProcessManager.hh"
+#include "G4ParticleTable.hh"
+#include "G4EventManager.hh"
+#include "G4Event.hh"
+#include "G4SystemOfUnits.hh"
+
+#include <cmath>
+
+//--------------------------------------------------------------------------------
+
+SteppingAction::SteppingAction(DetectorConstruction* detCon_in,
+                               G4bool killAfterTracker_in,
+                               G4bool killBackward_in,
+                               std::map<G4int,G4double> &killEnergy_in,
+                               G4int eventStepBudget_in,
+                               G4double eventTimeBudget_in) :
+    detCon(detCon_in),
+    killAfterTracker(killAfterTracker_in),
+    killBackward(killBackward_in),
+    killEnergy(killEnergy_in),
+    eventStepBudget(eventStepBudget_in),
+    eventTimeBudget(eventTimeBudget_in) {
+
+    // Z position downstream of which nothing more is scored:
+    // The back face of the tracker or of the last scoring plane, or the exit face of the last object.
+    killAfterTracker_z = detCon->getDetectorDistance() + detCon->getDetectorThickness()/2.0;
+    for (auto mag : detCon->magnets) {
+        G4double magEnd = mag->getZ0() + mag->GetLength()/2.0;
+        if (magEnd > killAfterTracker_z) {
+            killAfterTracker_z = magEnd;
+        }
+    }
+    for (auto planeZ : detCon->GetScoringPlanes()) {
+        G4double planeEnd = planeZ + detCon->getDetectorThickness()/2.0;
+        if (planeEnd > killAfterTracker_z) {
+            killAfterTracker_z = planeEnd;
+        }
+    }
+    if (killAfterTracker and detCon->getDetectorRotated()) {
+        G4cerr << "Error in SteppingAction::SteppingAction():" << G4endl
+               << " Killing tracks after the tracker is not supported with a rotated detector." << G4endl;
+        exit(1);
+    }
+
+    // Z position upstream of which nothing is scored:
+    // The front face of the target, or the entrance face of the first object.
+    if (detCon->GetHasTarget()) {
+        killBackward_z = -detCon->getTargetThickness()/2.0;
+        if (detCon->getTargetRotated()) {
+            // Half the extent in z of the rotated target
+            killBackward_z = - ( fabs(cos(detCon->getTargetAngle())) * detCon->getTargetThickness()/2.0 +
+                                 fabs(sin(detCon->getTargetAngle())) * detCon->getTargetSizeX()/2.0 );
+        }
+    }
+    else {
+        killBackward_z = killAfterTracker_z;
+    }
+    for (auto mag : detCon->magnets) {
+        G4double magStart = mag->getZ0() - mag->GetLength()/2.0;
+        if (magStart < killBackward_z) {
+            killBackward_z = magStart;
+        }
+    }
+
+    G4cout << "Initialized SteppingAction, parameters:" << G4endl;
+    G4cout << "\t killAfterTracker        = " << (killAfterTracker?"true":"false");
+    if (killAfterTracker) {
+        G4cout << ", z > " << killAfterTracker_z/mm << " [mm]";
+    }
+    G4cout << G4endl;
+    G4cout << "\t killBackward            = " << (killBackward?"true":"false");
+    if (killBackward) {
+        G4cout << ", z < " << killBackward_z/mm << " [mm]";
+    }
+    G4cout << G4endl;
+    for (auto it : killEnergy) {
+        G4cout << "\t killEnergy (PDG " << it.first << ")"
+               << std::string(std::max(0,9-int(std::to_string(it.first).length())),' ')
+               << "= " << it.second/MeV << " [MeV]" << G4endl;
+    }
+    G4cout << "\t eventStepBudget         = " << eventStepBudget << " [steps]" << G4endl;
+    G4cout << "\t eventTimeBudget         = " << eventTimeBudget << " [s]" << G4endl;
+}
+
+void SteppingAction::SetLooperThresholds(G4double warningEnergy, G4double importantEnergy, G4int numTrials) {
+    G4ParticleTable::G4PTblDicIterator* particleIterator = G4ParticleTable::GetParticleTable()->GetIterator();
+    particleIterator->reset();
+    while ( (*particleIterator)() ) {
+        G4ProcessManager* pmanager = particleIterator->value()->GetProcessManager();
+        if (pmanager == NULL) continue;
+        G4ProcessVector* processes = pmanager->GetProcessList();
+        for (G4int i = 0; i < G4int(processes->size()); i++) {
+            G4Transportation* transport = dynamic_cast<G4Transportation*>((*processes)[i]);
+            if (transport != NULL) {
+                if (warningEnergy   >= 0.0) transport->SetThresholdWarningEnergy(warningEnergy);
+                if (importantEnergy >= 0.0) transport->SetThresholdImportantEnergy(importantEnergy);
+                if (numTrials       >= 0)   transport->SetThresholdTrials(numTrials);
+            }
+            G4CoupledTransportation* coupledTransport = dynamic_cast<G4CoupledTransportation*>((*processes)[i]);
+            if (coupledTransport != NULL) {
+                if (warningEnergy   >= 0.0) coupledTransport->SetThresholdWarningEnergy(warningEnergy);
+                if (importantEnergy >= 0.0) coupledTransport->SetThresholdImportantEnergy(importantEnergy);
+                if (numTrials       >= 0)   coupledTransport->SetThresholdTrials(numTrials);
+            }
+        }
+    }
+
+    G4cout << "Looper thresholds:" << G4endl;
+    G4cout << "\t warningEnergy           = ";
+    if (warningEnergy >= 0.0)   G4cout << warningEnergy/MeV << " [MeV]" << G4endl;
+    else                        G4cout << "(default)" << G4endl;
+    G4cout << "\t importantEnergy         = ";
+    if (importantEnergy >= 0.0) G4cout << importantEnergy/MeV << " [MeV]" << G4endl;
+    else                        G4cout << "(default)" << G4endl;
+    G4cout << "\t numTrials               = ";
+    if (numTrials >= 0)         G4cout << numTrials << G4endl;
+    else                        G4cout << "(default)" << G4endl;
+}
+
+//--------------------------------------------------------------------------------
+
+void SteppingAction::UserSteppingAction(const G4Step* aStep) {
+    G4Track* theTrack = aStep->GetTrack();
+    const G4StepPoint* postStepPoint = aStep->GetPostStepPoint();
+
+    if (theTrack->GetCurrentStepNumber() == 1) {
+        trackStartTime = std::chrono::steady_clock::now();
+    }
+
+    if (theTrack->GetTrackStatus() != fAlive) {
+        // Already stopped by the physics.
+        // Count the loopers, which are killed by the transportation inside the world
+        const G4VProcess* process = postStepPoint->GetProcessDefinedStep();
+        if (theTrack->GetTrackStatus() == fStopAndKill and
+            postStepPoint->GetStepStatus() != fWorldBoundary and
+            postStepPoint->GetKineticEnergy() > 0.0 and
+            process != NULL and process->GetProcessType() == fTransportation) {
+            const std::chrono::duration<G4double> trackTime = std::chrono::steady_clock::now() - trackStartTime;
+            RootFileWriter::GetInstance()->CountKilledTrack("killed_looper",
+                                                            theTrack->GetDefinition()->GetPDGEncoding(),
+                                                            theTrack->GetDefinition()->GetParticleSubType(),
+                                                            theTrack->GetWeight());
+            RootFileWriter::GetInstance()->AddKilledTrackTime("killed_looper", trackTime.count());
+        }
+        return;
+    }
+
+    if (eventStepBudget > 0 or eventTimeBudget > 0.0) {
+        const G4int eventID = G4EventManager::GetEventManager()->GetConstCurrentEvent()->GetEventID();
+        if (eventID != currentEventID) {
+            currentEventID = eventID;
+            eventSteps     = 0;
+            eventStartTime = std::chrono::steady_clock::now();
+        }
+        eventSteps++;
+    }
+
+    const G4double postStep_z = postStepPoint->GetPosition().z();
+
+    G4String killReason = "";
+    if (eventStepBudget > 0 and eventSteps > eventStepBudget) {
+        killReason = "killed_budget";
+    }
+    else if (eventTimeBudget > 0.0 and
+             std::chrono::duration<G4double>(std::chrono::steady_clock::now() - eventStartTime).count() > eventTimeBudget) {
+        killReason = "killed_budget";
+    }
+    else if (killAfterTracker and postStep_z > killAfterTracker_z) {
+        killReason = "killed_afterTracker";
+    }
+    else if (killBackward and postStep_z < killBackward_z and
+             postStepPoint->GetMomentumDirection().z() < 0.0) {
+        killReason = "killed_backward";
+    }
+    else if (not killEnergy.empty()) {
+        // Never kill inside the target or the magnets,
+        // as the remaining kinetic energy would then be missing from the energy deposit.
+        auto it = killEnergy.find(theTrack->GetDefinition()->GetPDGEncoding());
+        if (it != killEnergy.end() and postStepPoint->GetKineticEnergy() < it->second and
+            not detCon->IsInScoringVolume(postStepPoint->GetTouchable())) {
+            killReason = "killed_energy";
+        }
+    }
+
+    if (killReason != "") {
+        theTrack->SetTrackStatus(fStopAndKill);
+        if (killReason == "killed_budget") {
+            // The energy these tracks would have deposited is lost, flag the event
+            RootFileWriter::GetInstance()->AddBudgetKilledEnergy(postStepPoint->GetKineticEnergy(),
+                                                                 theTrack->GetWeight());
+        }
+        RootFileWriter::GetInstance()->CountKilledTrack(killReason,
+                                                        theTrack->GetDefinition()->GetPDGEncoding(),
+                                                        theTrack->GetDefinition()->GetParticleSubType(),
+                                                        theTrack->GetWeight());
+    }
+}
+
+//--------------------------------------------------------------------------------
@@ -0,0 +1,233 @@
+/*
+ * This file is part of MiniScatter.
+ *
+ *  MiniScatter is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  MiniScatter is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with MiniScatter.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "TargetFastSimModel.hh"
+
+#include "RootFileWriter.hh"
+
+#include "G4Box.hh"
+#include "G4Material.hh"
+#include "G4EmCalculator.hh"
+#include "G4UniversalFluctuation.hh"
+#include "G4FastSimulationManagerProcess.hh"
+#include "G4ProcessManager.hh"
+#include "G4ParticleTable.hh"
+#include "G4ParticleDefinition.hh"
+#include "G4Electron.hh"
+#include "G4Positron.hh"
+#include "G4GeometryTolerance.hh"
+#include "G4SystemOfUnits.hh"
+#include "G4PhysicalConstants.hh"
+#include "Randomize.hh"
+
+#include <cmath>
+
+//--------------------------------------------------------------------------------
+
+TargetFastSimModel::TargetFastSimModel(G4String modelName, G4Region* envelope, G4bool validate_in) :
+    G4VFastSimulationModel(modelName, envelope),
+    validate(validate_in) {
+    fluct = new G4UniversalFluctuation();
+}
+
+TargetFastSimModel::~TargetFastSimModel() {
+    delete fluct;
+}
+
+//--------------------------------------------------------------------------------
+
+void TargetFastSimModel::Print() {
+    G4cout << "Initialized TargetFastSimModel, parameters:" << G4endl;
+    G4cout << "\t validate                = " << (validate?"true":"false") << G4endl;
+    G4cout << "\t maxLossFraction         = " << maxLossFraction << G4endl;
+}
+
+//--------------------------------------------------------------------------------
+
+G4bool TargetFastSimModel::IsApplicable(const G4ParticleDefinition& particle) {
+    return particle.GetPDGCharge() != 0.0 and particle.GetParticleType() != "nucleus";
+}
+
+void TargetFastSimModel::ComputePathLength(const G4FastTrack& fastTrack) {
+    pathLength   = -1.0;
+    pathMeanLoss = 0.0;
+
+    const G4Box* box = dynamic_cast<const G4Box*>(fastTrack.GetEnvelopeSolid());
+    if (box == NULL) {
+        G4cerr << "Error in TargetFastSimModel::ComputePathLength(): The envelope is not a G4Box." << G4endl;
+        exit(1);
+    }
+
+    // Only tracks that enter through the front face and go straight to the back face
+    const G4ThreeVector& pos = fastTrack.GetPrimaryTrackLocalPosition();
+    const G4ThreeVector& dir = fastTrack.GetPrimaryTrackLocalDirection();
+    if (dir.z() <= 0.0) return;
+    if (fabs(pos.z() + box->GetZHalfLength()) > G4GeometryTolerance::GetInstance()->GetSurfaceTolerance()) {
+        return;
+    }
+
+    const G4double L = 2.0*box->GetZHalfLength() / dir.z();
+    const G4ThreeVector exitPos = pos + L*dir;
+    if (fabs(exitPos.x()) > box->GetXHalfLength() or fabs(exitPos.y()) > box->GetYHalfLength()) {
+        return;
+    }
+
+    // Only thin targets, where the energy change along the path can be neglected
+    const G4Track* track = fastTrack.GetPrimaryTrack();
+    G4EmCalculator emCal;
+    const G4double meanLoss = emCal.ComputeTotalDEDX(track->GetKineticEnergy(),
+                                                     track->GetDefinition(),
+                                                     track->GetMaterial()) * L;
+    if (meanLoss > maxLossFraction*track->GetKineticEnergy()) return;
+
+    pathLength   = L;
+    pathMeanLoss = meanLoss;
+}
+
+G4bool TargetFastSimModel::ModelTrigger(const G4FastTrack& fastTrack) {
+    // The G4FastSimulationManager always calls ModelTrigger() just before DoIt() for the same track
+    ComputePathLength(fastTrack);
+    if (pathLength < 0.0) return false;
+
+    if (validate) {
+        // Sample what the model would have done, but leave the track to the full simulation
+        G4ThreeVector exitPos;
+        G4ThreeVector exitDir;
+        G4double eLoss;
+        SampleExit(fastTrack, exitPos, exitDir, eLoss);
+
+        const G4ThreeVector globalDir = fastTrack.GetInverseAffineTransformation()->TransformAxis(exitDir);
+        const G4Track* track = fastTrack.GetPrimaryTrack();
+        RootFileWriter::GetInstance()->FillFastSimValidation(atan(globalDir.x()/globalDir.z())/deg,
+                                                             (track->GetKineticEnergy()-eLoss)/MeV,
+                                                             track->GetWeight());
+        return false;
+    }
+
+    return true;
+}
+
+//--------------------------------------------------------------------------------
+
+void TargetFastSimModel::SampleExit(const G4FastTrack& fastTrack,
+                                    G4ThreeVector& exitPos, G4ThreeVector& exitDir, G4double& eLoss) {
+    const G4Track* track = fastTrack.GetPrimaryTrack();
+    const G4ParticleDefinition* particle = track->GetDefinition();
+    const G4Material* material = track->GetMaterial();
+
+    const G4double L    = pathLength; // Set by ModelTrigger()
+    const G4double Ekin = track->GetKineticEnergy();
+    const G4double mass = particle->GetPDGMass();
+    const G4double p    = track->GetMomentum().mag();
+    const G4double beta = p / (Ekin + mass);
+    const G4double z    = fabs(particle->GetPDGCharge()/eplus);
+
+    // Multiple scattering (Highland / PDG formula)
+    const G4double X0 = material->GetRadlen();
+    const G4double theta0 = 13.6*MeV / (beta*p) * z * sqrt(L/X0) *
+        (1 + 0.038 * log(L*z*z/(X0*beta*beta)));
+
+    // Correlated lateral displacement and angle, independently for the two planes
+    G4double dPlane[2];
+    G4double thetaPlane[2];
+    for (int i = 0; i < 2; i++) {
+        const G4double z1 = G4RandGauss::shoot();
+        const G4double z2 = G4RandGauss::shoot();
+        dPlane[i]     = (z1*L*theta0/sqrt(12.0) + z2*L*theta0/2.0);
+        thetaPlane[i] = z2*theta0;
+    }
+
+    const G4ThreeVector& pos = fastTrack.GetPrimaryTrackLocalPosition();
+    const G4ThreeVector& dir = fastTrack.GetPrimaryTrackLocalDirection();
+    const G4ThreeVector u = dir.orthogonal().unit();
+    const G4ThreeVector v = dir.cross(u);
+
+    exitDir = (dir + tan(thetaPlane[0])*u + tan(thetaPlane[1])*v).unit();
+
+    exitPos = pos + L*dir + dPlane[0]*u + dPlane[1]*v;
+    // Put it back on the exit face of the target
+    const G4Box* box = static_cast<const G4Box*>(fastTrack.GetEnvelopeSolid());
+    exitPos.setZ(box->GetZHalfLength());
+    exitPos.setX(std::max(-box->GetXHalfLength(), std::min(box->GetXHalfLength(), exitPos.x())));
+    exitPos.setY(std::max(-box->GetYHalfLength(), std::min(box->GetYHalfLength(), exitPos.y())));
+
+    // Energy loss with straggling
+    const G4double meanLoss = pathMeanLoss;
+
+    // Maximum energy transfer to a single electron
+    G4double tmax;
+    if (particle == G4Electron::Definition()) {
+        tmax = 0.5*Ekin;
+    }
+    else if (particle == G4Positron::Definition()) {
+        tmax = Ekin;
+    }
+    else {
+        const G4double gamma = (Ekin + mass) / mass;
+        const G4double ratio = electron_mass_c2/mass;
+        tmax = 2.0*electron_mass_c2*(gamma*gamma - 1.0) / (1.0 + 2.0*gamma*ratio + ratio*ratio);
+    }
+
+    if (particle != fluctParticle) {
+        fluct->InitialiseMe(particle);
+        fluctParticle = particle;
+    }
+    eLoss = fluct->SampleFluctuations(track->GetMaterialCutsCouple(), track->GetDynamicParticle(),
+                                      tmax, L, meanLoss);
+    if (eLoss < 0.0)  eLoss = 0.0;
+    if (eLoss > Ekin) eLoss = Ekin;
+}
+
+void TargetFastSimModel::DoIt(const G4FastTrack& fastTrack, G4FastStep& fastStep) {
+    G4ThreeVector exitPos;
+    G4ThreeVector exitDir;
+    G4double eLoss;
+    SampleExit(fastTrack, exitPos, exitDir, eLoss);
+
+    const G4Track* track = fastTrack.GetPrimaryTrack();
+    const G4double L = pathLength; // Set by ModelTrigger()
+
+    fastStep.ProposePrimaryTrackFinalPosition(exitPos);
+    fastStep.ProposePrimaryTrackFinalMomentumDirection(exitDir);
+    fastStep.ProposePrimaryTrackFinalKineticEnergy(track->GetKineticEnergy() - eLoss);
+    fastStep.ProposePrimaryTrackPathLength(L);
+    fastStep.ProposePrimaryTrackFinalTime(track->GetGlobalTime() + L/(track->GetVelocity()));
+    fastStep.ProposeTotalEnergyDeposited(eLoss);
+
+    if (track->GetKineticEnergy() - eLoss <= 0.0) {
+        fastStep.KillPrimaryTrack();
+    }
+}
+
+//--------------------------------------------------------------------------------
+
+void TargetFastSimPhysics::ConstructProcess() {
+    G4FastSimulationManagerProcess* fastSimProcess = new G4FastSimulationManagerProcess("fastSimProcess_massGeom");
+
+    G4ParticleTable::G4PTblDicIterator* particleIterator = G4ParticleTable::GetParticleTable()->GetIterator();
+    particleIterator->reset();
+    while ( (*particleIterator)() ) {
+        G4ParticleDefinition* particle = particleIterator->value();
+        if (particle->IsShortLived()) continue;
+        if (particle->GetPDGCharge() == 0.0 and not neutralParticles) continue;
+        G4ProcessManager* pmanager = particle->GetProcessManager();
+        if (pmanager == NULL) continue;
+        pmanager->AddDiscreteProcess(fastSimProcess);
+    }
+}
+
+//--------------------------------------------------------------------------------
@@ -0,0 +1,43 @@
+/*
+ * This file is part of MiniScatter.
+ *
+ *  MiniScatter is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  MiniScatter is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with MiniScatter.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "TrackingAction.hh"
+
+#include "G4TrackingManager.hh"
+#include "G4TrackVector.hh"
+
+//--------------------------------------------------------------------------------
+
+void TrackingAction::PreUserTrackingAction(const G4Track* aTrack) {
+    if (aTrack->GetParentID() == 0 and aTrack->GetUserInformation() == NULL) {
+        fpTrackingManager->SetUserTrackInformation(new PrimaryTrackInformation(aTrack->GetTrackID()-1));
+    }
+}
+
+void TrackingAction::PostUserTrackingAction(const G4Track* aTrack) {
+    G4TrackVector* secondaries = fpTrackingManager->GimmeSecondaries();
+    if (secondaries == NULL) return;
+
+    const G4int primaryIdx = PrimaryTrackInformation::GetPrimaryIdx(aTrack);
+    for (auto secondary : *secondaries) {
+        if (secondary->GetUserInformation() == NULL) {
+            secondary->SetUserInformation(new PrimaryTrackInformation(primaryIdx));
+        }
+    }
+}
+
+//--------------------------------------------------------------------------------